@@ -0,0 +1,116 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "benchmark.h"
+#include <cstdio>
+#include <sstream>
+
+namespace {
+
+std::string quote(const std::string &str) {
+    std::string res = "\"";
+    for (auto c : str) {
+        switch (c) {
+        case '"':
+            res += "\\\"";
+            break;
+
+        case '\\':
+            res += "\\\\";
+            break;
+
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                res += buf;
+            } else {
+                res.push_back(c);
+            }
+            break;
+        }
+    }
+    res += "\"";
+
+    return res;
+}
+
+void write_latency(std::ostream &os, const sw::redis::LatencyStats &stats) {
+    os << "{\"count\": " << stats.count
+        << ", \"mean\": " << stats.mean().count()
+        << ", \"p50\": " << stats.percentile(50).count()
+        << ", \"p90\": " << stats.percentile(90).count()
+        << ", \"p99\": " << stats.percentile(99).count()
+        << ", \"p999\": " << stats.percentile(99.9).count()
+        << ", \"max\": " << stats.max.count()
+        << "}";
+}
+
+}
+
+namespace sw {
+
+namespace redis {
+
+namespace benchmark {
+
+double BenchmarkResult::ops_per_sec() const {
+    if (elapsed.count() == 0) {
+        return 0;
+    }
+
+    return (op_num - errors) * 1000000.0 / elapsed.count();
+}
+
+double BenchmarkResult::commands_per_sec() const {
+    return ops_per_sec() * bench_case.batch_size;
+}
+
+std::string to_json(const std::vector<BenchmarkResult> &results) {
+    std::ostringstream os;
+    os << "[";
+    for (std::size_t idx = 0; idx != results.size(); ++idx) {
+        const auto &result = results[idx];
+        const auto &bench_case = result.bench_case;
+
+        os << (idx == 0 ? "\n  " : ",\n  ");
+        os << "{\"mode\": " << quote(result.mode)
+            << ", \"workload\": " << quote(bench_case.workload)
+            << ", \"pool_size\": " << bench_case.pool_size
+            << ", \"val_len\": " << bench_case.val_len
+            << ", \"batch_size\": " << bench_case.batch_size
+            << ", \"threads\": " << result.thread_num
+            << ", \"ops\": " << result.op_num
+            << ", \"errors\": " << result.errors
+            << ", \"elapsed_us\": " << result.elapsed.count()
+            << ", \"ops_per_sec\": " << static_cast<long long>(result.ops_per_sec())
+            << ", \"commands_per_sec\": " << static_cast<long long>(result.commands_per_sec())
+            << ", \"latency_us\": ";
+        write_latency(os, result.latency);
+        os << ", \"pool_wait_us\": ";
+        write_latency(os, result.pool_wait);
+        os << "}";
+    }
+    os << "\n]\n";
+
+    return os.str();
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,212 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_BENCHMARK_BENCHMARK_H
+#define SEWENEW_REDISPLUSPLUS_BENCHMARK_BENCHMARK_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sw/redis++/redis++.h>
+
+namespace sw {
+
+namespace redis {
+
+namespace benchmark {
+
+struct BenchmarkOptions {
+    // Number of threads sending commands concurrently.
+    std::size_t thread_num = 10;
+
+    // Number of commands sent by all threads for each case. Pipelines and transactions
+    // send *batch_size* commands each time.
+    std::size_t request_num = 100000;
+
+    // Number of distinct keys. Threads share these keys, except that each thread has its own
+    // keys for pipelines and transactions, so that they can be sent to a single slot.
+    std::size_t key_num = 1000;
+
+    // The following options are swept, i.e. each workload runs with each combination of them.
+    std::vector<std::size_t> pool_sizes = {5};
+
+    std::vector<std::size_t> val_lens = {10};
+
+    // Number of commands in a pipeline or transaction.
+    std::vector<std::size_t> batch_sizes = {10};
+
+    // Names of workloads to run, e.g. "set", "pipeline". Empty means all workloads.
+    std::vector<std::string> workloads;
+
+    // All keys written by the benchmark begin with this prefix.
+    std::string key_prefix = "sw::redis::benchmark";
+};
+
+struct BenchmarkCase {
+    std::string workload;
+
+    std::size_t pool_size = 0;
+
+    std::size_t val_len = 0;
+
+    // 1, if the workload is not a pipeline or transaction.
+    std::size_t batch_size = 1;
+};
+
+struct BenchmarkResult {
+    // "standalone" or "cluster".
+    std::string mode;
+
+    BenchmarkCase bench_case;
+
+    std::size_t thread_num = 0;
+
+    // Number of operations, i.e. single commands, pipelines or transactions.
+    std::size_t op_num = 0;
+
+    // Number of failed operations.
+    std::size_t errors = 0;
+
+    // Wall time of running all operations by all threads.
+    std::chrono::microseconds elapsed{0};
+
+    // Latency of each succeeded operation.
+    LatencyStats latency;
+
+    // Time that threads waited for a connection of the pool.
+    LatencyStats pool_wait;
+
+    double ops_per_sec() const;
+
+    double commands_per_sec() const;
+};
+
+// Encode results as a JSON array, one object per case.
+std::string to_json(const std::vector<BenchmarkResult> &results);
+
+template <typename RedisInstance>
+class Benchmark {
+public:
+    Benchmark(const BenchmarkOptions &opts, const ConnectionOptions &connection_opts);
+
+    // Run all cases, and return results in the order of pool size, value length,
+    // workload, and batch size. *on_result* is called after each case is done.
+    template <typename Callback>
+    std::vector<BenchmarkResult> run(Callback &&on_result);
+
+private:
+    // Per-thread state.
+    struct Worker {
+        std::size_t id;
+
+        // Only created for pipeline and transaction workloads.
+        std::unique_ptr<Pipeline> pipe;
+
+        std::unique_ptr<Transaction> tx;
+    };
+
+    using Op = void (Benchmark::*)(RedisInstance &redis,
+                                    Worker &worker,
+                                    const BenchmarkCase &bench_case,
+                                    std::size_t idx);
+
+    struct Workload {
+        std::string name;
+
+        Op op;
+
+        // Whether the workload sends *batch_size* commands each time.
+        bool batch;
+    };
+
+    std::vector<Workload> _workloads() const;
+
+    BenchmarkResult _run(const Workload &workload, const BenchmarkCase &bench_case);
+
+    LatencyStats _run_worker(RedisInstance &redis,
+                                const Workload &workload,
+                                const BenchmarkCase &bench_case,
+                                std::size_t id,
+                                std::size_t op_num,
+                                std::size_t &errors);
+
+    // Write keys read by the workload, e.g. GET.
+    void _prepare(RedisInstance &redis, const Workload &workload);
+
+    void _cleanup(RedisInstance &redis, const Workload &workload);
+
+    std::string _mode() const;
+
+    Pipeline _pipeline(RedisInstance &redis, const StringView &hash_tag);
+
+    Transaction _transaction(RedisInstance &redis, const StringView &hash_tag);
+
+    void _set(RedisInstance &redis, Worker &worker, const BenchmarkCase &bench_case, std::size_t idx);
+
+    void _get(RedisInstance &redis, Worker &worker, const BenchmarkCase &bench_case, std::size_t idx);
+
+    void _incr(RedisInstance &redis, Worker &worker, const BenchmarkCase &bench_case, std::size_t idx);
+
+    void _lpush(RedisInstance &redis, Worker &worker, const BenchmarkCase &bench_case, std::size_t idx);
+
+    void _lrange(RedisInstance &redis, Worker &worker, const BenchmarkCase &bench_case, std::size_t idx);
+
+    void _hset(RedisInstance &redis, Worker &worker, const BenchmarkCase &bench_case, std::size_t idx);
+
+    void _hget(RedisInstance &redis, Worker &worker, const BenchmarkCase &bench_case, std::size_t idx);
+
+    void _sadd(RedisInstance &redis, Worker &worker, const BenchmarkCase &bench_case, std::size_t idx);
+
+    void _zadd(RedisInstance &redis, Worker &worker, const BenchmarkCase &bench_case, std::size_t idx);
+
+    void _pipeline_set(RedisInstance &redis,
+                        Worker &worker,
+                        const BenchmarkCase &bench_case,
+                        std::size_t idx);
+
+    void _transaction_set(RedisInstance &redis,
+                            Worker &worker,
+                            const BenchmarkCase &bench_case,
+                            std::size_t idx);
+
+    const std::string& _key(std::size_t idx) const {
+        return _keys[idx % _keys.size()];
+    }
+
+    // Keys of a pipeline or transaction sent by the given worker. They share a hash tag.
+    std::string _batch_key(std::size_t worker, std::size_t idx) const;
+
+    std::string _hash_tag(std::size_t worker) const;
+
+    BenchmarkOptions _opts;
+
+    ConnectionOptions _connection_opts;
+
+    std::vector<std::string> _keys;
+
+    std::string _value;
+};
+
+}
+
+}
+
+}
+
+#include "benchmark.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_BENCHMARK_BENCHMARK_H
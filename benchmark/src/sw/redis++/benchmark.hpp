@@ -0,0 +1,416 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_BENCHMARK_BENCHMARK_HPP
+#define SEWENEW_REDISPLUSPLUS_BENCHMARK_BENCHMARK_HPP
+
+#include <algorithm>
+#include <future>
+#include <iterator>
+
+namespace sw {
+
+namespace redis {
+
+namespace benchmark {
+
+template <typename RedisInstance>
+Benchmark<RedisInstance>::Benchmark(const BenchmarkOptions &opts,
+                                    const ConnectionOptions &connection_opts) :
+                                        _opts(opts),
+                                        _connection_opts(connection_opts) {
+    if (_opts.thread_num == 0 || _opts.request_num == 0 || _opts.key_num == 0) {
+        throw Error("Invalid benchmark options");
+    }
+
+    auto has_zero = [](const std::vector<std::size_t> &nums) {
+                        return nums.empty() || std::find(nums.begin(), nums.end(), 0) != nums.end();
+                    };
+    if (has_zero(_opts.pool_sizes) || has_zero(_opts.val_lens) || has_zero(_opts.batch_sizes)) {
+        throw Error("Invalid benchmark options: sizes must be positive");
+    }
+
+    // Throw if there's any unknown workload.
+    _workloads();
+
+    _keys.reserve(_opts.key_num);
+    for (std::size_t idx = 0; idx != _opts.key_num; ++idx) {
+        _keys.push_back(_opts.key_prefix + ":" + std::to_string(idx));
+    }
+}
+
+template <typename RedisInstance>
+template <typename Callback>
+std::vector<BenchmarkResult> Benchmark<RedisInstance>::run(Callback &&on_result) {
+    auto workloads = _workloads();
+
+    std::vector<BenchmarkResult> results;
+    for (auto pool_size : _opts.pool_sizes) {
+        for (auto val_len : _opts.val_lens) {
+            _value = std::string(val_len, 'x');
+
+            for (const auto &workload : workloads) {
+                auto batch_sizes = workload.batch ?
+                                    _opts.batch_sizes : std::vector<std::size_t>{1};
+
+                for (auto batch_size : batch_sizes) {
+                    BenchmarkCase bench_case;
+                    bench_case.workload = workload.name;
+                    bench_case.pool_size = pool_size;
+                    bench_case.val_len = val_len;
+                    bench_case.batch_size = batch_size;
+
+                    results.push_back(_run(workload, bench_case));
+
+                    on_result(results.back());
+                }
+            }
+        }
+    }
+
+    return results;
+}
+
+template <typename RedisInstance>
+auto Benchmark<RedisInstance>::_workloads() const -> std::vector<Workload> {
+    std::vector<Workload> all = {
+        {"set", &Benchmark::_set, false},
+        {"get", &Benchmark::_get, false},
+        {"incr", &Benchmark::_incr, false},
+        {"lpush", &Benchmark::_lpush, false},
+        {"lrange", &Benchmark::_lrange, false},
+        {"hset", &Benchmark::_hset, false},
+        {"hget", &Benchmark::_hget, false},
+        {"sadd", &Benchmark::_sadd, false},
+        {"zadd", &Benchmark::_zadd, false},
+        {"pipeline", &Benchmark::_pipeline_set, true},
+        {"transaction", &Benchmark::_transaction_set, true}
+    };
+
+    if (_opts.workloads.empty()) {
+        return all;
+    }
+
+    std::vector<Workload> workloads;
+    for (const auto &name : _opts.workloads) {
+        auto iter = std::find_if(all.begin(), all.end(),
+                                    [&name](const Workload &workload) {
+                                        return workload.name == name;
+                                    });
+        if (iter == all.end()) {
+            throw Error("Unknown benchmark workload: " + name);
+        }
+
+        workloads.push_back(*iter);
+    }
+
+    return workloads;
+}
+
+template <typename RedisInstance>
+BenchmarkResult Benchmark<RedisInstance>::_run(const Workload &workload,
+                                                const BenchmarkCase &bench_case) {
+    ConnectionPoolOptions pool_opts;
+    pool_opts.size = bench_case.pool_size;
+    // Connect before the clock starts.
+    pool_opts.min_idle = bench_case.pool_size;
+
+    RedisInstance redis(_connection_opts, pool_opts);
+
+    _cleanup(redis, workload);
+    _prepare(redis, workload);
+
+    auto thread_num = _opts.thread_num;
+    auto ops_per_thread = std::max<std::size_t>(
+                            _opts.request_num / bench_case.batch_size / thread_num, 1);
+
+    BenchmarkResult result;
+    result.mode = _mode();
+    result.bench_case = bench_case;
+    result.thread_num = thread_num;
+    result.op_num = ops_per_thread * thread_num;
+
+    std::vector<std::size_t> errors(thread_num, 0);
+    std::vector<std::future<LatencyStats>> futures;
+    futures.reserve(thread_num);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t id = 0; id != thread_num; ++id) {
+        futures.push_back(std::async(std::launch::async,
+                            [this, &redis, &workload, &bench_case, &errors, id, ops_per_thread]() {
+                                return this->_run_worker(redis,
+                                                            workload,
+                                                            bench_case,
+                                                            id,
+                                                            ops_per_thread,
+                                                            errors[id]);
+                            }));
+    }
+
+    for (auto &fut : futures) {
+        result.latency.merge(fut.get());
+    }
+
+    result.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start);
+
+    for (auto err : errors) {
+        result.errors += err;
+    }
+
+    result.pool_wait = redis.pool_stats().wait_time;
+
+    _cleanup(redis, workload);
+
+    return result;
+}
+
+template <typename RedisInstance>
+LatencyStats Benchmark<RedisInstance>::_run_worker(RedisInstance &redis,
+                                                    const Workload &workload,
+                                                    const BenchmarkCase &bench_case,
+                                                    std::size_t id,
+                                                    std::size_t op_num,
+                                                    std::size_t &errors) {
+    Worker worker;
+    worker.id = id;
+
+    // Each thread has its own histogram, so that recording doesn't contend.
+    LatencyHistogram latency;
+
+    auto first = id * op_num;
+    for (auto idx = first; idx != first + op_num; ++idx) {
+        auto start = std::chrono::steady_clock::now();
+
+        try {
+            (this->*(workload.op))(redis, worker, bench_case, idx);
+        } catch (const Error &) {
+            ++errors;
+
+            // The pipeline or transaction might be broken, and we create a new one next time.
+            worker.pipe.reset();
+            worker.tx.reset();
+
+            continue;
+        }
+
+        latency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start));
+    }
+
+    return latency.stats();
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_prepare(RedisInstance &redis, const Workload &workload) {
+    if (workload.name == "get") {
+        for (const auto &key : _keys) {
+            redis.set(key, _value);
+        }
+    } else if (workload.name == "lrange") {
+        std::vector<std::string> vals(10, _value);
+        for (const auto &key : _keys) {
+            redis.lpush(key, vals.begin(), vals.end());
+        }
+    } else if (workload.name == "hget") {
+        for (const auto &key : _keys) {
+            redis.hset(key, "field", _value);
+        }
+    }
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_cleanup(RedisInstance &redis, const Workload &workload) {
+    if (!workload.batch) {
+        // Keys might be located on different slots.
+        for (const auto &key : _keys) {
+            redis.del(key);
+        }
+
+        return;
+    }
+
+    for (std::size_t worker = 0; worker != _opts.thread_num; ++worker) {
+        std::vector<std::string> keys;
+        keys.reserve(_opts.key_num);
+        for (std::size_t idx = 0; idx != _opts.key_num; ++idx) {
+            keys.push_back(_batch_key(worker, idx));
+        }
+
+        redis.del(keys.begin(), keys.end());
+    }
+}
+
+template <typename RedisInstance>
+std::string Benchmark<RedisInstance>::_mode() const {
+    return "standalone";
+}
+
+template <>
+inline std::string Benchmark<RedisCluster>::_mode() const {
+    return "cluster";
+}
+
+template <typename RedisInstance>
+Pipeline Benchmark<RedisInstance>::_pipeline(RedisInstance &redis, const StringView &) {
+    return redis.pipeline();
+}
+
+template <>
+inline Pipeline Benchmark<RedisCluster>::_pipeline(RedisCluster &redis,
+                                                    const StringView &hash_tag) {
+    return redis.pipeline(hash_tag);
+}
+
+template <typename RedisInstance>
+Transaction Benchmark<RedisInstance>::_transaction(RedisInstance &redis, const StringView &) {
+    return redis.transaction();
+}
+
+template <>
+inline Transaction Benchmark<RedisCluster>::_transaction(RedisCluster &redis,
+                                                            const StringView &hash_tag) {
+    return redis.transaction(hash_tag);
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_set(RedisInstance &redis,
+                                    Worker &,
+                                    const BenchmarkCase &,
+                                    std::size_t idx) {
+    redis.set(_key(idx), _value);
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_get(RedisInstance &redis,
+                                    Worker &,
+                                    const BenchmarkCase &,
+                                    std::size_t idx) {
+    auto res = redis.get(_key(idx));
+    (void)res;
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_incr(RedisInstance &redis,
+                                        Worker &,
+                                        const BenchmarkCase &,
+                                        std::size_t idx) {
+    redis.incr(_key(idx));
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_lpush(RedisInstance &redis,
+                                        Worker &,
+                                        const BenchmarkCase &,
+                                        std::size_t idx) {
+    redis.lpush(_key(idx), _value);
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_lrange(RedisInstance &redis,
+                                        Worker &,
+                                        const BenchmarkCase &,
+                                        std::size_t idx) {
+    std::vector<std::string> res;
+    res.reserve(10);
+    redis.lrange(_key(idx), 0, 9, std::back_inserter(res));
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_hset(RedisInstance &redis,
+                                        Worker &,
+                                        const BenchmarkCase &,
+                                        std::size_t idx) {
+    redis.hset(_key(idx), "field", _value);
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_hget(RedisInstance &redis,
+                                        Worker &,
+                                        const BenchmarkCase &,
+                                        std::size_t idx) {
+    auto res = redis.hget(_key(idx), "field");
+    (void)res;
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_sadd(RedisInstance &redis,
+                                        Worker &,
+                                        const BenchmarkCase &,
+                                        std::size_t idx) {
+    redis.sadd(_key(idx), std::to_string(idx));
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_zadd(RedisInstance &redis,
+                                        Worker &,
+                                        const BenchmarkCase &,
+                                        std::size_t idx) {
+    redis.zadd(_key(idx), std::to_string(idx), static_cast<double>(idx));
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_pipeline_set(RedisInstance &redis,
+                                                Worker &worker,
+                                                const BenchmarkCase &bench_case,
+                                                std::size_t idx) {
+    if (!worker.pipe) {
+        worker.pipe.reset(new Pipeline(_pipeline(redis, _hash_tag(worker.id))));
+    }
+
+    auto &pipe = *worker.pipe;
+    for (std::size_t cmd = 0; cmd != bench_case.batch_size; ++cmd) {
+        pipe.set(_batch_key(worker.id, idx * bench_case.batch_size + cmd), _value);
+    }
+
+    pipe.exec();
+}
+
+template <typename RedisInstance>
+void Benchmark<RedisInstance>::_transaction_set(RedisInstance &redis,
+                                                Worker &worker,
+                                                const BenchmarkCase &bench_case,
+                                                std::size_t idx) {
+    if (!worker.tx) {
+        worker.tx.reset(new Transaction(_transaction(redis, _hash_tag(worker.id))));
+    }
+
+    auto &tx = *worker.tx;
+    for (std::size_t cmd = 0; cmd != bench_case.batch_size; ++cmd) {
+        tx.set(_batch_key(worker.id, idx * bench_case.batch_size + cmd), _value);
+    }
+
+    tx.exec();
+}
+
+template <typename RedisInstance>
+std::string Benchmark<RedisInstance>::_batch_key(std::size_t worker, std::size_t idx) const {
+    return "{" + _hash_tag(worker) + "}:" + std::to_string(idx % _opts.key_num);
+}
+
+template <typename RedisInstance>
+std::string Benchmark<RedisInstance>::_hash_tag(std::size_t worker) const {
+    return _opts.key_prefix + ":" + std::to_string(worker);
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_BENCHMARK_BENCHMARK_HPP
@@ -0,0 +1,335 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <tuple>
+#include <sw/redis++/redis++.h>
+#include "benchmark.h"
+#include "mock_server.h"
+
+namespace {
+
+// In-process servers, so that we can benchmark the client without a live Redis.
+struct MockServers {
+    std::unique_ptr<sw::redis::test::MockServer> standalone;
+
+    std::vector<std::unique_ptr<sw::redis::test::MockServer>> cluster;
+};
+
+void print_help();
+
+auto parse_options(int argc, char **argv)
+    -> std::tuple<sw::redis::Optional<sw::redis::ConnectionOptions>,
+                    sw::redis::Optional<sw::redis::ConnectionOptions>,
+                    sw::redis::benchmark::BenchmarkOptions,
+                    std::string,
+                    sw::redis::Optional<std::chrono::microseconds>>;
+
+void start_mock_servers(std::chrono::microseconds latency, MockServers &servers);
+
+std::vector<std::string> split(const std::string &str);
+
+std::vector<std::size_t> split_sizes(const std::string &str);
+
+template <typename RedisInstance>
+std::vector<sw::redis::benchmark::BenchmarkResult> run_benchmark(
+        const sw::redis::ConnectionOptions &opts,
+        const sw::redis::benchmark::BenchmarkOptions &benchmark_opts);
+
+}
+
+int main(int argc, char **argv) {
+    try {
+        sw::redis::Optional<sw::redis::ConnectionOptions> opts;
+        sw::redis::Optional<sw::redis::ConnectionOptions> cluster_node_opts;
+        sw::redis::benchmark::BenchmarkOptions benchmark_opts;
+        std::string output;
+        sw::redis::Optional<std::chrono::microseconds> mock_latency;
+        std::tie(opts, cluster_node_opts, benchmark_opts, output, mock_latency)
+            = parse_options(argc, argv);
+
+        MockServers mock_servers;
+        if (mock_latency) {
+            start_mock_servers(*mock_latency, mock_servers);
+
+            opts = sw::redis::Optional<sw::redis::ConnectionOptions>(
+                    mock_servers.standalone->connection_options());
+            cluster_node_opts = sw::redis::Optional<sw::redis::ConnectionOptions>(
+                    mock_servers.cluster.front()->connection_options());
+        }
+
+        std::vector<sw::redis::benchmark::BenchmarkResult> results;
+
+        if (opts) {
+            std::cerr << "Benchmarking Redis..." << std::endl;
+
+            auto res = run_benchmark<sw::redis::Redis>(*opts, benchmark_opts);
+            results.insert(results.end(), res.begin(), res.end());
+        }
+
+        if (cluster_node_opts) {
+            std::cerr << "Benchmarking RedisCluster..." << std::endl;
+
+            auto res = run_benchmark<sw::redis::RedisCluster>(*cluster_node_opts, benchmark_opts);
+            results.insert(results.end(), res.begin(), res.end());
+        }
+
+        auto json = sw::redis::benchmark::to_json(results);
+        if (output.empty()) {
+            std::cout << json;
+        } else {
+            std::ofstream file(output);
+            file << json;
+            if (!file) {
+                throw sw::redis::Error("Failed to write results to " + output);
+            }
+        }
+    } catch (const sw::redis::Error &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+namespace {
+
+void print_help() {
+    std::cerr << "Usage: benchmark_redis++ -h host -p port"
+        << " -n cluster_node -c cluster_port [-a auth] [-t thread_num] [-r request_num]"
+        << " [-k key_num] [-s pool_size,...] [-v val_len,...] [-b batch_size,...]"
+        << " [-w workload,...] [-o output] [-m [-l latency_us]]\n\n";
+    std::cerr << "Workloads: set, get, incr, lpush, lrange, hset, hget, sadd, zadd,"
+        << " pipeline, transaction\n\n";
+    std::cerr << "See https://github.com/sewenew/redis-plus-plus#performance"
+        << " for details on how to run benchmark" << std::endl;
+}
+
+auto parse_options(int argc, char **argv)
+    -> std::tuple<sw::redis::Optional<sw::redis::ConnectionOptions>,
+                    sw::redis::Optional<sw::redis::ConnectionOptions>,
+                    sw::redis::benchmark::BenchmarkOptions,
+                    std::string,
+                    sw::redis::Optional<std::chrono::microseconds>> {
+    std::string host;
+    int port = 0;
+    std::string auth;
+    std::string cluster_node;
+    int cluster_port = 0;
+    std::string output;
+    bool mock = false;
+    long long mock_latency = 0;
+    sw::redis::benchmark::BenchmarkOptions benchmark_opts;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "h:p:a:n:c:t:r:k:s:v:b:w:o:ml:")) != -1) {
+        try {
+            switch (opt) {
+            case 'h':
+                host = optarg;
+                break;
+
+            case 'p':
+                port = std::stoi(optarg);
+                break;
+
+            case 'a':
+                auth = optarg;
+                break;
+
+            case 'n':
+                cluster_node = optarg;
+                break;
+
+            case 'c':
+                cluster_port = std::stoi(optarg);
+                break;
+
+            case 't':
+                benchmark_opts.thread_num = std::stoul(optarg);
+                break;
+
+            case 'r':
+                benchmark_opts.request_num = std::stoul(optarg);
+                break;
+
+            case 'k':
+                benchmark_opts.key_num = std::stoul(optarg);
+                break;
+
+            case 's':
+                benchmark_opts.pool_sizes = split_sizes(optarg);
+                break;
+
+            case 'v':
+                benchmark_opts.val_lens = split_sizes(optarg);
+                break;
+
+            case 'b':
+                benchmark_opts.batch_sizes = split_sizes(optarg);
+                break;
+
+            case 'w':
+                benchmark_opts.workloads = split(optarg);
+                break;
+
+            case 'o':
+                output = optarg;
+                break;
+
+            case 'm':
+                mock = true;
+                break;
+
+            case 'l':
+                mock_latency = std::stoll(optarg);
+                break;
+
+            default:
+                throw sw::redis::Error("Unknow command line option");
+                break;
+            }
+        } catch (const sw::redis::Error &e) {
+            print_help();
+            throw;
+        } catch (const std::exception &e) {
+            print_help();
+            throw sw::redis::Error("Invalid command line option");
+        }
+    }
+
+    sw::redis::Optional<sw::redis::ConnectionOptions> opts;
+    if (!host.empty() && port > 0) {
+        sw::redis::ConnectionOptions tmp;
+        tmp.host = host;
+        tmp.port = port;
+        tmp.password = auth;
+
+        opts = sw::redis::Optional<sw::redis::ConnectionOptions>(tmp);
+    }
+
+    sw::redis::Optional<sw::redis::ConnectionOptions> cluster_opts;
+    if (!cluster_node.empty() && cluster_port > 0) {
+        sw::redis::ConnectionOptions tmp;
+        tmp.host = cluster_node;
+        tmp.port = cluster_port;
+        tmp.password = auth;
+
+        cluster_opts = sw::redis::Optional<sw::redis::ConnectionOptions>(tmp);
+    }
+
+    if (!opts && !cluster_opts && !mock) {
+        print_help();
+        throw sw::redis::Error("Invalid connection options");
+    }
+
+    sw::redis::Optional<std::chrono::microseconds> latency;
+    if (mock) {
+        latency = sw::redis::Optional<std::chrono::microseconds>(mock_latency);
+    }
+
+    return std::make_tuple(std::move(opts),
+                            std::move(cluster_opts),
+                            std::move(benchmark_opts),
+                            std::move(output),
+                            std::move(latency));
+}
+
+void start_mock_servers(std::chrono::microseconds latency, MockServers &servers) {
+    using sw::redis::test::MockServer;
+
+    auto start = [latency]() {
+        std::unique_ptr<MockServer> server(new MockServer);
+        server->set_latency(latency);
+
+        // Canned replies of commands that MockServer doesn't keep in memory.
+        server->set_reply("LPUSH", MockServer::integer(1));
+        server->set_reply("LRANGE",
+                MockServer::array(std::vector<std::string>(10, MockServer::bulk("x"))));
+        server->set_reply("HSET", MockServer::integer(1));
+        server->set_reply("HGET", MockServer::bulk("x"));
+        server->set_reply("SADD", MockServer::integer(1));
+        server->set_reply("ZADD", MockServer::integer(1));
+
+        return server;
+    };
+
+    servers.standalone = start();
+
+    // A cluster of 3 masters, and slots are evenly distributed.
+    const std::size_t MASTER_NUM = 3;
+    const std::size_t SLOT_NUM = 16384;
+    sw::redis::Shards shards;
+    for (std::size_t idx = 0; idx != MASTER_NUM; ++idx) {
+        servers.cluster.push_back(start());
+
+        sw::redis::SlotRange range{SLOT_NUM * idx / MASTER_NUM,
+                                    SLOT_NUM * (idx + 1) / MASTER_NUM - 1};
+        shards.emplace(range, servers.cluster.back()->node());
+    }
+
+    for (auto &server : servers.cluster) {
+        server->set_cluster_slots(shards);
+    }
+}
+
+std::vector<std::string> split(const std::string &str) {
+    std::vector<std::string> res;
+    std::istringstream is(str);
+    std::string item;
+    while (std::getline(is, item, ',')) {
+        if (!item.empty()) {
+            res.push_back(item);
+        }
+    }
+
+    return res;
+}
+
+std::vector<std::size_t> split_sizes(const std::string &str) {
+    std::vector<std::size_t> res;
+    for (const auto &item : split(str)) {
+        res.push_back(std::stoul(item));
+    }
+
+    return res;
+}
+
+template <typename RedisInstance>
+std::vector<sw::redis::benchmark::BenchmarkResult> run_benchmark(
+        const sw::redis::ConnectionOptions &opts,
+        const sw::redis::benchmark::BenchmarkOptions &benchmark_opts) {
+    sw::redis::benchmark::Benchmark<RedisInstance> benchmark(benchmark_opts, opts);
+
+    // Progress goes to stderr, so that stdout only has the JSON results.
+    return benchmark.run([](const sw::redis::benchmark::BenchmarkResult &result) {
+                const auto &bench_case = result.bench_case;
+                std::cerr << "  " << bench_case.workload
+                    << " pool_size=" << bench_case.pool_size
+                    << " val_len=" << bench_case.val_len
+                    << " batch_size=" << bench_case.batch_size
+                    << ": " << static_cast<long long>(result.ops_per_sec()) << " ops/s"
+                    << ", p50 " << result.latency.percentile(50).count() << "us"
+                    << ", p99 " << result.latency.percentile(99).count() << "us"
+                    << ", p999 " << result.latency.percentile(99.9).count() << "us"
+                    << ", errors " << result.errors << std::endl;
+            });
+}
+
+}
@@ -0,0 +1,126 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "micro_benchmark.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// Stop growing iterations, if a benchmark runs too slowly.
+const std::size_t MAX_ITERATIONS = 1000000000;
+
+}
+
+namespace sw {
+
+namespace redis {
+
+namespace benchmark {
+
+bool State::_keep_running() {
+    if (_left == _iterations && _left != 0) {
+        --_left;
+        _start = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    _stop = std::chrono::steady_clock::now();
+
+    return false;
+}
+
+std::string to_json(const std::vector<MicroBenchmarkResult> &results) {
+    std::ostringstream os;
+    os << "[";
+    for (std::size_t idx = 0; idx != results.size(); ++idx) {
+        const auto &result = results[idx];
+
+        // Names are in the form of "group/name", i.e. no character needs to be escaped.
+        os << (idx == 0 ? "\n  " : ",\n  ");
+        os << "{\"name\": \"" << result.name << "\""
+            << ", \"iterations\": " << result.iterations
+            << ", \"ns_per_iteration\": " << result.ns_per_iteration
+            << ", \"items_per_sec\": " << static_cast<long long>(result.items_per_sec)
+            << ", \"bytes_per_sec\": " << static_cast<long long>(result.bytes_per_sec)
+            << "}";
+    }
+    os << "\n]\n";
+
+    return os.str();
+}
+
+void MicroBenchmark::add(const std::string &name, Func func) {
+    _benchmarks.push_back(Benchmark{name, std::move(func)});
+}
+
+std::vector<MicroBenchmarkResult> MicroBenchmark::run(const std::string &filter,
+                        std::chrono::milliseconds min_time,
+                        const std::function<void (const MicroBenchmarkResult &)> &on_result) {
+    std::vector<MicroBenchmarkResult> results;
+    for (const auto &benchmark : _benchmarks) {
+        if (benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        results.push_back(_run(benchmark, min_time));
+
+        on_result(results.back());
+    }
+
+    return results;
+}
+
+MicroBenchmarkResult MicroBenchmark::_run(const Benchmark &benchmark,
+                                            std::chrono::milliseconds min_time) {
+    std::size_t iterations = 1;
+    while (true) {
+        State state(iterations);
+        benchmark.func(state);
+
+        auto elapsed = state.elapsed();
+        if (elapsed >= min_time || iterations >= MAX_ITERATIONS) {
+            MicroBenchmarkResult result;
+            result.name = benchmark.name;
+            result.iterations = iterations;
+            result.ns_per_iteration = static_cast<double>(elapsed.count()) / iterations;
+
+            auto seconds = std::chrono::duration<double>(elapsed).count();
+            if (seconds > 0) {
+                result.items_per_sec = state.items_per_iteration() * iterations / seconds;
+                result.bytes_per_sec = state.bytes_per_iteration() * iterations / seconds;
+            }
+
+            return result;
+        }
+
+        // Predict the number of iterations that runs for *min_time*, with 40% margin,
+        // but grow at most 10 times each round, since the prediction can be inaccurate
+        // when the elapsed time is small.
+        auto ns = std::max<double>(static_cast<double>(elapsed.count()), 1);
+        auto min_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(min_time).count();
+        auto predicted = static_cast<std::size_t>(iterations * min_ns * 1.4 / ns);
+
+        iterations = std::min(std::max(predicted, iterations + 1),
+                                std::min(iterations * 10, MAX_ITERATIONS));
+    }
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,149 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_BENCHMARK_MICRO_BENCHMARK_H
+#define SEWENEW_REDISPLUSPLUS_BENCHMARK_MICRO_BENCHMARK_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sw {
+
+namespace redis {
+
+namespace benchmark {
+
+// Prevent the compiler from optimizing away the computation of *val*.
+template <typename T>
+inline void do_not_optimize(const T &val) {
+    asm volatile("" : : "r,m"(val) : "memory");
+}
+
+// Passed to each micro-benchmark, which runs its code in a loop:
+//
+// void bench(State &state) {
+//     // Setup is NOT timed.
+//     while (state.keep_running()) {
+//         // Code to measure.
+//     }
+// }
+class State {
+public:
+    explicit State(std::size_t iterations) : _iterations(iterations), _left(iterations) {}
+
+    bool keep_running() {
+        if (_left != 0 && _left != _iterations) {
+            --_left;
+            return true;
+        }
+
+        // The first and the last call.
+        return _keep_running();
+    }
+
+    std::size_t iterations() const {
+        return _iterations;
+    }
+
+    // Number of items, e.g. keys, processed by each iteration.
+    void set_items_per_iteration(std::size_t items) {
+        _items = items;
+    }
+
+    // Number of bytes processed by each iteration.
+    void set_bytes_per_iteration(std::size_t bytes) {
+        _bytes = bytes;
+    }
+
+    std::size_t items_per_iteration() const {
+        return _items;
+    }
+
+    std::size_t bytes_per_iteration() const {
+        return _bytes;
+    }
+
+    std::chrono::nanoseconds elapsed() const {
+        return _stop - _start;
+    }
+
+private:
+    bool _keep_running();
+
+    std::size_t _iterations;
+
+    std::size_t _left;
+
+    std::size_t _items = 0;
+
+    std::size_t _bytes = 0;
+
+    std::chrono::steady_clock::time_point _start;
+
+    std::chrono::steady_clock::time_point _stop;
+};
+
+struct MicroBenchmarkResult {
+    std::string name;
+
+    std::size_t iterations = 0;
+
+    double ns_per_iteration = 0;
+
+    // 0, if the benchmark doesn't set the items or bytes processed.
+    double items_per_sec = 0;
+
+    double bytes_per_sec = 0;
+};
+
+// Encode results as a JSON array, one object per benchmark.
+std::string to_json(const std::vector<MicroBenchmarkResult> &results);
+
+// A minimal harness in the style of Google Benchmark, so that we don't need extra dependency.
+// Each benchmark runs with an increasing number of iterations, until it runs long enough.
+class MicroBenchmark {
+public:
+    using Func = std::function<void (State &state)>;
+
+    void add(const std::string &name, Func func);
+
+    // Run benchmarks whose name contains *filter*, and each for at least *min_time*.
+    // *on_result* is called after each benchmark is done.
+    std::vector<MicroBenchmarkResult> run(const std::string &filter,
+                        std::chrono::milliseconds min_time,
+                        const std::function<void (const MicroBenchmarkResult &)> &on_result);
+
+private:
+    struct Benchmark {
+        std::string name;
+
+        Func func;
+    };
+
+    MicroBenchmarkResult _run(const Benchmark &benchmark, std::chrono::milliseconds min_time);
+
+    std::vector<Benchmark> _benchmarks;
+};
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_BENCHMARK_MICRO_BENCHMARK_H
@@ -0,0 +1,380 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+#include <sw/redis++/redis++.h>
+#include "micro_benchmark.h"
+
+namespace {
+
+void print_help();
+
+void add_cmd_args_benchmarks(sw::redis::benchmark::MicroBenchmark &benchmark);
+
+void add_encode_benchmarks(sw::redis::benchmark::MicroBenchmark &benchmark);
+
+void add_parse_benchmarks(sw::redis::benchmark::MicroBenchmark &benchmark);
+
+void add_slot_benchmarks(sw::redis::benchmark::MicroBenchmark &benchmark);
+
+// Build a reply from RESP encoded *data*, i.e. the way hiredis builds replies from the socket.
+sw::redis::ReplyUPtr make_reply(const std::string &data);
+
+std::string bulk(const std::string &str);
+
+// Flat array reply, e.g. reply of HGETALL, with *num* fields and values.
+std::string kv_array(std::size_t num, std::size_t val_len);
+
+}
+
+int main(int argc, char **argv) {
+    try {
+        std::string filter;
+        std::chrono::milliseconds min_time(500);
+        std::string output;
+
+        int opt = 0;
+        while ((opt = getopt(argc, argv, "f:t:o:")) != -1) {
+            try {
+                switch (opt) {
+                case 'f':
+                    filter = optarg;
+                    break;
+
+                case 't':
+                    min_time = std::chrono::milliseconds(std::stoll(optarg));
+                    break;
+
+                case 'o':
+                    output = optarg;
+                    break;
+
+                default:
+                    throw sw::redis::Error("Unknow command line option");
+                    break;
+                }
+            } catch (const sw::redis::Error &e) {
+                print_help();
+                throw;
+            } catch (const std::exception &e) {
+                print_help();
+                throw sw::redis::Error("Invalid command line option");
+            }
+        }
+
+        sw::redis::benchmark::MicroBenchmark benchmark;
+        add_cmd_args_benchmarks(benchmark);
+        add_encode_benchmarks(benchmark);
+        add_parse_benchmarks(benchmark);
+        add_slot_benchmarks(benchmark);
+
+        std::printf("%-40s %14s %14s %16s\n", "Benchmark", "Time(ns)", "Iterations", "Items/s");
+        auto results = benchmark.run(filter, min_time,
+                [](const sw::redis::benchmark::MicroBenchmarkResult &result) {
+                    std::printf("%-40s %14.1f %14zu %16.0f\n",
+                            result.name.c_str(),
+                            result.ns_per_iteration,
+                            result.iterations,
+                            result.items_per_sec);
+                    std::fflush(stdout);
+                });
+
+        if (!output.empty()) {
+            std::ofstream file(output);
+            file << sw::redis::benchmark::to_json(results);
+            if (!file) {
+                throw sw::redis::Error("Failed to write results to " + output);
+            }
+        }
+    } catch (const sw::redis::Error &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+namespace {
+
+using sw::redis::benchmark::MicroBenchmark;
+using sw::redis::benchmark::State;
+using sw::redis::benchmark::do_not_optimize;
+
+void print_help() {
+    std::cerr << "Usage: micro_benchmark_redis++ [-f filter] [-t min_time_ms] [-o output]\n\n";
+    std::cerr << "Only benchmarks whose name contains *filter* are run, and results are"
+        << " written to *output* as JSON." << std::endl;
+}
+
+void add_cmd_args_benchmarks(MicroBenchmark &benchmark) {
+    // Arguments built by cmd::set.
+    benchmark.add("cmd_args/set", [](State &state) {
+                std::string key(16, 'k');
+                std::string val(64, 'v');
+                while (state.keep_running()) {
+                    sw::redis::CmdArgs args;
+                    args << "SET" << key << val << "PX" << 1000LL;
+                    do_not_optimize(args.argv());
+                }
+            });
+
+    // Arguments built by cmd::mset with a range of key-value pairs.
+    benchmark.add("cmd_args/mset_100", [](State &state) {
+                std::vector<std::pair<std::string, std::string>> kvs;
+                for (auto idx = 0; idx != 100; ++idx) {
+                    kvs.emplace_back("key" + std::to_string(idx), std::string(64, 'v'));
+                }
+
+                state.set_items_per_iteration(kvs.size());
+                while (state.keep_running()) {
+                    sw::redis::CmdArgs args;
+                    args << "MSET" << std::make_pair(kvs.begin(), kvs.end());
+                    do_not_optimize(args.argv());
+                }
+            });
+
+    // Arguments built by cmd::zadd with numbers.
+    benchmark.add("cmd_args/zadd_100", [](State &state) {
+                std::vector<std::pair<std::string, double>> members;
+                for (auto idx = 0; idx != 100; ++idx) {
+                    members.emplace_back("member" + std::to_string(idx), idx * 1.5);
+                }
+
+                state.set_items_per_iteration(members.size());
+                while (state.keep_running()) {
+                    sw::redis::CmdArgs args;
+                    args << "ZADD" << "key";
+                    for (const auto &member : members) {
+                        args << member.second << member.first;
+                    }
+                    do_not_optimize(args.argv());
+                }
+            });
+
+    benchmark.add("cmd_args/tuple", [](State &state) {
+                auto fields = std::make_tuple(std::string("field"), 100LL, 3.14);
+                while (state.keep_running()) {
+                    sw::redis::CmdArgs args;
+                    args << "HSET" << "key" << fields;
+                    do_not_optimize(args.argv());
+                }
+            });
+}
+
+void add_encode_benchmarks(MicroBenchmark &benchmark) {
+    // RESP encoding of commands built with CmdArgs.
+    benchmark.add("encode/argv_set", [](State &state) {
+                std::string key(16, 'k');
+                std::string val(64, 'v');
+                sw::redis::CmdArgs args;
+                args << "SET" << key << val;
+
+                while (state.keep_running()) {
+                    char *cmd = nullptr;
+                    auto len = redisFormatCommandArgv(&cmd,
+                                                        static_cast<int>(args.size()),
+                                                        args.argv(),
+                                                        args.argv_len());
+                    do_not_optimize(len);
+                    redisFreeCommand(cmd);
+                }
+            });
+
+    // RESP encoding of commands sent with a format string, e.g. cmd::setex.
+    benchmark.add("encode/format_setex", [](State &state) {
+                std::string key(16, 'k');
+                std::string val(64, 'v');
+                while (state.keep_running()) {
+                    char *cmd = nullptr;
+                    auto len = redisFormatCommand(&cmd, "SETEX %b %lld %b",
+                                                    key.data(), key.size(),
+                                                    100LL,
+                                                    val.data(), val.size());
+                    do_not_optimize(len);
+                    redisFreeCommand(cmd);
+                }
+            });
+}
+
+void add_parse_benchmarks(MicroBenchmark &benchmark) {
+    benchmark.add("parse/string_1k", [](State &state) {
+                auto reply = make_reply(bulk(std::string(1024, 'x')));
+
+                state.set_bytes_per_iteration(1024);
+                while (state.keep_running()) {
+                    auto str = sw::redis::reply::parse<std::string>(*reply);
+                    do_not_optimize(str);
+                }
+            });
+
+    benchmark.add("parse/vector_100", [](State &state) {
+                std::string data = "*100\r\n";
+                for (auto idx = 0; idx != 100; ++idx) {
+                    data += bulk(std::string(16, 'x'));
+                }
+                auto reply = make_reply(data);
+
+                state.set_items_per_iteration(100);
+                while (state.keep_running()) {
+                    auto vec = sw::redis::reply::parse<std::vector<std::string>>(*reply);
+                    do_not_optimize(vec);
+                }
+            });
+
+    // Flat array of fields and values is converted to a map, e.g. HGETALL.
+    benchmark.add("parse/unordered_map_100", [](State &state) {
+                auto reply = make_reply(kv_array(100, 16));
+
+                state.set_items_per_iteration(100);
+                while (state.keep_running()) {
+                    auto map = sw::redis::reply::parse<
+                                    std::unordered_map<std::string, std::string>>(*reply);
+                    do_not_optimize(map);
+                }
+            });
+
+    benchmark.add("parse/tuple", [](State &state) {
+                auto reply = make_reply("*3\r\n" + bulk("field") + ":100\r\n$-1\r\n");
+
+                while (state.keep_running()) {
+                    auto tup = sw::redis::reply::parse<
+                        std::tuple<std::string, long long, sw::redis::OptionalString>>(*reply);
+                    do_not_optimize(tup);
+                }
+            });
+
+    benchmark.add("to_array/strings_100", [](State &state) {
+                auto reply = make_reply(kv_array(50, 16));
+
+                state.set_items_per_iteration(100);
+                while (state.keep_running()) {
+                    std::vector<std::string> vec;
+                    sw::redis::reply::to_array(*reply, std::back_inserter(vec));
+                    do_not_optimize(vec);
+                }
+            });
+
+    // The output iterator is detected as kv pairs, and elements are parsed in pairs.
+    benchmark.add("to_array/kv_pairs_100", [](State &state) {
+                auto reply = make_reply(kv_array(100, 16));
+
+                state.set_items_per_iteration(100);
+                while (state.keep_running()) {
+                    std::vector<std::pair<std::string, std::string>> vec;
+                    sw::redis::reply::to_array(*reply, std::back_inserter(vec));
+                    do_not_optimize(vec);
+                }
+            });
+}
+
+void add_slot_benchmarks(MicroBenchmark &benchmark) {
+    for (auto len : {16, 64, 1024}) {
+        benchmark.add("crc16/" + std::to_string(len), [len](State &state) {
+                    std::string key(len, 'k');
+
+                    state.set_bytes_per_iteration(key.size());
+                    while (state.keep_running()) {
+                        auto crc = sw::redis::crc16(key.data(), static_cast<int>(key.size()));
+                        do_not_optimize(crc);
+                    }
+                });
+    }
+
+    // ShardsPool::slot doesn't need a connection, so a default constructed pool works.
+    benchmark.add("slot/key", [](State &state) {
+                sw::redis::ShardsPool pool;
+                std::vector<std::string> keys;
+                for (auto idx = 0; idx != 100; ++idx) {
+                    keys.push_back("user:" + std::to_string(idx) + ":profile");
+                }
+
+                state.set_items_per_iteration(keys.size());
+                while (state.keep_running()) {
+                    for (const auto &key : keys) {
+                        do_not_optimize(pool.slot(key));
+                    }
+                }
+            });
+
+    benchmark.add("slot/hash_tag", [](State &state) {
+                sw::redis::ShardsPool pool;
+                std::vector<std::string> keys;
+                for (auto idx = 0; idx != 100; ++idx) {
+                    keys.push_back("{user:" + std::to_string(idx) + "}:profile");
+                }
+
+                state.set_items_per_iteration(keys.size());
+                while (state.keep_running()) {
+                    for (const auto &key : keys) {
+                        do_not_optimize(pool.slot(key));
+                    }
+                }
+            });
+
+    benchmark.add("slot/batch", [](State &state) {
+                sw::redis::ShardsPool pool;
+                std::vector<std::string> keys;
+                for (auto idx = 0; idx != 100; ++idx) {
+                    keys.push_back("user:" + std::to_string(idx) + ":profile");
+                }
+
+                std::vector<sw::redis::Slot> slots(keys.size());
+
+                state.set_items_per_iteration(keys.size());
+                while (state.keep_running()) {
+                    pool.slots(keys.begin(), keys.end(), slots.begin());
+                    do_not_optimize(slots.data());
+                }
+            });
+}
+
+sw::redis::ReplyUPtr make_reply(const std::string &data) {
+    std::unique_ptr<redisReader, void (*)(redisReader *)> reader(redisReaderCreate(),
+                                                                    redisReaderFree);
+    if (!reader) {
+        throw sw::redis::Error("Failed to create reader");
+    }
+
+    void *reply = nullptr;
+    if (redisReaderFeed(reader.get(), data.data(), data.size()) != REDIS_OK
+            || redisReaderGetReply(reader.get(), &reply) != REDIS_OK
+            || reply == nullptr) {
+        throw sw::redis::ProtoError("Failed to parse reply: " + data);
+    }
+
+    return sw::redis::ReplyUPtr(static_cast<redisReply*>(reply));
+}
+
+std::string bulk(const std::string &str) {
+    return "$" + std::to_string(str.size()) + "\r\n" + str + "\r\n";
+}
+
+std::string kv_array(std::size_t num, std::size_t val_len) {
+    auto data = "*" + std::to_string(num * 2) + "\r\n";
+    for (std::size_t idx = 0; idx != num; ++idx) {
+        data += bulk("field" + std::to_string(idx));
+        data += bulk(std::string(val_len, 'v'));
+    }
+
+    return data;
+}
+
+}
@@ -0,0 +1,384 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "async_connection.h"
+#include <cassert>
+
+namespace sw {
+
+namespace redis {
+
+FormattedCommand::FormattedCommand(CmdArgs &args) {
+    auto len = redisFormatCommandArgv(&_data,
+                                        static_cast<int>(args.size()),
+                                        args.argv(),
+                                        args.argv_len());
+    if (len < 0 || _data == nullptr) {
+        throw Error("Failed to format command");
+    }
+
+    _size = static_cast<std::size_t>(len);
+}
+
+AsyncConnection::AsyncConnection(EventLoop &loop, const ConnectionOptions &opts) :
+                                    _loop(&loop),
+                                    _opts(opts) {}
+
+AsyncConnection::~AsyncConnection() {
+    _close();
+}
+
+void AsyncConnection::send(AsyncEventUPtr event) {
+    assert(event);
+
+    auto self = shared_from_this();
+
+    // std::function requires a copyable callable, so pass the raw pointer,
+    // and the task takes the ownership. Tasks are always run, even if the loop stops.
+    auto *ev = event.release();
+    _loop->post([self, ev]() { self->_send(AsyncEventUPtr(ev), false); });
+}
+
+void AsyncConnection::asking(AsyncEventUPtr event) {
+    assert(event);
+
+    auto self = shared_from_this();
+
+    auto *ev = event.release();
+    _loop->post([self, ev]() { self->_send(AsyncEventUPtr(ev), true); });
+}
+
+void AsyncConnection::close(std::shared_ptr<AsyncConnection> connection) {
+    if (!connection) {
+        return;
+    }
+
+    auto *loop = connection->_loop;
+    loop->post([connection]() { connection->_close(); });
+}
+
+void AsyncConnection::_connect_callback(const redisAsyncContext *ctx, int status) {
+    assert(ctx != nullptr);
+
+    auto *connection = static_cast<AsyncConnection*>(ctx->data);
+    if (connection == nullptr || connection->_ctx != ctx) {
+        return;
+    }
+
+    // Connected or failed, and either way, the connect timeout no longer applies.
+    connection->_loop->cancel_timer(*ctx);
+
+    if (status != REDIS_OK) {
+        // hiredis frees the context after this callback returns.
+        connection->_ctx = nullptr;
+        connection->_state = State::DISCONNECTED;
+        connection->_fail_pending(_error(*ctx));
+    }
+}
+
+void AsyncConnection::_disconnect_callback(const redisAsyncContext *ctx, int /*status*/) {
+    assert(ctx != nullptr);
+
+    auto *connection = static_cast<AsyncConnection*>(ctx->data);
+    if (connection == nullptr || connection->_ctx != ctx) {
+        return;
+    }
+
+    // hiredis frees the context after this callback returns.
+    connection->_ctx = nullptr;
+    connection->_state = State::DISCONNECTED;
+    connection->_fail_pending(_error(*ctx));
+}
+
+void AsyncConnection::_setup_callback(redisAsyncContext *ctx, void *r, void * /*privdata*/) {
+    assert(ctx != nullptr);
+
+    auto *connection = static_cast<AsyncConnection*>(ctx->data);
+    if (connection == nullptr
+            || connection->_ctx != ctx
+            || connection->_state != State::CONNECTING) {
+        return;
+    }
+
+    auto *reply = static_cast<redisReply*>(r);
+    if (reply == nullptr) {
+        // The context is being freed, and pending events will be failed by
+        // the disconnect callback.
+        return;
+    }
+
+    if (reply::is_error(*reply)) {
+        auto err = std::make_exception_ptr(
+                Error("Failed to setup connection: " + std::string(reply->str, reply->len)));
+
+        // The context is freed after this callback returns.
+        connection->_ctx = nullptr;
+        connection->_state = State::DISCONNECTED;
+        redisAsyncFree(ctx);
+
+        connection->_fail_pending(err);
+
+        return;
+    }
+
+    assert(connection->_setup_replies > 0);
+
+    if (--(connection->_setup_replies) == 0) {
+        connection->_state = State::READY;
+        connection->_send_pending();
+    }
+}
+
+void AsyncConnection::_reply_callback(redisAsyncContext *ctx, void *r, void *privdata) {
+    assert(ctx != nullptr && privdata != nullptr);
+
+    AsyncEventUPtr event(static_cast<AsyncEvent*>(privdata));
+
+    auto *reply = static_cast<redisReply*>(r);
+    if (reply == nullptr) {
+        // If the event loop is broken, report why.
+        auto *connection = static_cast<AsyncConnection*>(ctx->data);
+        std::exception_ptr err;
+        if (connection != nullptr) {
+            err = connection->_loop->error();
+        }
+
+        event->set_exception(err ? err : _error(*ctx));
+    } else {
+        // hiredis frees the reply after this callback returns.
+        event->set_value(*reply);
+    }
+}
+
+std::exception_ptr AsyncConnection::_error(const redisAsyncContext &ctx) {
+    if (ctx.err == REDIS_OK) {
+        return std::make_exception_ptr(ClosedError("Connection is closed"));
+    }
+
+    auto err_msg = std::string("Connection is broken: ")
+                    + (ctx.errstr != nullptr ? ctx.errstr : "unknown error");
+
+    switch (ctx.err) {
+    case REDIS_ERR_IO:
+        return std::make_exception_ptr(IoError(err_msg));
+
+    case REDIS_ERR_EOF:
+        return std::make_exception_ptr(ClosedError(err_msg));
+
+    case REDIS_ERR_PROTOCOL:
+        return std::make_exception_ptr(ProtoError(err_msg));
+
+    case REDIS_ERR_OOM:
+        return std::make_exception_ptr(OomError(err_msg));
+
+    default:
+        return std::make_exception_ptr(Error(err_msg));
+    }
+}
+
+void AsyncConnection::_send(AsyncEventUPtr event, bool asking) {
+    assert(_loop->in_loop_thread());
+
+    auto err = _loop->error();
+    if (err) {
+        // The loop no longer polls sockets, so the connection is unusable.
+        event->set_exception(err);
+        return;
+    }
+
+    if (_state == State::DISCONNECTED) {
+        try {
+            _connect();
+        } catch (...) {
+            event->set_exception(std::current_exception());
+            return;
+        }
+    }
+
+    if (_state == State::CONNECTING) {
+        _pending.emplace_back(std::move(event), asking);
+        return;
+    }
+
+    _send_event(std::move(event), asking);
+}
+
+void AsyncConnection::_send_event(AsyncEventUPtr event, bool asking) {
+    assert(_state == State::READY && _ctx != nullptr);
+
+    if (asking) {
+        static const std::string ASKING_CMD = "*1\r\n$6\r\nASKING\r\n";
+
+        // The reply of ASKING is ignored, and the command itself reports errors, if any.
+        if (!_send_command(ASKING_CMD.data(), ASKING_CMD.size(), nullptr, nullptr)) {
+            event->set_exception(std::make_exception_ptr(Error("Failed to send ASKING command")));
+            return;
+        }
+    }
+
+    const auto &cmd = event->cmd();
+    if (!_send_command(cmd.data(), cmd.size(), _reply_callback, event.get())) {
+        event->set_exception(std::make_exception_ptr(Error("Failed to send command")));
+        return;
+    }
+
+    // The reply callback takes the ownership.
+    event.release();
+}
+
+void AsyncConnection::_connect() {
+    assert(_ctx == nullptr);
+
+    redisAsyncContext *ctx = nullptr;
+    switch (_opts.type) {
+    case ConnectionType::TCP:
+        ctx = redisAsyncConnect(_opts.host.c_str(), _opts.port);
+        break;
+
+    case ConnectionType::UNIX:
+        ctx = redisAsyncConnectUnix(_opts.path.c_str());
+        break;
+
+    default:
+        throw Error("Unknown connection type: " + std::to_string(static_cast<int>(_opts.type)));
+    }
+
+    if (ctx == nullptr) {
+        throw Error("Failed to allocate memory for connection.");
+    }
+
+    if (ctx->err != REDIS_OK) {
+        auto err = _error(*ctx);
+        redisAsyncFree(ctx);
+        std::rethrow_exception(err);
+    }
+
+    ctx->data = this;
+    _ctx = ctx;
+
+    // Event hooks MUST be installed before setting the connect callback,
+    // which waits for the first write event.
+    _loop->attach(*ctx, [this](std::exception_ptr err) { this->_break(err); });
+
+    // hiredis' async API ignores the connect timeout, so fail the connection by ourselves.
+    if (_opts.connect_timeout > std::chrono::milliseconds(0)) {
+        _loop->set_timer(*ctx, _opts.connect_timeout);
+    }
+
+    redisAsyncSetConnectCallback(ctx, _connect_callback);
+    redisAsyncSetDisconnectCallback(ctx, _disconnect_callback);
+
+    try {
+        _setup();
+    } catch (const Error &) {
+        _ctx = nullptr;
+        _state = State::DISCONNECTED;
+        redisAsyncFree(ctx);
+        throw;
+    }
+}
+
+void AsyncConnection::_setup() {
+    _setup_replies = 0;
+
+    if (!_opts.password.empty()) {
+        CmdArgs args;
+        args << "AUTH" << _opts.password;
+        FormattedCommand cmd(args);
+        if (!_send_command(cmd.data(), cmd.size(), _setup_callback, nullptr)) {
+            throw Error("Failed to send AUTH command");
+        }
+
+        ++_setup_replies;
+    }
+
+    if (_opts.db != 0) {
+        CmdArgs args;
+        args << "SELECT" << _opts.db;
+        FormattedCommand cmd(args);
+        if (!_send_command(cmd.data(), cmd.size(), _setup_callback, nullptr)) {
+            throw Error("Failed to send SELECT command");
+        }
+
+        ++_setup_replies;
+    }
+
+    // Commands sent before the connection is established are buffered by hiredis.
+    // However, they should not be sent before AUTH and SELECT succeed.
+    _state = (_setup_replies == 0) ? State::READY : State::CONNECTING;
+}
+
+void AsyncConnection::_send_pending() {
+    auto pending = std::move(_pending);
+    _pending.clear();
+
+    for (auto &event : pending) {
+        if (_state == State::READY) {
+            _send_event(std::move(event.first), event.second);
+        } else {
+            // Connection is broken while sending pending events.
+            _send(std::move(event.first), event.second);
+        }
+    }
+}
+
+void AsyncConnection::_fail_pending(std::exception_ptr err) {
+    auto pending = std::move(_pending);
+    _pending.clear();
+
+    for (auto &event : pending) {
+        event.first->set_exception(err);
+    }
+}
+
+void AsyncConnection::_close() {
+    _fail_pending(std::make_exception_ptr(ClosedError("Connection is closed")));
+
+    if (_ctx != nullptr) {
+        auto *ctx = _ctx;
+        _ctx = nullptr;
+        _state = State::DISCONNECTED;
+
+        // In-flight events are failed with a null reply.
+        redisAsyncFree(ctx);
+    }
+}
+
+void AsyncConnection::_break(std::exception_ptr err) {
+    _fail_pending(err);
+
+    if (_ctx != nullptr) {
+        auto *ctx = _ctx;
+        _ctx = nullptr;
+        _state = State::DISCONNECTED;
+
+        // In-flight events are failed with *err*, see *_reply_callback*.
+        redisAsyncFree(ctx);
+    }
+}
+
+bool AsyncConnection::_send_command(const char *cmd,
+                                    std::size_t len,
+                                    redisCallbackFn *fn,
+                                    void *privdata) {
+    assert(_ctx != nullptr);
+
+    return redisAsyncFormattedCommand(_ctx, fn, privdata, cmd, len) == REDIS_OK;
+}
+
+}
+
+}
@@ -0,0 +1,280 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_ASYNC_CONNECTION_H
+#define SEWENEW_REDISPLUSPLUS_ASYNC_CONNECTION_H
+
+#include <future>
+#include <memory>
+#include <vector>
+#include <exception>
+#include <type_traits>
+#include <hiredis/async.h>
+#include "connection.h"
+#include "command_args.h"
+#include "event_loop.h"
+#include "reply.h"
+#include "errors.h"
+
+namespace sw {
+
+namespace redis {
+
+template <typename T>
+using Future = std::future<T>;
+
+// A command in Redis protocol, which owns its memory. So that it can be sent
+// from the event loop thread, after the arguments passed by user are gone.
+class FormattedCommand {
+public:
+    explicit FormattedCommand(CmdArgs &args);
+
+    FormattedCommand(const FormattedCommand &) = delete;
+    FormattedCommand& operator=(const FormattedCommand &) = delete;
+
+    FormattedCommand(FormattedCommand &&that) noexcept {
+        _move(std::move(that));
+    }
+
+    FormattedCommand& operator=(FormattedCommand &&that) noexcept {
+        if (this != &that) {
+            _release();
+            _move(std::move(that));
+        }
+
+        return *this;
+    }
+
+    ~FormattedCommand() {
+        _release();
+    }
+
+    const char* data() const noexcept {
+        return _data;
+    }
+
+    std::size_t size() const noexcept {
+        return _size;
+    }
+
+private:
+    void _move(FormattedCommand &&that) noexcept {
+        _data = that._data;
+        _size = that._size;
+        that._data = nullptr;
+        that._size = 0;
+    }
+
+    void _release() noexcept {
+        if (_data != nullptr) {
+            redisFreeCommand(_data);
+            _data = nullptr;
+            _size = 0;
+        }
+    }
+
+    char *_data = nullptr;
+
+    std::size_t _size = 0;
+};
+
+using FormattedCommandSPtr = std::shared_ptr<const FormattedCommand>;
+
+// An in-flight command. Its methods are called in the event loop thread.
+class AsyncEvent {
+public:
+    explicit AsyncEvent(FormattedCommandSPtr cmd) : _cmd(std::move(cmd)) {}
+
+    virtual ~AsyncEvent() = default;
+
+    const FormattedCommand& cmd() const {
+        return *_cmd;
+    }
+
+    const FormattedCommandSPtr& cmd_ptr() const {
+        return _cmd;
+    }
+
+    // *reply* might be an error reply.
+    virtual void set_value(redisReply &reply) = 0;
+
+    virtual void set_exception(std::exception_ptr err) = 0;
+
+private:
+    FormattedCommandSPtr _cmd;
+};
+
+using AsyncEventUPtr = std::unique_ptr<AsyncEvent>;
+
+template <typename Result>
+struct DefaultResultParser {
+    Result operator()(redisReply &reply) const {
+        return reply::parse<Result>(reply);
+    }
+};
+
+// SET command returns OK or nil, and we convert it to bool.
+struct SetResultParser {
+    bool operator()(redisReply &reply) const {
+        reply::rewrite_set_reply(reply);
+        return reply::parse<bool>(reply);
+    }
+};
+
+// Fulfill a promise with the parsed reply.
+template <typename Result, typename ResultParser = DefaultResultParser<Result>>
+class CommandEvent : public AsyncEvent {
+public:
+    explicit CommandEvent(FormattedCommandSPtr cmd) : AsyncEvent(std::move(cmd)) {}
+
+    // If the event is destroyed without being completed, the future still gets notified.
+    virtual ~CommandEvent() {
+        if (!_done) {
+            _promise.set_exception(std::make_exception_ptr(Error("Command is dropped")));
+        }
+    }
+
+    Future<Result> get_future() {
+        return _promise.get_future();
+    }
+
+    virtual void set_value(redisReply &reply) override {
+        try {
+            if (reply::is_error(reply)) {
+                throw_error(reply);
+            }
+
+            _set_value(typename std::is_void<Result>::type(), reply);
+        } catch (...) {
+            set_exception(std::current_exception());
+            return;
+        }
+
+        _done = true;
+    }
+
+    virtual void set_exception(std::exception_ptr err) override {
+        _promise.set_exception(err);
+        _done = true;
+    }
+
+private:
+    void _set_value(std::true_type, redisReply &reply) {
+        ResultParser()(reply);
+        _promise.set_value();
+    }
+
+    void _set_value(std::false_type, redisReply &reply) {
+        _promise.set_value(ResultParser()(reply));
+    }
+
+    std::promise<Result> _promise;
+
+    bool _done = false;
+};
+
+// A connection based on *redisAsyncContext*. It connects lazily, and reconnects
+// the next time a command is sent, if the connection has been broken.
+class AsyncConnection : public std::enable_shared_from_this<AsyncConnection> {
+public:
+    // NOTE: *loop* MUST outlive the connection.
+    AsyncConnection(EventLoop &loop, const ConnectionOptions &opts);
+
+    AsyncConnection(const AsyncConnection &) = delete;
+    AsyncConnection& operator=(const AsyncConnection &) = delete;
+
+    AsyncConnection(AsyncConnection &&) = delete;
+    AsyncConnection& operator=(AsyncConnection &&) = delete;
+
+    // NOTE: it MUST be destroyed in the event loop thread, or before the connection
+    // has ever been used. See *AsyncConnection::close*.
+    ~AsyncConnection();
+
+    // Thread-safe.
+    void send(AsyncEventUPtr event);
+
+    // Thread-safe. Send ASKING and then the command, i.e. ASK redirection.
+    void asking(AsyncEventUPtr event);
+
+    // Thread-safe. Close the connection in the event loop thread, and pending events
+    // fail with exception. The last reference to *connection* is released there.
+    static void close(std::shared_ptr<AsyncConnection> connection);
+
+    const ConnectionOptions& options() const {
+        return _opts;
+    }
+
+private:
+    enum class State {
+        DISCONNECTED = 0,
+        // Connecting, or waiting for AUTH and SELECT replies.
+        CONNECTING,
+        READY
+    };
+
+    static void _connect_callback(const redisAsyncContext *ctx, int status);
+
+    static void _disconnect_callback(const redisAsyncContext *ctx, int status);
+
+    static void _setup_callback(redisAsyncContext *ctx, void *r, void *privdata);
+
+    static void _reply_callback(redisAsyncContext *ctx, void *r, void *privdata);
+
+    static std::exception_ptr _error(const redisAsyncContext &ctx);
+
+    // The following methods are called in the event loop thread.
+
+    void _send(AsyncEventUPtr event, bool asking);
+
+    void _send_event(AsyncEventUPtr event, bool asking);
+
+    void _connect();
+
+    void _setup();
+
+    void _send_pending();
+
+    void _fail_pending(std::exception_ptr err);
+
+    void _close();
+
+    // The event loop is broken, so fail all events, and free the context.
+    void _break(std::exception_ptr err);
+
+    bool _send_command(const char *cmd, std::size_t len, redisCallbackFn *fn, void *privdata);
+
+    EventLoop *_loop;
+
+    ConnectionOptions _opts;
+
+    redisAsyncContext *_ctx = nullptr;
+
+    State _state = State::DISCONNECTED;
+
+    // Number of AUTH and SELECT replies to wait for.
+    std::size_t _setup_replies = 0;
+
+    // Events sent before the connection is ready.
+    std::vector<std::pair<AsyncEventUPtr, bool>> _pending;
+};
+
+using AsyncConnectionSPtr = std::shared_ptr<AsyncConnection>;
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_ASYNC_CONNECTION_H
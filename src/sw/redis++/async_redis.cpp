@@ -0,0 +1,180 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "async_redis.h"
+#include "command.h"
+
+namespace sw {
+
+namespace redis {
+
+AsyncRedis::AsyncRedis(const ConnectionOptions &opts, std::size_t connections) :
+                        _loop(std::make_shared<EventLoop>()) {
+    if (connections == 0) {
+        throw Error("Number of connections should be larger than 0");
+    }
+
+    _connections.reserve(connections);
+    for (std::size_t idx = 0; idx != connections; ++idx) {
+        _connections.push_back(std::make_shared<AsyncConnection>(*_loop, opts));
+    }
+}
+
+AsyncRedis::AsyncRedis(const std::string &uri) : AsyncRedis(ConnectionOptions(uri)) {}
+
+AsyncRedis::~AsyncRedis() {
+    for (auto &connection : _connections) {
+        AsyncConnection::close(std::move(connection));
+    }
+
+    _connections.clear();
+
+    // Stop the event loop, after all connections have been closed.
+    _loop.reset();
+}
+
+Future<long long> AsyncRedis::del(const StringView &key) {
+    CmdArgs args;
+    args << "DEL" << key;
+
+    return _command<long long>(args);
+}
+
+Future<long long> AsyncRedis::exists(const StringView &key) {
+    CmdArgs args;
+    args << "EXISTS" << key;
+
+    return _command<long long>(args);
+}
+
+Future<bool> AsyncRedis::expire(const StringView &key, long long timeout) {
+    CmdArgs args;
+    args << "EXPIRE" << key << timeout;
+
+    return _command<bool>(args);
+}
+
+Future<long long> AsyncRedis::ttl(const StringView &key) {
+    CmdArgs args;
+    args << "TTL" << key;
+
+    return _command<long long>(args);
+}
+
+Future<long long> AsyncRedis::decr(const StringView &key) {
+    CmdArgs args;
+    args << "DECR" << key;
+
+    return _command<long long>(args);
+}
+
+Future<long long> AsyncRedis::decrby(const StringView &key, long long decrement) {
+    CmdArgs args;
+    args << "DECRBY" << key << decrement;
+
+    return _command<long long>(args);
+}
+
+Future<OptionalString> AsyncRedis::get(const StringView &key) {
+    CmdArgs args;
+    args << "GET" << key;
+
+    return _command<OptionalString>(args);
+}
+
+Future<long long> AsyncRedis::incr(const StringView &key) {
+    CmdArgs args;
+    args << "INCR" << key;
+
+    return _command<long long>(args);
+}
+
+Future<long long> AsyncRedis::incrby(const StringView &key, long long increment) {
+    CmdArgs args;
+    args << "INCRBY" << key << increment;
+
+    return _command<long long>(args);
+}
+
+Future<bool> AsyncRedis::set(const StringView &key,
+                                const StringView &val,
+                                const std::chrono::milliseconds &ttl,
+                                UpdateType type) {
+    CmdArgs args;
+    args << "SET" << key << val;
+
+    if (ttl > std::chrono::milliseconds(0)) {
+        args << "PX" << ttl.count();
+    }
+
+    cmd::detail::set_update_type(args, type);
+
+    return _command<bool, SetResultParser>(args);
+}
+
+Future<long long> AsyncRedis::lpush(const StringView &key, const StringView &val) {
+    CmdArgs args;
+    args << "LPUSH" << key << val;
+
+    return _command<long long>(args);
+}
+
+Future<long long> AsyncRedis::rpush(const StringView &key, const StringView &val) {
+    CmdArgs args;
+    args << "RPUSH" << key << val;
+
+    return _command<long long>(args);
+}
+
+Future<long long> AsyncRedis::hdel(const StringView &key, const StringView &field) {
+    CmdArgs args;
+    args << "HDEL" << key << field;
+
+    return _command<long long>(args);
+}
+
+Future<OptionalString> AsyncRedis::hget(const StringView &key, const StringView &field) {
+    CmdArgs args;
+    args << "HGET" << key << field;
+
+    return _command<OptionalString>(args);
+}
+
+Future<bool> AsyncRedis::hset(const StringView &key,
+                                const StringView &field,
+                                const StringView &val) {
+    CmdArgs args;
+    args << "HSET" << key << field << val;
+
+    return _command<bool>(args);
+}
+
+Future<long long> AsyncRedis::publish(const StringView &channel, const StringView &message) {
+    CmdArgs args;
+    args << "PUBLISH" << channel << message;
+
+    return _command<long long>(args);
+}
+
+AsyncConnection& AsyncRedis::_connection() {
+    auto idx = _idx.fetch_add(1, std::memory_order_relaxed);
+
+    return *_connections[idx % _connections.size()];
+}
+
+}
+
+}
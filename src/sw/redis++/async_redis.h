@@ -0,0 +1,152 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_H
+#define SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_H
+
+#include <string>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <initializer_list>
+#include "async_connection.h"
+#include "event_loop.h"
+#include "command_args.h"
+#include "command_options.h"
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+// AsyncRedis sends commands with hiredis' async API, and returns *Future*s.
+// All connections are driven by an internal event loop thread, and commands
+// are pipelined on these connections, i.e. a single connection can have lots
+// of outstanding commands.
+//
+// NOTE: Commands sent with the same AsyncRedis object are NOT guaranteed to be
+// executed in order, unless *connections* is 1. Also *ConnectionOptions::socket_timeout*
+// is NOT supported, i.e. use *Future::wait_for* instead. However,
+// *ConnectionOptions::connect_timeout* is supported: if the connection is NOT established
+// in time, pending commands fail with TimeoutError.
+class AsyncRedis {
+public:
+    // *connections*: number of connections to Redis. Commands are sent with these
+    // connections in a round-robin way.
+    explicit AsyncRedis(const ConnectionOptions &opts, std::size_t connections = 1);
+
+    explicit AsyncRedis(const std::string &uri);
+
+    AsyncRedis(const AsyncRedis &) = delete;
+    AsyncRedis& operator=(const AsyncRedis &) = delete;
+
+    AsyncRedis(AsyncRedis &&) = delete;
+    AsyncRedis& operator=(AsyncRedis &&) = delete;
+
+    // Close all connections, and futures of in-flight commands fail with exception.
+    ~AsyncRedis();
+
+    template <typename Result, typename ...Args>
+    Future<Result> command(const StringView &cmd_name, Args &&...args);
+
+    // KEY commands.
+
+    Future<long long> del(const StringView &key);
+
+    template <typename Input>
+    Future<long long> del(Input first, Input last);
+
+    template <typename T>
+    Future<long long> del(std::initializer_list<T> il) {
+        return del(il.begin(), il.end());
+    }
+
+    Future<long long> exists(const StringView &key);
+
+    Future<bool> expire(const StringView &key, long long timeout);
+
+    Future<bool> expire(const StringView &key, const std::chrono::seconds &timeout) {
+        return expire(key, timeout.count());
+    }
+
+    Future<long long> ttl(const StringView &key);
+
+    // STRING commands.
+
+    Future<long long> decr(const StringView &key);
+
+    Future<long long> decrby(const StringView &key, long long decrement);
+
+    Future<OptionalString> get(const StringView &key);
+
+    Future<long long> incr(const StringView &key);
+
+    Future<long long> incrby(const StringView &key, long long increment);
+
+    template <typename Output = std::vector<OptionalString>, typename Input>
+    Future<Output> mget(Input first, Input last);
+
+    template <typename Output = std::vector<OptionalString>, typename T>
+    Future<Output> mget(std::initializer_list<T> il) {
+        return mget<Output>(il.begin(), il.end());
+    }
+
+    Future<bool> set(const StringView &key,
+                        const StringView &val,
+                        const std::chrono::milliseconds &ttl = std::chrono::milliseconds(0),
+                        UpdateType type = UpdateType::ALWAYS);
+
+    // LIST commands.
+
+    Future<long long> lpush(const StringView &key, const StringView &val);
+
+    template <typename Output = std::vector<std::string>>
+    Future<Output> lrange(const StringView &key, long long start, long long stop);
+
+    Future<long long> rpush(const StringView &key, const StringView &val);
+
+    // HASH commands.
+
+    Future<long long> hdel(const StringView &key, const StringView &field);
+
+    Future<OptionalString> hget(const StringView &key, const StringView &field);
+
+    Future<bool> hset(const StringView &key, const StringView &field, const StringView &val);
+
+    // PUBSUB commands.
+
+    Future<long long> publish(const StringView &channel, const StringView &message);
+
+private:
+    template <typename Result, typename ResultParser = DefaultResultParser<Result>>
+    Future<Result> _command(CmdArgs &args);
+
+    AsyncConnection& _connection();
+
+    EventLoopSPtr _loop;
+
+    std::vector<AsyncConnectionSPtr> _connections;
+
+    std::atomic<std::size_t> _idx{0};
+};
+
+}
+
+}
+
+#include "async_redis.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_H
@@ -0,0 +1,86 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_HPP
+#define SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_HPP
+
+#include "reply.h"
+#include "utils.h"
+#include "errors.h"
+
+namespace sw {
+
+namespace redis {
+
+template <typename Result, typename ...Args>
+Future<Result> AsyncRedis::command(const StringView &cmd_name, Args &&...args) {
+    CmdArgs cmd_args;
+    cmd_args.append(cmd_name, std::forward<Args>(args)...);
+
+    return _command<Result>(cmd_args);
+}
+
+template <typename Input>
+Future<long long> AsyncRedis::del(Input first, Input last) {
+    if (first == last) {
+        throw Error("DEL: no key specified");
+    }
+
+    CmdArgs args;
+    args << "DEL" << std::make_pair(first, last);
+
+    return _command<long long>(args);
+}
+
+template <typename Output, typename Input>
+Future<Output> AsyncRedis::mget(Input first, Input last) {
+    if (first == last) {
+        throw Error("MGET: no key specified");
+    }
+
+    CmdArgs args;
+    args << "MGET" << std::make_pair(first, last);
+
+    return _command<Output>(args);
+}
+
+template <typename Output>
+Future<Output> AsyncRedis::lrange(const StringView &key, long long start, long long stop) {
+    CmdArgs args;
+    args << "LRANGE" << key << start << stop;
+
+    return _command<Output>(args);
+}
+
+template <typename Result, typename ResultParser>
+Future<Result> AsyncRedis::_command(CmdArgs &args) {
+    auto cmd = std::make_shared<FormattedCommand>(args);
+
+    using Event = CommandEvent<Result, ResultParser>;
+    std::unique_ptr<Event> event(new Event(std::move(cmd)));
+
+    auto fut = event->get_future();
+
+    _connection().send(std::move(event));
+
+    return fut;
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_HPP
@@ -0,0 +1,429 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "async_redis_cluster.h"
+#include "command.h"
+#include "shards.h"
+
+namespace sw {
+
+namespace redis {
+
+class AsyncRedisCluster::RedirectEvent : public AsyncEvent {
+public:
+    RedirectEvent(AsyncRedisCluster &cluster,
+                    std::shared_ptr<AsyncEvent> event,
+                    std::size_t redirects = 0) :
+                        AsyncEvent(event->cmd_ptr()),
+                        _cluster(cluster),
+                        _event(std::move(event)),
+                        _redirects(redirects) {}
+
+    // It's called by hiredis' reply callback, so it MUST NOT throw, and MUST NOT block.
+    virtual void set_value(redisReply &reply) override {
+        try {
+            if (reply::is_error(reply) && _redirects < MAX_REDIRECTS) {
+                try {
+                    throw_error(reply);
+                } catch (const MovedError &err) {
+                    // Only patch the moved slot, instead of refreshing the whole mapping.
+                    // It takes ShardsPool's lock, so it's done by the refresher thread.
+                    _cluster._patch(err.slot(), err.node());
+                    _redirect(err.node(), false);
+                    return;
+                } catch (const AskError &err) {
+                    _redirect(err.node(), true);
+                    return;
+                } catch (const Error &) {
+                    // Other errors are reported by the user's event.
+                }
+            }
+
+            _event->set_value(reply);
+        } catch (...) {
+            try {
+                _event->set_exception(std::current_exception());
+            } catch (...) {
+                // The user's event has been notified.
+            }
+        }
+    }
+
+    virtual void set_exception(std::exception_ptr err) override {
+        try {
+            // The node might be down, and we need to refresh the topology.
+            _cluster._mark_stale();
+        } catch (...) {
+            // The user's event should be notified anyway.
+        }
+
+        _event->set_exception(err);
+    }
+
+private:
+    void _redirect(const Node &node, bool asking) {
+        auto connection = _cluster._connection(node);
+        if (!connection) {
+            _event->set_exception(std::make_exception_ptr(Error("Cluster is closed")));
+            return;
+        }
+
+        AsyncEventUPtr event(new RedirectEvent(_cluster, _event, _redirects + 1));
+        if (asking) {
+            connection->asking(std::move(event));
+        } else {
+            connection->send(std::move(event));
+        }
+    }
+
+    AsyncRedisCluster &_cluster;
+
+    std::shared_ptr<AsyncEvent> _event;
+
+    std::size_t _redirects;
+};
+
+AsyncRedisCluster::AsyncRedisCluster(const ConnectionOptions &opts) :
+                                        _pool(ConnectionPoolOptions{}, opts),
+                                        _opts(opts),
+                                        _loop(std::make_shared<EventLoop>()) {
+    _refresher = std::thread([this]() { this->_refresh(); });
+}
+
+AsyncRedisCluster::AsyncRedisCluster(const std::string &uri) :
+                                        AsyncRedisCluster(ConnectionOptions(uri)) {}
+
+AsyncRedisCluster::~AsyncRedisCluster() {
+    // Deferred commands fail, before connections are closed.
+    _stop_refresher();
+
+    NodeMap connections;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _closing = true;
+        connections.swap(_connections);
+    }
+
+    for (auto &connection : connections) {
+        AsyncConnection::close(std::move(connection.second));
+    }
+
+    connections.clear();
+
+    // Stop the event loop, after all connections have been closed.
+    _loop.reset();
+}
+
+Future<long long> AsyncRedisCluster::del(const StringView &key) {
+    CmdArgs args;
+    args << "DEL" << key;
+
+    return _command<long long>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::exists(const StringView &key) {
+    CmdArgs args;
+    args << "EXISTS" << key;
+
+    return _command<long long>(key, args);
+}
+
+Future<bool> AsyncRedisCluster::expire(const StringView &key, long long timeout) {
+    CmdArgs args;
+    args << "EXPIRE" << key << timeout;
+
+    return _command<bool>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::ttl(const StringView &key) {
+    CmdArgs args;
+    args << "TTL" << key;
+
+    return _command<long long>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::decr(const StringView &key) {
+    CmdArgs args;
+    args << "DECR" << key;
+
+    return _command<long long>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::decrby(const StringView &key, long long decrement) {
+    CmdArgs args;
+    args << "DECRBY" << key << decrement;
+
+    return _command<long long>(key, args);
+}
+
+Future<OptionalString> AsyncRedisCluster::get(const StringView &key) {
+    CmdArgs args;
+    args << "GET" << key;
+
+    return _command<OptionalString>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::incr(const StringView &key) {
+    CmdArgs args;
+    args << "INCR" << key;
+
+    return _command<long long>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::incrby(const StringView &key, long long increment) {
+    CmdArgs args;
+    args << "INCRBY" << key << increment;
+
+    return _command<long long>(key, args);
+}
+
+Future<bool> AsyncRedisCluster::set(const StringView &key,
+                                    const StringView &val,
+                                    const std::chrono::milliseconds &ttl,
+                                    UpdateType type) {
+    CmdArgs args;
+    args << "SET" << key << val;
+
+    if (ttl > std::chrono::milliseconds(0)) {
+        args << "PX" << ttl.count();
+    }
+
+    cmd::detail::set_update_type(args, type);
+
+    return _command<bool, SetResultParser>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::lpush(const StringView &key, const StringView &val) {
+    CmdArgs args;
+    args << "LPUSH" << key << val;
+
+    return _command<long long>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::rpush(const StringView &key, const StringView &val) {
+    CmdArgs args;
+    args << "RPUSH" << key << val;
+
+    return _command<long long>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::hdel(const StringView &key, const StringView &field) {
+    CmdArgs args;
+    args << "HDEL" << key << field;
+
+    return _command<long long>(key, args);
+}
+
+Future<OptionalString> AsyncRedisCluster::hget(const StringView &key, const StringView &field) {
+    CmdArgs args;
+    args << "HGET" << key << field;
+
+    return _command<OptionalString>(key, args);
+}
+
+Future<bool> AsyncRedisCluster::hset(const StringView &key,
+                                        const StringView &field,
+                                        const StringView &val) {
+    CmdArgs args;
+    args << "HSET" << key << field << val;
+
+    return _command<bool>(key, args);
+}
+
+Future<long long> AsyncRedisCluster::publish(const StringView &channel,
+                                                const StringView &message) {
+    CmdArgs args;
+    args << "PUBLISH" << channel << message;
+
+    return _command<long long>(channel, args);
+}
+
+void AsyncRedisCluster::_send(const StringView &key, std::shared_ptr<AsyncEvent> event) {
+    auto slot = _pool.slot(key);
+
+    if (_stale.load()) {
+        std::lock_guard<std::mutex> lock(_refresh_mutex);
+
+        if (_stale.load()) {
+            if (_refresher_stopped) {
+                event->set_exception(std::make_exception_ptr(Error("Cluster is closed")));
+            } else {
+                // Send it after the refresher thread updates the topology.
+                _deferred.emplace_back(slot, std::move(event));
+            }
+
+            return;
+        }
+    }
+
+    _dispatch(slot, std::move(event));
+}
+
+void AsyncRedisCluster::_dispatch(Slot slot, std::shared_ptr<AsyncEvent> event) {
+    try {
+        const auto &opts = _pool.fetch_pool(slot)->connection_options();
+
+        auto connection = _connection(Node{opts.host, opts.port});
+        if (!connection) {
+            throw Error("Cluster is closed");
+        }
+
+        connection->send(AsyncEventUPtr(new RedirectEvent(*this, event)));
+    } catch (...) {
+        event->set_exception(std::current_exception());
+    }
+}
+
+AsyncConnectionSPtr AsyncRedisCluster::_connection(const Node &node) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_closing) {
+        return nullptr;
+    }
+
+    auto iter = _connections.find(node);
+    if (iter == _connections.end()) {
+        auto opts = _opts;
+        opts.host = node.host;
+        opts.port = node.port;
+
+        iter = _connections.emplace(node, std::make_shared<AsyncConnection>(*_loop, opts)).first;
+    }
+
+    return iter->second;
+}
+
+void AsyncRedisCluster::_mark_stale() {
+    {
+        std::lock_guard<std::mutex> lock(_refresh_mutex);
+
+        _stale = true;
+        _refresh_requested = true;
+    }
+
+    _refresh_cv.notify_one();
+}
+
+void AsyncRedisCluster::_patch(Slot slot, const Node &node) {
+    {
+        std::lock_guard<std::mutex> lock(_refresh_mutex);
+
+        _moved.emplace_back(slot, node);
+    }
+
+    _refresh_cv.notify_one();
+}
+
+void AsyncRedisCluster::_refresh() {
+    std::unique_lock<std::mutex> lock(_refresh_mutex);
+
+    while (true) {
+        _refresh_cv.wait(lock, [this]() {
+                    return this->_refresh_requested
+                        || !this->_moved.empty()
+                        || this->_refresher_stopped;
+                });
+
+        if (_refresher_stopped) {
+            break;
+        }
+
+        if (!_moved.empty()) {
+            decltype(_moved) moved;
+            moved.swap(_moved);
+
+            lock.unlock();
+
+            for (const auto &ele : moved) {
+                try {
+                    _pool.update(ele.first, ele.second);
+                } catch (...) {
+                    // The command is redirected anyway, and the slot is fixed by
+                    // the next MOVED error or refresh.
+                }
+            }
+
+            lock.lock();
+        }
+
+        if (!_refresh_requested) {
+            continue;
+        }
+
+        _refresh_requested = false;
+
+        lock.unlock();
+
+        // CLUSTER SLOTS with a blocking connection, without lock.
+        std::exception_ptr err;
+        try {
+            _pool.update();
+        } catch (...) {
+            err = std::current_exception();
+        }
+
+        lock.lock();
+
+        decltype(_deferred) deferred;
+        deferred.swap(_deferred);
+
+        // If the refresh failed, the next broken connection requests another one.
+        if (!_refresh_requested) {
+            _stale = false;
+        }
+
+        lock.unlock();
+
+        for (auto &ele : deferred) {
+            if (err) {
+                ele.second->set_exception(err);
+            } else {
+                _dispatch(ele.first, std::move(ele.second));
+            }
+        }
+
+        lock.lock();
+    }
+
+    decltype(_deferred) deferred;
+    deferred.swap(_deferred);
+
+    lock.unlock();
+
+    auto err = std::make_exception_ptr(Error("Cluster is closed"));
+    for (auto &ele : deferred) {
+        ele.second->set_exception(err);
+    }
+}
+
+void AsyncRedisCluster::_stop_refresher() {
+    {
+        std::lock_guard<std::mutex> lock(_refresh_mutex);
+
+        _refresher_stopped = true;
+    }
+
+    _refresh_cv.notify_all();
+
+    if (_refresher.joinable()) {
+        _refresher.join();
+    }
+}
+
+}
+
+}
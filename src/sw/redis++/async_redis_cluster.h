@@ -0,0 +1,193 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_CLUSTER_H
+#define SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_CLUSTER_H
+
+#include <string>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include "async_connection.h"
+#include "event_loop.h"
+#include "shards_pool.h"
+#include "command_args.h"
+#include "command_options.h"
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+// AsyncRedisCluster is the async version of RedisCluster. Each master node has
+// a single *AsyncConnection*, and commands to the same node are pipelined on it.
+//
+// Cluster topology is fetched with blocking connections in a background thread, so that
+// neither callers nor the event loop thread block on it. When a command is redirected
+// with MOVED or ASK error, it's resent to the new node in the event loop thread, and
+// the moved slot is patched by the background thread. When
+// a connection is broken, the topology is refreshed, and commands sent in the meantime
+// are deferred until the refresh is done. If the refresh fails, their futures fail.
+class AsyncRedisCluster {
+public:
+    explicit AsyncRedisCluster(const ConnectionOptions &opts);
+
+    // Construct AsyncRedisCluster with URI:
+    // "tcp://127.0.0.1" or "tcp://127.0.0.1:6379"
+    // Only need to specify one URI.
+    explicit AsyncRedisCluster(const std::string &uri);
+
+    AsyncRedisCluster(const AsyncRedisCluster &) = delete;
+    AsyncRedisCluster& operator=(const AsyncRedisCluster &) = delete;
+
+    AsyncRedisCluster(AsyncRedisCluster &&) = delete;
+    AsyncRedisCluster& operator=(AsyncRedisCluster &&) = delete;
+
+    // Close all connections, and futures of in-flight commands fail with exception.
+    ~AsyncRedisCluster();
+
+    // The command is sent to the node that holds *key*.
+    template <typename Result, typename ...Args>
+    Future<Result> command(const StringView &cmd_name, const StringView &key, Args &&...args);
+
+    // KEY commands.
+
+    Future<long long> del(const StringView &key);
+
+    Future<long long> exists(const StringView &key);
+
+    Future<bool> expire(const StringView &key, long long timeout);
+
+    Future<bool> expire(const StringView &key, const std::chrono::seconds &timeout) {
+        return expire(key, timeout.count());
+    }
+
+    Future<long long> ttl(const StringView &key);
+
+    // STRING commands.
+
+    Future<long long> decr(const StringView &key);
+
+    Future<long long> decrby(const StringView &key, long long decrement);
+
+    Future<OptionalString> get(const StringView &key);
+
+    Future<long long> incr(const StringView &key);
+
+    Future<long long> incrby(const StringView &key, long long increment);
+
+    Future<bool> set(const StringView &key,
+                        const StringView &val,
+                        const std::chrono::milliseconds &ttl = std::chrono::milliseconds(0),
+                        UpdateType type = UpdateType::ALWAYS);
+
+    // LIST commands.
+
+    Future<long long> lpush(const StringView &key, const StringView &val);
+
+    template <typename Output = std::vector<std::string>>
+    Future<Output> lrange(const StringView &key, long long start, long long stop);
+
+    Future<long long> rpush(const StringView &key, const StringView &val);
+
+    // HASH commands.
+
+    Future<long long> hdel(const StringView &key, const StringView &field);
+
+    Future<OptionalString> hget(const StringView &key, const StringView &field);
+
+    Future<bool> hset(const StringView &key, const StringView &field, const StringView &val);
+
+    // PUBSUB commands.
+
+    Future<long long> publish(const StringView &channel, const StringView &message);
+
+private:
+    // Forward the reply to the user's event, unless it's been redirected.
+    class RedirectEvent;
+
+    friend class RedirectEvent;
+
+    template <typename Result, typename ResultParser = DefaultResultParser<Result>>
+    Future<Result> _command(const StringView &key, CmdArgs &args);
+
+    // Never throws, i.e. errors are reported by *event*.
+    void _send(const StringView &key, std::shared_ptr<AsyncEvent> event);
+
+    void _dispatch(Slot slot, std::shared_ptr<AsyncEvent> event);
+
+    // Thread-safe. Returns null, if the cluster is being destroyed.
+    AsyncConnectionSPtr _connection(const Node &node);
+
+    // Thread-safe. Ask the refresher thread to refresh the topology.
+    void _mark_stale();
+
+    // Thread-safe. Ask the refresher thread to move *slot* to *node*, i.e. MOVED error.
+    void _patch(Slot slot, const Node &node);
+
+    // Loop of the refresher thread.
+    void _refresh();
+
+    void _stop_refresher();
+
+    using NodeMap = std::unordered_map<Node, AsyncConnectionSPtr, NodeHash>;
+
+    static const std::size_t MAX_REDIRECTS = 5;
+
+    ShardsPool _pool;
+
+    ConnectionOptions _opts;
+
+    EventLoopSPtr _loop;
+
+    // Set when a connection is broken, and cleared when the topology has been refreshed.
+    // The flag is written with *_refresh_mutex* held, and read without lock as a fast path.
+    std::atomic<bool> _stale{false};
+
+    // Commands sent while the topology is stale, i.e. slot and event.
+    std::vector<std::pair<Slot, std::shared_ptr<AsyncEvent>>> _deferred;
+
+    // Slots moved by MOVED errors, which are not patched yet.
+    std::vector<std::pair<Slot, Node>> _moved;
+
+    bool _refresh_requested = false;
+
+    bool _refresher_stopped = false;
+
+    std::mutex _refresh_mutex;
+
+    std::condition_variable _refresh_cv;
+
+    std::thread _refresher;
+
+    std::mutex _mutex;
+
+    NodeMap _connections;
+
+    bool _closing = false;
+};
+
+}
+
+}
+
+#include "async_redis_cluster.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_CLUSTER_H
@@ -0,0 +1,64 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_CLUSTER_HPP
+#define SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_CLUSTER_HPP
+
+#include "reply.h"
+#include "utils.h"
+#include "errors.h"
+
+namespace sw {
+
+namespace redis {
+
+template <typename Result, typename ...Args>
+Future<Result> AsyncRedisCluster::command(const StringView &cmd_name,
+                                            const StringView &key,
+                                            Args &&...args) {
+    CmdArgs cmd_args;
+    cmd_args.append(cmd_name, key, std::forward<Args>(args)...);
+
+    return _command<Result>(key, cmd_args);
+}
+
+template <typename Output>
+Future<Output> AsyncRedisCluster::lrange(const StringView &key, long long start, long long stop) {
+    CmdArgs args;
+    args << "LRANGE" << key << start << stop;
+
+    return _command<Output>(key, args);
+}
+
+template <typename Result, typename ResultParser>
+Future<Result> AsyncRedisCluster::_command(const StringView &key, CmdArgs &args) {
+    auto cmd = std::make_shared<FormattedCommand>(args);
+
+    using Event = CommandEvent<Result, ResultParser>;
+    auto event = std::make_shared<Event>(std::move(cmd));
+
+    auto fut = event->get_future();
+
+    _send(key, std::move(event));
+
+    return fut;
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_ASYNC_REDIS_CLUSTER_HPP
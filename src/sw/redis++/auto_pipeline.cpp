@@ -0,0 +1,148 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "auto_pipeline.h"
+#include <cassert>
+
+namespace sw {
+
+namespace redis {
+
+AutoPipeline::AutoPipeline(std::size_t max_leaders) : _max_leaders(max_leaders) {
+    if (_max_leaders == 0) {
+        throw Error("Number of leaders should be larger than 0");
+    }
+}
+
+ReplyUPtr AutoPipeline::_command(ConnectionPool &pool, Request &request) {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _queue.push_back(&request);
+
+    while (!request.done) {
+        if (request.taken || _leaders == _max_leaders) {
+            // Another leader is sending this request, or all connections are busy.
+            _cv.wait(lock);
+            continue;
+        }
+
+        // Become a leader, and send all queued requests, including this one.
+        ++_leaders;
+
+        std::vector<Request*> batch;
+        batch.swap(_queue);
+        for (auto *req : batch) {
+            req->taken = true;
+        }
+
+        lock.unlock();
+
+        _run(pool, batch);
+
+        lock.lock();
+
+        --_leaders;
+
+        // Once *done* is set, the request might be destroyed by its owner.
+        for (auto *req : batch) {
+            req->done = true;
+        }
+
+        _cv.notify_all();
+    }
+
+    lock.unlock();
+
+    if (request.err) {
+        std::rethrow_exception(request.err);
+    }
+
+    assert(request.reply);
+
+    return std::move(request.reply);
+}
+
+void AutoPipeline::_run(ConnectionPool &pool, std::vector<Request*> &batch) {
+    assert(!batch.empty());
+
+    try {
+        auto connection = pool.fetch();
+
+        _pipeline(connection, batch);
+
+        pool.release(std::move(connection));
+    } catch (...) {
+        // Failed to get a connection from the pool.
+        auto err = std::current_exception();
+        for (auto *req : batch) {
+            if (!req->reply && !req->err) {
+                req->err = err;
+            }
+        }
+    }
+}
+
+void AutoPipeline::_pipeline(Connection &connection, std::vector<Request*> &batch) {
+    for (auto *req : batch) {
+        try {
+            req->sender(connection, req->cmd);
+            req->sent = true;
+        } catch (...) {
+            req->err = std::current_exception();
+        }
+    }
+
+    auto iter = batch.begin();
+    for (; iter != batch.end(); ++iter) {
+        auto *req = *iter;
+        if (!req->sent) {
+            continue;
+        }
+
+        try {
+            req->reply = connection.recv();
+        } catch (const ReplyError &) {
+            // Error reply, and the connection is still in sync.
+            req->err = std::current_exception();
+        } catch (...) {
+            req->err = std::current_exception();
+            break;
+        }
+    }
+
+    if (iter == batch.end()) {
+        return;
+    }
+
+    // Connection is broken or timed out, and replies of the remaining requests are lost.
+    auto err = (*iter)->err;
+    for (++iter; iter != batch.end(); ++iter) {
+        if ((*iter)->sent) {
+            (*iter)->err = err;
+        }
+    }
+
+    try {
+        // The connection might have unread replies, e.g. timeout, so reconnect it.
+        connection.reconnect();
+    } catch (const Error &) {
+        // The pool will reconnect the broken connection the next time it's fetched.
+    }
+}
+
+}
+
+}
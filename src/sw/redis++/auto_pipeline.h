@@ -0,0 +1,116 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_AUTO_PIPELINE_H
+#define SEWENEW_REDISPLUSPLUS_AUTO_PIPELINE_H
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <exception>
+#include "connection.h"
+#include "connection_pool.h"
+#include "reply.h"
+
+namespace sw {
+
+namespace redis {
+
+// AutoPipeline coalesces commands sent by concurrent callers into batches.
+// A caller, i.e. the leader, takes all queued commands, writes them to a single
+// connection, and dispatches replies to the waiting callers in order. At most
+// *max_leaders* batches are in flight at the same time, i.e. one per connection.
+class AutoPipeline {
+public:
+    explicit AutoPipeline(std::size_t max_leaders);
+
+    AutoPipeline(const AutoPipeline &) = delete;
+    AutoPipeline& operator=(const AutoPipeline &) = delete;
+
+    AutoPipeline(AutoPipeline &&) = delete;
+    AutoPipeline& operator=(AutoPipeline &&) = delete;
+
+    ~AutoPipeline() = default;
+
+    // Block until the reply is received.
+    template <typename Cmd, typename ...Args>
+    ReplyUPtr command(ConnectionPool &pool, Cmd cmd, Args &&...args);
+
+private:
+    struct Request {
+        using Sender = void (*)(Connection &connection, void *cmd);
+
+        Request(Sender s, void *c) : sender(s), cmd(c) {}
+
+        Sender sender;
+
+        // The command closure, which lives on the caller's stack.
+        void *cmd;
+
+        ReplyUPtr reply;
+
+        std::exception_ptr err;
+
+        bool sent = false;
+
+        // Whether the request has been taken by a leader.
+        bool taken = false;
+
+        bool done = false;
+    };
+
+    template <typename Closure>
+    static void _send(Connection &connection, void *cmd) {
+        (*static_cast<Closure*>(cmd))(connection);
+    }
+
+    ReplyUPtr _command(ConnectionPool &pool, Request &request);
+
+    // Send the batch with a connection from the pool.
+    void _run(ConnectionPool &pool, std::vector<Request*> &batch);
+
+    // Send all requests, and receive replies. It never throws, instead,
+    // errors are set to requests.
+    void _pipeline(Connection &connection, std::vector<Request*> &batch);
+
+    const std::size_t _max_leaders;
+
+    std::size_t _leaders = 0;
+
+    std::vector<Request*> _queue;
+
+    std::mutex _mutex;
+
+    std::condition_variable _cv;
+};
+
+template <typename Cmd, typename ...Args>
+ReplyUPtr AutoPipeline::command(ConnectionPool &pool, Cmd cmd, Args &&...args) {
+    // The caller blocks until the request is done, so it's safe to capture by reference.
+    auto closure = [&](Connection &connection) {
+        cmd(connection, std::forward<Args>(args)...);
+    };
+
+    Request request(&AutoPipeline::_send<decltype(closure)>, &closure);
+
+    return _command(pool, request);
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_AUTO_PIPELINE_H
@@ -0,0 +1,426 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "client_cache.h"
+#include <cassert>
+#include "command.h"
+#include "errors.h"
+
+namespace {
+
+// Rough memory overhead of list node, hash node, etc.
+const std::size_t ENTRY_OVERHEAD = 96;
+
+const std::size_t FIELD_OVERHEAD = 48;
+
+const std::string INVALIDATE_CHANNEL = "__redis__:invalidate";
+
+std::size_t value_size(const sw::redis::OptionalString &val) {
+    return val ? val->size() : 0;
+}
+
+}
+
+namespace sw {
+
+namespace redis {
+
+ClientCache::ClientCache(const ConnectionOptions &connection_opts,
+                            const ClientCacheOptions &opts) :
+                                _connection_opts(connection_opts),
+                                _opts(opts) {
+    if (_opts.shards == 0) {
+        throw Error("Number of client cache shards should be larger than 0");
+    }
+
+    _shard_budget = _opts.max_bytes / _opts.shards;
+
+    _shards.reserve(_opts.shards);
+    for (std::size_t idx = 0; idx != _opts.shards; ++idx) {
+        _shards.emplace_back(new Shard);
+    }
+
+    // Wake up from time to time to check whether we should stop.
+    _connection_opts.socket_timeout = _opts.poll_interval;
+
+    _invalidation_thread = std::thread([this]() { this->_run(); });
+}
+
+ClientCache::~ClientCache() {
+    _stop = true;
+
+    if (_invalidation_thread.joinable()) {
+        _invalidation_thread.join();
+    }
+}
+
+bool ClientCache::get(const StringView &key, OptionalString &val) {
+    if (_client_id < 0) {
+        return false;
+    }
+
+    auto &shard = *_shards[_shard_idx(key)];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto *entry = _find(shard, key);
+        if (entry != nullptr && entry->has_value) {
+            val = entry->value;
+
+            ++_hits;
+
+            return true;
+        }
+    }
+
+    ++_misses;
+
+    return false;
+}
+
+bool ClientCache::hget(const StringView &key, const StringView &field, OptionalString &val) {
+    if (_client_id < 0) {
+        return false;
+    }
+
+    auto &shard = *_shards[_shard_idx(key)];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto *entry = _find(shard, key);
+        if (entry != nullptr) {
+            auto iter = entry->fields.find(std::string(field.data(), field.size()));
+            if (iter != entry->fields.end()) {
+                val = iter->second;
+
+                ++_hits;
+
+                return true;
+            }
+        }
+    }
+
+    ++_misses;
+
+    return false;
+}
+
+auto ClientCache::ticket(const StringView &key) -> Ticket {
+    Ticket ticket;
+    ticket.client_id = _client_id;
+    ticket.shard = _shard_idx(key);
+
+    auto &shard = *_shards[ticket.shard];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    ticket.seq = shard.seq;
+
+    return ticket;
+}
+
+void ClientCache::set(const Ticket &ticket, const StringView &key, const OptionalString &val) {
+    if (_too_large(key, StringView(), val)) {
+        return;
+    }
+
+    auto &shard = *_shards[ticket.shard];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto *entry = _find_or_create(shard, ticket, key);
+    if (entry == nullptr) {
+        return;
+    }
+
+    auto old_bytes = entry->has_value ? value_size(entry->value) : 0;
+
+    entry->has_value = true;
+    entry->value = val;
+
+    shard.bytes -= old_bytes;
+    entry->bytes -= old_bytes;
+
+    _charge(shard, *entry, value_size(val));
+}
+
+void ClientCache::hset(const Ticket &ticket,
+                        const StringView &key,
+                        const StringView &field,
+                        const OptionalString &val) {
+    if (_too_large(key, field, val)) {
+        return;
+    }
+
+    auto &shard = *_shards[ticket.shard];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto *entry = _find_or_create(shard, ticket, key);
+    if (entry == nullptr) {
+        return;
+    }
+
+    auto res = entry->fields.emplace(std::string(field.data(), field.size()), val);
+    if (res.second) {
+        _charge(shard, *entry, FIELD_OVERHEAD + field.size() + value_size(val));
+    } else {
+        auto old_bytes = value_size(res.first->second);
+        res.first->second = val;
+
+        shard.bytes -= old_bytes;
+        entry->bytes -= old_bytes;
+
+        _charge(shard, *entry, value_size(val));
+    }
+}
+
+ClientCacheStats ClientCache::stats() const {
+    ClientCacheStats stats;
+    stats.hits = _hits;
+    stats.misses = _misses;
+    stats.evictions = _evictions;
+    stats.invalidations = _invalidations;
+
+    for (const auto &shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        stats.entries += shard->index.size();
+        stats.bytes += shard->bytes;
+    }
+
+    return stats;
+}
+
+std::size_t ClientCache::_shard_idx(const StringView &key) const {
+    // FNV-1a
+    std::size_t hash = 2166136261u;
+    for (std::size_t idx = 0; idx != key.size(); ++idx) {
+        hash ^= static_cast<unsigned char>(key.data()[idx]);
+        hash *= 16777619u;
+    }
+
+    return hash % _shards.size();
+}
+
+auto ClientCache::_find(Shard &shard, const StringView &key) -> Entry* {
+    auto iter = shard.index.find(std::string(key.data(), key.size()));
+    if (iter == shard.index.end()) {
+        return nullptr;
+    }
+
+    // Move it to the front, i.e. the most recently used entry.
+    shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+
+    return &*(iter->second);
+}
+
+auto ClientCache::_find_or_create(Shard &shard, const Ticket &ticket, const StringView &key)
+    -> Entry* {
+    // The key might have been invalidated, or the invalidation connection has been
+    // reestablished, since the ticket was taken.
+    if (ticket.client_id < 0 || ticket.client_id != _client_id || ticket.seq != shard.seq) {
+        return nullptr;
+    }
+
+    auto *entry = _find(shard, key);
+    if (entry != nullptr) {
+        return entry;
+    }
+
+    shard.lru.emplace_front(std::string(key.data(), key.size()));
+    shard.index.emplace(shard.lru.front().key, shard.lru.begin());
+
+    entry = &shard.lru.front();
+    _charge(shard, *entry, ENTRY_OVERHEAD + key.size());
+
+    return entry;
+}
+
+bool ClientCache::_too_large(const StringView &key,
+                                const StringView &field,
+                                const OptionalString &val) const {
+    return ENTRY_OVERHEAD + FIELD_OVERHEAD + key.size() + field.size() + value_size(val)
+                > _shard_budget;
+}
+
+void ClientCache::_charge(Shard &shard, Entry &entry, std::size_t bytes) {
+    entry.bytes += bytes;
+    shard.bytes += bytes;
+
+    _evict(shard);
+}
+
+void ClientCache::_evict(Shard &shard) {
+    // The most recently used entry, i.e. the front one, is the one being updated,
+    // and it's always kept.
+    while (shard.bytes > _shard_budget && shard.lru.size() > 1) {
+        auto &entry = shard.lru.back();
+
+        shard.bytes -= entry.bytes;
+        shard.index.erase(entry.key);
+        shard.lru.pop_back();
+
+        ++_evictions;
+    }
+}
+
+void ClientCache::invalidate(const StringView &key) {
+    auto &shard = *_shards[_shard_idx(key)];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    ++shard.seq;
+
+    auto iter = shard.index.find(std::string(key.data(), key.size()));
+    if (iter == shard.index.end()) {
+        return;
+    }
+
+    shard.bytes -= iter->second->bytes;
+    shard.lru.erase(iter->second);
+    shard.index.erase(iter);
+
+    ++_invalidations;
+}
+
+void ClientCache::flush() {
+    for (auto &shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        ++shard->seq;
+
+        _invalidations += shard->index.size();
+
+        shard->index.clear();
+        shard->lru.clear();
+        shard->bytes = 0;
+    }
+}
+
+void ClientCache::_run() {
+    while (!_stop) {
+        try {
+            Connection connection(_connection_opts);
+
+            auto id = _connect(connection);
+
+            // Entries cached before were tracked by the old invalidation connection.
+            flush();
+
+            _client_id = id;
+
+            while (!_stop) {
+                ReplyUPtr reply;
+                try {
+                    reply = connection.recv();
+                } catch (const TimeoutError &) {
+                    continue;
+                }
+
+                assert(reply);
+
+                _handle_message(*reply);
+            }
+        } catch (const Error &) {
+            // Invalidation messages might be lost, and we'll reconnect.
+        }
+
+        _client_id = -1;
+
+        flush();
+
+        if (!_stop) {
+            std::this_thread::sleep_for(_opts.poll_interval);
+        }
+    }
+}
+
+long long ClientCache::_connect(Connection &connection) {
+    cmd::client_id(connection);
+
+    auto reply = connection.recv();
+
+    assert(reply);
+
+    auto id = reply::parse<long long>(*reply);
+
+    // Check if Redis supports CLIENT TRACKING, i.e. Redis 6.0 or later.
+    // Otherwise, it throws, and caching stays disabled.
+    connection.send("CLIENT TRACKING OFF");
+
+    reply = connection.recv();
+
+    assert(reply);
+
+    reply::parse<void>(*reply);
+
+    cmd::subscribe(connection, INVALIDATE_CHANNEL);
+
+    reply = connection.recv();
+
+    assert(reply);
+
+    if (!reply::is_array(*reply)) {
+        throw ProtoError("Expect ARRAY reply for SUBSCRIBE");
+    }
+
+    return id;
+}
+
+void ClientCache::_handle_message(redisReply &reply) {
+    if (!reply::is_array(reply) || reply.elements != 3 || reply.element == nullptr) {
+        throw ProtoError("Invalid invalidation message");
+    }
+
+    auto *type_reply = reply.element[0];
+    if (type_reply == nullptr) {
+        throw ProtoError("Null message type reply");
+    }
+
+    if (reply::parse<std::string>(*type_reply) != "message") {
+        // Meta messages, e.g. SUBSCRIBE.
+        return;
+    }
+
+    auto *keys_reply = reply.element[2];
+    if (keys_reply == nullptr) {
+        throw ProtoError("Null invalidation keys reply");
+    }
+
+    if (reply::is_nil(*keys_reply)) {
+        // FLUSHALL or FLUSHDB.
+        flush();
+        return;
+    }
+
+    if (!reply::is_array(*keys_reply)) {
+        throw ProtoError("Expect ARRAY reply of invalidation keys");
+    }
+
+    for (std::size_t idx = 0; idx != keys_reply->elements; ++idx) {
+        auto *key_reply = keys_reply->element[idx];
+        if (key_reply == nullptr || !reply::is_string(*key_reply)) {
+            throw ProtoError("Invalid invalidation key reply");
+        }
+
+        invalidate(StringView(key_reply->str, key_reply->len));
+    }
+}
+
+}
+
+}
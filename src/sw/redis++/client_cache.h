@@ -0,0 +1,205 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_CLIENT_CACHE_H
+#define SEWENEW_REDISPLUSPLUS_CLIENT_CACHE_H
+
+#include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include "connection.h"
+#include "reply.h"
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+struct ClientCacheOptions {
+    // Max memory used by cached keys and values, including some bookkeeping overhead.
+    std::size_t max_bytes = 64 * 1024 * 1024;
+
+    // Number of LRU shards. Each shard has its own lock and *max_bytes / shards* budget.
+    std::size_t shards = 16;
+
+    // Timeout of the invalidation connection, i.e. how often the invalidation thread
+    // checks whether it should stop.
+    std::chrono::milliseconds poll_interval{100};
+};
+
+struct ClientCacheStats {
+    long long hits = 0;
+
+    long long misses = 0;
+
+    // Entries evicted because the cache is full.
+    long long evictions = 0;
+
+    // Entries removed because of invalidation messages, or modified with the Redis object
+    // that owns the cache.
+    long long invalidations = 0;
+
+    std::size_t entries = 0;
+
+    std::size_t bytes = 0;
+};
+
+// ClientCache caches replies of GET and HGET in process, and relies on Redis' CLIENT TRACKING
+// in redirect mode to invalidate them. A background thread subscribes to
+// *__redis__:invalidate* channel with a dedicated connection, and connections that read
+// cached keys redirect invalidation messages to it, i.e. *CLIENT TRACKING ON REDIRECT id*.
+//
+// If the invalidation connection is broken, the whole cache is flushed, and caching is
+// disabled until the connection is reestablished.
+class ClientCache {
+public:
+    ClientCache(const ConnectionOptions &connection_opts, const ClientCacheOptions &opts);
+
+    ClientCache(const ClientCache &) = delete;
+    ClientCache& operator=(const ClientCache &) = delete;
+
+    ClientCache(ClientCache &&) = delete;
+    ClientCache& operator=(ClientCache &&) = delete;
+
+    ~ClientCache();
+
+    // A snapshot taken before reading a key from Redis. The reply can only be cached,
+    // if no invalidation happens in between.
+    struct Ticket {
+        // Id of the invalidation connection, or -1 if caching is disabled.
+        long long client_id = -1;
+
+        std::size_t shard = 0;
+
+        unsigned long long seq = 0;
+    };
+
+    // Returns true if *key* is cached, and *val* is set to the cached value.
+    bool get(const StringView &key, OptionalString &val);
+
+    bool hget(const StringView &key, const StringView &field, OptionalString &val);
+
+    Ticket ticket(const StringView &key);
+
+    void set(const Ticket &ticket, const StringView &key, const OptionalString &val);
+
+    void hset(const Ticket &ticket,
+                const StringView &key,
+                const StringView &field,
+                const OptionalString &val);
+
+    ClientCacheStats stats() const;
+
+    // Remove *key*, and make replies of in-flight reads of it uncacheable. It's called
+    // when *key* is modified with the Redis object that owns the cache, so that we can
+    // read our own writes before the invalidation message arrives.
+    void invalidate(const StringView &key);
+
+    // Remove all keys.
+    void flush();
+
+private:
+    struct Entry {
+        explicit Entry(std::string k) : key(std::move(k)) {}
+
+        std::string key;
+
+        // Cached value of GET.
+        bool has_value = false;
+        OptionalString value;
+
+        // Cached values of HGET.
+        std::unordered_map<std::string, OptionalString> fields;
+
+        std::size_t bytes = 0;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    struct Shard {
+        std::mutex mutex;
+
+        // Most recently used entry is at the front.
+        EntryList lru;
+
+        std::unordered_map<std::string, EntryList::iterator> index;
+
+        std::size_t bytes = 0;
+
+        // Bumped whenever some keys of the shard are invalidated.
+        unsigned long long seq = 0;
+    };
+
+    std::size_t _shard_idx(const StringView &key) const;
+
+    // NOT thread-safe, i.e. caller should lock the shard.
+    Entry* _find(Shard &shard, const StringView &key);
+
+    // NOT thread-safe. Returns null, if the ticket is out of date.
+    Entry* _find_or_create(Shard &shard, const Ticket &ticket, const StringView &key);
+
+    // Values that cannot fit into a shard are never cached.
+    bool _too_large(const StringView &key,
+                    const StringView &field,
+                    const OptionalString &val) const;
+
+    // NOT thread-safe.
+    void _charge(Shard &shard, Entry &entry, std::size_t bytes);
+
+    // NOT thread-safe.
+    void _evict(Shard &shard);
+
+    void _run();
+
+    long long _connect(Connection &connection);
+
+    void _handle_message(redisReply &reply);
+
+    ConnectionOptions _connection_opts;
+
+    ClientCacheOptions _opts;
+
+    std::size_t _shard_budget;
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+
+    // Id of the invalidation connection, -1 if it's NOT ready.
+    std::atomic<long long> _client_id{-1};
+
+    std::atomic<long long> _hits{0};
+
+    std::atomic<long long> _misses{0};
+
+    std::atomic<long long> _evictions{0};
+
+    std::atomic<long long> _invalidations{0};
+
+    std::atomic<bool> _stop{false};
+
+    std::thread _invalidation_thread;
+};
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_CLIENT_CACHE_H
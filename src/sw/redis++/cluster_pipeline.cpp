@@ -0,0 +1,325 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "cluster_pipeline.h"
+#include <cassert>
+#include <numeric>
+#include "command.h"
+#include "errors.h"
+
+namespace {
+
+// Max rounds of sending commands, i.e. commands might be redirected
+// at most *MAX_ROUNDS - 1* times.
+const std::size_t MAX_ROUNDS = 3;
+
+}
+
+namespace sw {
+
+namespace redis {
+
+QueuedReplies ClusterPipeline::exec() {
+    try {
+        std::vector<ReplyUPtr> replies(_cmds.size());
+
+        std::vector<std::size_t> pending(_cmds.size());
+        std::iota(pending.begin(), pending.end(), 0);
+
+        std::size_t rounds = 0;
+        while (!pending.empty()) {
+            if (rounds == MAX_ROUNDS) {
+                throw Error("Failed to send " + std::to_string(pending.size())
+                        + " commands of the pipeline");
+            }
+
+            if (rounds > 0) {
+                // Some commands failed with MOVED error, or IoError. Either slot mapping
+                // has been changed, or master is down. Update the mapping, and only resend
+                // these commands.
+                _pool->update();
+            }
+
+            ++rounds;
+
+            AskCommands asks;
+            pending = _send(pending, asks, replies);
+
+            for (auto &ask : asks) {
+                // Commands redirected with ASK error are sent right away. If they're
+                // redirected again, they're resent in the next round.
+                std::exception_ptr err;
+                std::vector<std::size_t> failed;
+                AskCommands redirects;
+                try {
+                    auto connection = _pool->fetch(ask.first);
+                    _send(connection.connection(), ask.second, true);
+                    connection.connection().flush();
+
+                    Batch batch(std::move(connection), std::move(ask.second), true);
+                    _recv(batch, replies, failed, redirects, err);
+                } catch (const IoError &) {
+                    failed = std::move(ask.second);
+                } catch (const ClosedError &) {
+                    failed = std::move(ask.second);
+                }
+
+                if (err) {
+                    std::rethrow_exception(err);
+                }
+
+                pending.insert(pending.end(), failed.begin(), failed.end());
+                for (auto &redirect : redirects) {
+                    pending.insert(pending.end(), redirect.second.begin(), redirect.second.end());
+                }
+            }
+        }
+
+        for (auto idx : _set_cmd_indexes) {
+            assert(idx < replies.size() && replies[idx]);
+
+            reply::rewrite_set_reply(*replies[idx]);
+        }
+
+        _reset();
+
+        return QueuedReplies(std::move(replies));
+    } catch (const Error &) {
+        _reset();
+        throw;
+    }
+}
+
+void ClusterPipeline::discard() {
+    _reset();
+}
+
+ClusterPipeline& ClusterPipeline::del(const StringView &key) {
+    return command("DEL", key);
+}
+
+ClusterPipeline& ClusterPipeline::exists(const StringView &key) {
+    return command("EXISTS", key);
+}
+
+ClusterPipeline& ClusterPipeline::expire(const StringView &key, long long timeout) {
+    return command("EXPIRE", key, timeout);
+}
+
+ClusterPipeline& ClusterPipeline::ttl(const StringView &key) {
+    return command("TTL", key);
+}
+
+ClusterPipeline& ClusterPipeline::decr(const StringView &key) {
+    return command("DECR", key);
+}
+
+ClusterPipeline& ClusterPipeline::decrby(const StringView &key, long long decrement) {
+    return command("DECRBY", key, decrement);
+}
+
+ClusterPipeline& ClusterPipeline::get(const StringView &key) {
+    return command("GET", key);
+}
+
+ClusterPipeline& ClusterPipeline::incr(const StringView &key) {
+    return command("INCR", key);
+}
+
+ClusterPipeline& ClusterPipeline::incrby(const StringView &key, long long increment) {
+    return command("INCRBY", key, increment);
+}
+
+ClusterPipeline& ClusterPipeline::set(const StringView &key,
+                                        const StringView &val,
+                                        const std::chrono::milliseconds &ttl,
+                                        UpdateType type) {
+    CmdArgs args;
+    args << "SET" << key << val;
+
+    if (ttl > std::chrono::milliseconds(0)) {
+        args << "PX" << ttl.count();
+    }
+
+    cmd::detail::set_update_type(args, type);
+
+    _set_cmd_indexes.push_back(_cmds.size());
+
+    _queue(key, args);
+
+    return *this;
+}
+
+ClusterPipeline& ClusterPipeline::lpush(const StringView &key, const StringView &val) {
+    return command("LPUSH", key, val);
+}
+
+ClusterPipeline& ClusterPipeline::rpush(const StringView &key, const StringView &val) {
+    return command("RPUSH", key, val);
+}
+
+ClusterPipeline& ClusterPipeline::hdel(const StringView &key, const StringView &field) {
+    return command("HDEL", key, field);
+}
+
+ClusterPipeline& ClusterPipeline::hget(const StringView &key, const StringView &field) {
+    return command("HGET", key, field);
+}
+
+ClusterPipeline& ClusterPipeline::hset(const StringView &key,
+                                        const StringView &field,
+                                        const StringView &val) {
+    return command("HSET", key, field, val);
+}
+
+void ClusterPipeline::_queue(const StringView &key, CmdArgs &args) {
+    Command cmd;
+    cmd.slot = _pool->slot(key);
+    cmd.first = _args.size();
+
+    auto argv = args.argv();
+    auto argv_len = args.argv_len();
+    for (std::size_t idx = 0; idx != args.size(); ++idx) {
+        _args.emplace_back(_buffer.size(), argv_len[idx]);
+        _buffer.append(argv[idx], argv_len[idx]);
+    }
+
+    cmd.last = _args.size();
+
+    _cmds.push_back(cmd);
+}
+
+std::vector<std::size_t> ClusterPipeline::_send(const std::vector<std::size_t> &cmds,
+                                                AskCommands &asks,
+                                                std::vector<ReplyUPtr> &replies) {
+    std::unordered_map<ConnectionPool*, std::vector<std::size_t>> node_cmds;
+    for (auto idx : cmds) {
+        assert(idx < _cmds.size());
+
+        node_cmds[_pool->fetch_pool(_cmds[idx].slot)].push_back(idx);
+    }
+
+    // Commands that need to be resent after updating slot mapping.
+    std::vector<std::size_t> failed;
+
+    // 1. Write commands to all nodes before receiving any reply,
+    //    so that nodes can work in parallel.
+    std::vector<Batch> batches;
+    batches.reserve(node_cmds.size());
+    for (auto &node : node_cmds) {
+        try {
+            GuardedConnection connection(*(node.first));
+            _send(connection.connection(), node.second, false);
+            connection.connection().flush();
+
+            batches.emplace_back(std::move(connection), std::move(node.second), false);
+        } catch (const IoError &) {
+            failed.insert(failed.end(), node.second.begin(), node.second.end());
+        } catch (const ClosedError &) {
+            failed.insert(failed.end(), node.second.begin(), node.second.end());
+        }
+    }
+
+    // 2. Receive replies.
+    std::exception_ptr err;
+    for (auto &batch : batches) {
+        _recv(batch, replies, failed, asks, err);
+    }
+
+    if (err) {
+        std::rethrow_exception(err);
+    }
+
+    return failed;
+}
+
+void ClusterPipeline::_send(Connection &connection,
+                            const std::vector<std::size_t> &cmds,
+                            bool asking) {
+    std::vector<const char *> argv;
+    std::vector<std::size_t> argv_len;
+    for (auto idx : cmds) {
+        const auto &cmd = _cmds[idx];
+
+        argv.clear();
+        argv_len.clear();
+        for (auto arg = cmd.first; arg != cmd.last; ++arg) {
+            argv.push_back(_buffer.data() + _args[arg].first);
+            argv_len.push_back(_args[arg].second);
+        }
+
+        if (asking) {
+            connection.send("ASKING");
+        }
+
+        connection.send(static_cast<int>(argv.size()), argv.data(), argv_len.data());
+    }
+}
+
+void ClusterPipeline::_recv(Batch &batch,
+                            std::vector<ReplyUPtr> &replies,
+                            std::vector<std::size_t> &failed,
+                            AskCommands &asks,
+                            std::exception_ptr &err) {
+    auto &connection = batch.connection.connection();
+    auto &cmds = batch.cmds;
+    for (auto iter = cmds.begin(); iter != cmds.end(); ++iter) {
+        auto idx = *iter;
+        try {
+            if (batch.asking) {
+                try {
+                    connection.recv();
+                } catch (const ReplyError &) {
+                    // Error reply of ASKING, and the reply of the command is still
+                    // in the connection.
+                    if (!err) {
+                        err = std::current_exception();
+                    }
+                }
+            }
+
+            replies[idx] = connection.recv();
+        } catch (const MovedError &) {
+            failed.push_back(idx);
+        } catch (const AskError &e) {
+            asks[e.node()].push_back(idx);
+        } catch (const IoError &) {
+            // Replies of the remaining commands are lost.
+            failed.insert(failed.end(), iter, cmds.end());
+            break;
+        } catch (const ClosedError &) {
+            failed.insert(failed.end(), iter, cmds.end());
+            break;
+        } catch (const Error &) {
+            // Keep receiving the remaining replies, so that the connection
+            // can be reused, and throw the first error after that.
+            if (!err) {
+                err = std::current_exception();
+            }
+        }
+    }
+}
+
+void ClusterPipeline::_reset() {
+    _buffer.clear();
+    _args.clear();
+    _cmds.clear();
+    _set_cmd_indexes.clear();
+}
+
+}
+
+}
@@ -0,0 +1,192 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_CLUSTER_PIPELINE_H
+#define SEWENEW_REDISPLUSPLUS_CLUSTER_PIPELINE_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <exception>
+#include <unordered_map>
+#include "connection.h"
+#include "command_args.h"
+#include "command_options.h"
+#include "queued_redis.h"
+#include "shards.h"
+#include "shards_pool.h"
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+// ClusterPipeline queues commands of arbitrary keys, i.e. keys DO NOT need to be
+// located on the same slot. When *exec* is called, commands are grouped by the node
+// holding the slot of their keys, and batches of all nodes are written before
+// receiving any reply, so that nodes can work in parallel. Commands redirected with
+// MOVED or ASK error are resent to the right node, and replies are returned in the
+// order that commands were queued.
+//
+// Arguments are copied when commands are queued, and the ClusterPipeline object
+// refers to the RedisCluster object that creates it, so it should NOT outlive it.
+//
+// NOTE: commands are NOT atomic, and commands sent to different nodes might be
+// executed in any order. Also ClusterPipeline is NOT thread-safe.
+class ClusterPipeline {
+public:
+    ClusterPipeline(const ClusterPipeline &) = delete;
+    ClusterPipeline& operator=(const ClusterPipeline &) = delete;
+
+    ClusterPipeline(ClusterPipeline &&) = default;
+    ClusterPipeline& operator=(ClusterPipeline &&) = default;
+
+    ~ClusterPipeline() = default;
+
+    // The command is sent to the node holding the slot of *key*, i.e. the first
+    // argument after the command name.
+    template <typename ...Args>
+    ClusterPipeline& command(const StringView &cmd_name, const StringView &key, Args &&...args);
+
+    // The second element of the range, i.e. the first argument after the command name,
+    // is used as the key.
+    template <typename Input>
+    auto command(Input first, Input last)
+        -> typename std::enable_if<IsIter<Input>::value, ClusterPipeline&>::type;
+
+    // Send all queued commands, and return their replies. If any command gets an error
+    // reply, other than redirections, it throws after all replies have been received.
+    // In either case, the queue is cleared.
+    QueuedReplies exec();
+
+    void discard();
+
+    std::size_t size() const {
+        return _cmds.size();
+    }
+
+    // KEY commands.
+
+    ClusterPipeline& del(const StringView &key);
+
+    ClusterPipeline& exists(const StringView &key);
+
+    ClusterPipeline& expire(const StringView &key, long long timeout);
+
+    ClusterPipeline& ttl(const StringView &key);
+
+    // STRING commands.
+
+    ClusterPipeline& decr(const StringView &key);
+
+    ClusterPipeline& decrby(const StringView &key, long long decrement);
+
+    ClusterPipeline& get(const StringView &key);
+
+    ClusterPipeline& incr(const StringView &key);
+
+    ClusterPipeline& incrby(const StringView &key, long long increment);
+
+    ClusterPipeline& set(const StringView &key,
+                            const StringView &val,
+                            const std::chrono::milliseconds &ttl = std::chrono::milliseconds(0),
+                            UpdateType type = UpdateType::ALWAYS);
+
+    // LIST commands.
+
+    ClusterPipeline& lpush(const StringView &key, const StringView &val);
+
+    ClusterPipeline& rpush(const StringView &key, const StringView &val);
+
+    // HASH commands.
+
+    ClusterPipeline& hdel(const StringView &key, const StringView &field);
+
+    ClusterPipeline& hget(const StringView &key, const StringView &field);
+
+    ClusterPipeline& hset(const StringView &key, const StringView &field, const StringView &val);
+
+private:
+    friend class RedisCluster;
+
+    explicit ClusterPipeline(ShardsPool &pool) : _pool(&pool) {}
+
+    struct Command {
+        Slot slot;
+
+        // Arguments of the command are *_args[first, last)*.
+        std::size_t first;
+        std::size_t last;
+    };
+
+    // Commands of a single node, which are sent with a single connection.
+    struct Batch {
+        Batch(GuardedConnection conn, std::vector<std::size_t> c, bool a) :
+                connection(std::move(conn)), cmds(std::move(c)), asking(a) {}
+
+        GuardedConnection connection;
+
+        // Indexes of the commands.
+        std::vector<std::size_t> cmds;
+
+        // Whether commands are redirected with ASK error.
+        bool asking;
+    };
+
+    // Commands redirected with ASK error, i.e. node -> indexes of the commands.
+    using AskCommands = std::unordered_map<Node, std::vector<std::size_t>, NodeHash>;
+
+    // Copy arguments, since they might be destroyed before *exec* is called.
+    void _queue(const StringView &key, CmdArgs &args);
+
+    // Send commands to their nodes. Returns indexes of commands that should be resent
+    // after updating the slot mapping, and commands redirected with ASK error are
+    // added to *asks*.
+    std::vector<std::size_t> _send(const std::vector<std::size_t> &cmds,
+                                    AskCommands &asks,
+                                    std::vector<ReplyUPtr> &replies);
+
+    void _send(Connection &connection, const std::vector<std::size_t> &cmds, bool asking);
+
+    void _recv(Batch &batch,
+                std::vector<ReplyUPtr> &replies,
+                std::vector<std::size_t> &failed,
+                AskCommands &asks,
+                std::exception_ptr &err);
+
+    void _reset();
+
+    ShardsPool *_pool;
+
+    // All arguments of queued commands are stored in a single buffer,
+    // and *_args* are offset and length of each argument.
+    std::string _buffer;
+
+    std::vector<std::pair<std::size_t, std::size_t>> _args;
+
+    std::vector<Command> _cmds;
+
+    // Indexes of SET commands, whose replies need to be rewritten.
+    std::vector<std::size_t> _set_cmd_indexes;
+};
+
+}
+
+}
+
+#include "cluster_pipeline.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_CLUSTER_PIPELINE_H
@@ -0,0 +1,58 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_CLUSTER_PIPELINE_HPP
+#define SEWENEW_REDISPLUSPLUS_CLUSTER_PIPELINE_HPP
+
+namespace sw {
+
+namespace redis {
+
+template <typename ...Args>
+ClusterPipeline& ClusterPipeline::command(const StringView &cmd_name,
+                                            const StringView &key,
+                                            Args &&...args) {
+    CmdArgs cmd_args;
+    cmd_args.append(cmd_name, key, std::forward<Args>(args)...);
+
+    _queue(key, cmd_args);
+
+    return *this;
+}
+
+template <typename Input>
+auto ClusterPipeline::command(Input first, Input last)
+    -> typename std::enable_if<IsIter<Input>::value, ClusterPipeline&>::type {
+    CmdArgs cmd_args;
+    while (first != last) {
+        cmd_args.append(*first);
+        ++first;
+    }
+
+    if (cmd_args.size() < 2) {
+        throw Error("command: no key specified");
+    }
+
+    _queue(StringView(cmd_args.argv()[1], cmd_args.argv_len()[1]), cmd_args);
+
+    return *this;
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_CLUSTER_PIPELINE_HPP
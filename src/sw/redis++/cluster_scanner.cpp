@@ -0,0 +1,152 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "cluster_scanner.h"
+#include <cassert>
+#include "command.h"
+#include "errors.h"
+#include "reply.h"
+
+namespace sw {
+
+namespace redis {
+
+ClusterScanner::Iterator& ClusterScanner::Iterator::operator++() {
+    assert(_scanner != nullptr);
+
+    if (!_scanner->next(_key)) {
+        _scanner = nullptr;
+    }
+
+    return *this;
+}
+
+ClusterScanner::ClusterScanner(const std::vector<ConnectionPoolSPtr> &masters,
+                                const ClusterScanOptions &opts) : _opts(opts) {
+    if (_opts.count <= 0) {
+        throw Error("SCAN: count should be positive");
+    }
+
+    try {
+        _masters.reserve(masters.size());
+        for (const auto &pool : masters) {
+            _masters.emplace_back(pool);
+            _send(_masters.back(), 0);
+        }
+    } catch (...) {
+        _abort();
+        throw;
+    }
+}
+
+ClusterScanner& ClusterScanner::operator=(ClusterScanner &&that) {
+    if (this != &that) {
+        _abort();
+
+        _opts = std::move(that._opts);
+        _masters = std::move(that._masters);
+        _next_master = that._next_master;
+        _keys = std::move(that._keys);
+        _key_idx = that._key_idx;
+
+        that._masters.clear();
+    }
+
+    return *this;
+}
+
+ClusterScanner::~ClusterScanner() {
+    _abort();
+}
+
+bool ClusterScanner::next(std::string &key) {
+    while (_key_idx == _keys.size()) {
+        if (!_next_page()) {
+            return false;
+        }
+    }
+
+    key = std::move(_keys[_key_idx]);
+    ++_key_idx;
+
+    return true;
+}
+
+ClusterScanner::Iterator ClusterScanner::begin() {
+    Iterator iter(this);
+
+    return ++iter;
+}
+
+void ClusterScanner::_send(Master &master, long long cursor) {
+    auto &connection = master.connection.connection();
+
+    cmd::scan(connection, cursor, _opts.pattern, _opts.count);
+
+    // Send it now, instead of when we read the reply.
+    connection.flush();
+}
+
+bool ClusterScanner::_next_page() {
+    if (_masters.empty()) {
+        return false;
+    }
+
+    auto idx = _next_master % _masters.size();
+    auto &master = _masters[idx];
+
+    std::vector<std::string> keys;
+    try {
+        auto reply = master.connection.connection().recv();
+
+        assert(reply);
+
+        auto cursor = reply::parse_scan_reply(*reply, std::back_inserter(keys));
+        if (cursor == 0) {
+            // This master is done, and its connection goes back to the pool.
+            _masters.erase(_masters.begin() + idx);
+            _next_master = idx;
+        } else {
+            _send(master, cursor);
+            _next_master = idx + 1;
+        }
+    } catch (...) {
+        // Stop the iteration, since the cursor of this master is lost.
+        _abort();
+        throw;
+    }
+
+    _keys = std::move(keys);
+    _key_idx = 0;
+
+    return true;
+}
+
+void ClusterScanner::_abort() noexcept {
+    for (auto &master : _masters) {
+        auto &connection = master.connection.connection();
+        if (!connection.broken()) {
+            // Its reply hasn't been read.
+            connection.invalidate();
+        }
+    }
+
+    _masters.clear();
+}
+
+}
+
+}
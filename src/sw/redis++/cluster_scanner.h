@@ -0,0 +1,159 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_CLUSTER_SCANNER_H
+#define SEWENEW_REDISPLUSPLUS_CLUSTER_SCANNER_H
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "shards_pool.h"
+
+namespace sw {
+
+namespace redis {
+
+struct ClusterScanOptions {
+    // Only return keys matching the glob-style pattern.
+    std::string pattern = "*";
+
+    // COUNT hint of each SCAN command, i.e. roughly the number of keys in a page.
+    long long count = 100;
+};
+
+// ClusterScanner iterates keys of all masters of the cluster. It holds a connection of each
+// master during the iteration. When it's created, SCAN is sent to all masters without waiting
+// for replies, and each time a page of a master is taken, SCAN with the next cursor is sent
+// to that master at once, so that the master works on the next page, while the caller consumes
+// this one. Pages are taken from masters in round-robin order. No thread is created.
+//
+// Each master has at most one page pending, so it buffers at most *(masters + 1) * count*
+// keys, more or less. Masters are the ones at the time ClusterScanner is created, and it has
+// the same guarantees as SCAN, i.e. keys that exist during the whole iteration are returned
+// at least once, and keys being migrated might be missed or returned more than once.
+//
+// If SCAN fails on any master, *next* throws, and the iteration is stopped. Connections with
+// pending SCAN commands are reconnected before they're reused. ClusterScanner is NOT
+// thread-safe.
+class ClusterScanner {
+public:
+    // An input iterator, i.e. it can only be traversed once, and all iterators
+    // returned by *begin* share the same position.
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string*;
+        using reference = const std::string&;
+
+        Iterator() = default;
+
+        reference operator*() const {
+            return _key;
+        }
+
+        pointer operator->() const {
+            return &_key;
+        }
+
+        Iterator& operator++();
+
+        Iterator operator++(int) {
+            auto iter = *this;
+            ++*this;
+            return iter;
+        }
+
+        bool operator==(const Iterator &that) const {
+            return _scanner == that._scanner;
+        }
+
+        bool operator!=(const Iterator &that) const {
+            return !(*this == that);
+        }
+
+    private:
+        friend class ClusterScanner;
+
+        explicit Iterator(ClusterScanner *scanner) : _scanner(scanner) {}
+
+        // Null, if it's the end.
+        ClusterScanner *_scanner = nullptr;
+
+        std::string _key;
+    };
+
+    ClusterScanner(const ClusterScanner &) = delete;
+    ClusterScanner& operator=(const ClusterScanner &) = delete;
+
+    ClusterScanner(ClusterScanner &&) = default;
+    ClusterScanner& operator=(ClusterScanner &&that);
+
+    ~ClusterScanner();
+
+    // Get the next key. Returns false, if all keys have been returned.
+    bool next(std::string &key);
+
+    Iterator begin();
+
+    Iterator end() {
+        return Iterator();
+    }
+
+private:
+    friend class RedisCluster;
+
+    ClusterScanner(const std::vector<ConnectionPoolSPtr> &masters, const ClusterScanOptions &opts);
+
+    // A master that still has pages, and exactly one SCAN command pending.
+    struct Master {
+        explicit Master(ConnectionPoolSPtr p) : pool(std::move(p)), connection(*pool) {}
+
+        // Declared before *connection*, so that the pool outlives it.
+        ConnectionPoolSPtr pool;
+
+        GuardedConnection connection;
+    };
+
+    // Send SCAN to the master without waiting for the reply.
+    void _send(Master &master, long long cursor);
+
+    // Take the next page. Returns false, if all masters are done.
+    bool _next_page();
+
+    // Stop the iteration, and mark connections with pending replies as broken.
+    void _abort() noexcept;
+
+    ClusterScanOptions _opts;
+
+    // Masters that still have pages.
+    std::vector<Master> _masters;
+
+    // Index of the master whose page will be taken next.
+    std::size_t _next_master = 0;
+
+    std::vector<std::string> _keys;
+
+    std::size_t _key_idx = 0;
+};
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_CLUSTER_SCANNER_H
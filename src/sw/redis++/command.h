@@ -62,6 +62,18 @@ inline void swapdb(Connection &connection, long long idx1, long long idx2) {
     connection.send("SWAPDB %lld %lld", idx1, idx2);
 }
 
+inline void client_id(Connection &connection) {
+    connection.send("CLIENT ID");
+}
+
+inline void client_tracking_redirect(Connection &connection, long long client_id) {
+    connection.send("CLIENT TRACKING ON REDIRECT %lld", client_id);
+}
+
+inline void readonly(Connection &connection) {
+    connection.send("READONLY");
+}
+
 // SERVER commands.
 
 inline void bgrewriteaof(Connection &connection) {
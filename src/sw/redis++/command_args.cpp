@@ -0,0 +1,121 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "command_args.h"
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+#include "errors.h"
+
+namespace {
+
+const std::size_t CHUNK_SIZE = 1024;
+
+}
+
+namespace sw {
+
+namespace redis {
+
+StringView CmdArgs::Arena::copy(const char *data, std::size_t size) {
+    auto *buf = _allocate(size);
+
+    // *data* might be null, if *size* is 0.
+    if (size > 0) {
+        std::memcpy(buf, data, size);
+    }
+
+    return StringView(buf, size);
+}
+
+char* CmdArgs::Arena::_allocate(std::size_t size) {
+    if (size > _left) {
+        // Large arguments get a chunk of their own.
+        auto chunk_size = std::max(size, CHUNK_SIZE);
+
+        _chunks.emplace_back(new char[chunk_size]);
+
+        _cur = _chunks.back().get();
+        _left = chunk_size;
+    }
+
+    auto *buf = _cur;
+
+    _cur += size;
+    _left -= size;
+
+    return buf;
+}
+
+CmdArgs& CmdArgs::_append_number(long long num) {
+    // Enough for the minimum value, i.e. 19 digits and the sign.
+    char buf[24];
+    auto *end = buf + sizeof(buf);
+    auto *cur = end;
+
+    // Negate it in unsigned domain, so that it works with the minimum value.
+    auto val = static_cast<unsigned long long>(num);
+    if (num < 0) {
+        val = 0 - val;
+    }
+
+    do {
+        *--cur = static_cast<char>('0' + val % 10);
+        val /= 10;
+    } while (val != 0);
+
+    if (num < 0) {
+        *--cur = '-';
+    }
+
+    return operator<<(_arena.copy(cur, end - cur));
+}
+
+CmdArgs& CmdArgs::_append_number(unsigned long long num) {
+    char buf[24];
+    auto *end = buf + sizeof(buf);
+    auto *cur = end;
+
+    do {
+        *--cur = static_cast<char>('0' + num % 10);
+        num /= 10;
+    } while (num != 0);
+
+    return operator<<(_arena.copy(cur, end - cur));
+}
+
+CmdArgs& CmdArgs::_append_number(double num) {
+    // Same format as std::to_string. With *%f*, the integral part of
+    // the max double has DBL_MAX_10_EXP + 1 digits.
+    char buf[DBL_MAX_10_EXP + 20];
+    auto len = std::snprintf(buf, sizeof(buf), "%f", num);
+    if (len < 0 || static_cast<std::size_t>(len) >= sizeof(buf)) {
+        throw Error("Failed to format double argument");
+    }
+
+    return operator<<(_arena.copy(buf, len));
+}
+
+CmdArgs& CmdArgs::_append_number(long double num) {
+    // Long double might be too large to fit into a stack buffer, and it's rarely used.
+    auto str = std::to_string(num);
+
+    return operator<<(_arena.copy(str.data(), str.size()));
+}
+
+}
+
+}
@@ -18,9 +18,10 @@
 #define SEWENEW_REDISPLUSPLUS_COMMAND_ARGS_H
 
 #include <vector>
-#include <list>
+#include <memory>
 #include <string>
 #include <tuple>
+#include <algorithm>
 #include "utils.h"
 
 namespace sw {
@@ -29,6 +30,17 @@ namespace redis {
 
 class CmdArgs {
 public:
+    CmdArgs() = default;
+
+    // argv() points to the inline storage, so CmdArgs is neither copyable nor movable.
+    CmdArgs(const CmdArgs &) = delete;
+    CmdArgs& operator=(const CmdArgs &) = delete;
+
+    CmdArgs(CmdArgs &&) = delete;
+    CmdArgs& operator=(CmdArgs &&) = delete;
+
+    ~CmdArgs() = default;
+
     template <typename Arg>
     CmdArgs& append(Arg &&arg);
 
@@ -69,6 +81,82 @@ public:
     }
 
 private:
+    // A vector of trivial type with inline storage for the first N elements,
+    // i.e. it only allocates when there're more than N elements.
+    template <typename T, std::size_t N>
+    class SmallVector {
+    public:
+        SmallVector() = default;
+
+        SmallVector(const SmallVector &) = delete;
+        SmallVector& operator=(const SmallVector &) = delete;
+
+        void push_back(const T &val) {
+            if (_size == _capacity) {
+                _grow(_capacity * 2);
+            }
+
+            _data[_size++] = val;
+        }
+
+        void reserve(std::size_t capacity) {
+            if (capacity > _capacity) {
+                _grow(capacity);
+            }
+        }
+
+        T* data() {
+            return _data;
+        }
+
+        std::size_t size() const {
+            return _size;
+        }
+
+    private:
+        void _grow(std::size_t capacity) {
+            std::vector<T> heap(capacity);
+            std::copy(_data, _data + _size, heap.begin());
+
+            _heap.swap(heap);
+            _data = _heap.data();
+            _capacity = capacity;
+        }
+
+        T _inline[N];
+
+        std::vector<T> _heap;
+
+        T *_data = _inline;
+
+        std::size_t _size = 0;
+
+        std::size_t _capacity = N;
+    };
+
+    // Owns the converted numbers and deep copied strings. Memory is allocated in chunks,
+    // and never moved, so that pointers in argv() are always valid.
+    class Arena {
+    public:
+        Arena() = default;
+
+        Arena(const Arena &) = delete;
+        Arena& operator=(const Arena &) = delete;
+
+        StringView copy(const char *data, std::size_t size);
+
+    private:
+        char* _allocate(std::size_t size);
+
+        char _inline[256];
+
+        std::vector<std::unique_ptr<char[]>> _chunks;
+
+        char *_cur = _inline;
+
+        std::size_t _left = sizeof(_inline);
+    };
+
     // Deep copy.
     CmdArgs& _append(std::string arg);
 
@@ -91,10 +179,58 @@ private:
     template <typename Iter>
     CmdArgs& _append(std::false_type, const std::pair<Iter, Iter> &range);
 
-    std::vector<const char *> _argv;
-    std::vector<std::size_t> _argv_len;
+    template <typename Iter>
+    void _reserve(std::size_t per_item, Iter first, Iter last, std::random_access_iterator_tag) {
+        auto num = size() + per_item * static_cast<std::size_t>(std::distance(first, last));
+
+        _argv.reserve(num);
+        _argv_len.reserve(num);
+    }
+
+    template <typename Iter>
+    void _reserve(std::size_t, Iter, Iter, std::input_iterator_tag) {}
+
+    // Same as std::to_string, but the result is written to the arena.
+    CmdArgs& _append_number(long long num);
+
+    CmdArgs& _append_number(unsigned long long num);
+
+    CmdArgs& _append_number(double num);
+
+    CmdArgs& _append_number(long double num);
+
+    template <typename T>
+    auto _to_number(T num) ->
+        typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value,
+                                    long long>::type {
+        return num;
+    }
+
+    template <typename T>
+    auto _to_number(T num) ->
+        typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value,
+                                    unsigned long long>::type {
+        return num;
+    }
+
+    // float is converted to double, the same as std::to_string.
+    template <typename T>
+    auto _to_number(T num) ->
+        typename std::enable_if<std::is_floating_point<T>::value
+                                    && !std::is_same<T, long double>::value,
+                                    double>::type {
+        return num;
+    }
+
+    long double _to_number(long double num) {
+        return num;
+    }
+
+    // Most commands have no more than 16 arguments.
+    SmallVector<const char *, 16> _argv;
+    SmallVector<std::size_t, 16> _argv_len;
 
-    std::list<std::string> _args;
+    Arena _arena;
 };
 
 template <typename Arg>
@@ -125,7 +261,7 @@ template <typename T,
              typename std::enable_if<std::is_arithmetic<typename std::decay<T>::type>::value,
                                     int>::type>
 inline CmdArgs& CmdArgs::operator<<(T &&arg) {
-    return _append(std::to_string(std::forward<T>(arg)));
+    return _append_number(_to_number(arg));
 }
 
 template <std::size_t N, typename ...Args>
@@ -137,8 +273,7 @@ auto CmdArgs::operator<<(const std::tuple<Args...> &arg) ->
 }
 
 inline CmdArgs& CmdArgs::_append(std::string arg) {
-    _args.push_back(std::move(arg));
-    return operator<<(_args.back());
+    return operator<<(_arena.copy(arg.data(), arg.size()));
 }
 
 inline CmdArgs& CmdArgs::_append(const StringView &arg) {
@@ -153,6 +288,9 @@ template <typename Iter>
 CmdArgs& CmdArgs::_append(std::false_type, const std::pair<Iter, Iter> &range) {
     auto first = range.first;
     auto last = range.second;
+
+    _reserve(1, first, last, typename std::iterator_traits<Iter>::iterator_category());
+
     while (first != last) {
         *this << *first;
         ++first;
@@ -165,6 +303,9 @@ template <typename Iter>
 CmdArgs& CmdArgs::_append(std::true_type, const std::pair<Iter, Iter> &range) {
     auto first = range.first;
     auto last = range.second;
+
+    _reserve(2, first, last, typename std::iterator_traits<Iter>::iterator_category());
+
     while (first != last) {
         *this << first->first << first->second;
         ++first;
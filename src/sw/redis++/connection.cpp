@@ -16,10 +16,259 @@
 
 #include "connection.h"
 #include <cassert>
+#include <climits>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <hiredis/sds.h>
 #include "reply.h"
 #include "command.h"
 #include "command_args.h"
 
+namespace {
+
+// Arguments larger than this are written to the socket directly,
+// instead of being copied into the output buffer.
+const std::size_t GATHER_THRESHOLD = 64 * 1024;
+
+std::size_t header_size(std::size_t num) {
+    // Prefix, digits and CRLF.
+    std::size_t size = 1 + 1 + 2;
+    while (num >= 10) {
+        num /= 10;
+        ++size;
+    }
+
+    return size;
+}
+
+// Mark the context as broken, the same way as hiredis does.
+void set_error(redisContext &ctx, int err, const char *err_str) {
+    ctx.err = err;
+    std::strncpy(ctx.errstr, err_str, sizeof(ctx.errstr) - 1);
+    ctx.errstr[sizeof(ctx.errstr) - 1] = '\0';
+}
+
+// Write *prefix num CRLF*, e.g. *3\r\n, $5\r\n.
+char* write_header(char *buf, char prefix, std::size_t num) {
+    *buf++ = prefix;
+
+    char digits[24];
+    auto *end = digits + sizeof(digits);
+    auto *cur = end;
+    do {
+        *--cur = static_cast<char>('0' + num % 10);
+        num /= 10;
+    } while (num != 0);
+
+    buf = std::copy(cur, end, buf);
+
+    *buf++ = '\r';
+    *buf++ = '\n';
+
+    return buf;
+}
+
+char* write_crlf(char *buf) {
+    *buf++ = '\r';
+    *buf++ = '\n';
+
+    return buf;
+}
+
+// State of a streaming recv, which is attached to the reader as its private data.
+struct StreamState {
+    const sw::redis::ReplyElementCallback *callback;
+
+    // Functions to create the top level reply.
+    redisReplyObjectFunctions *fn;
+
+    std::exception_ptr err;
+};
+
+// Returned for array elements, which are consumed by the callback, and never kept.
+char STREAM_ELEMENT;
+
+void* stream_element(const redisReadTask *task, redisReply &element) {
+    auto *state = static_cast<StreamState*>(task->privdata);
+    assert(state != nullptr && task->parent != nullptr);
+
+    if (task->parent->parent != nullptr) {
+        // Elements of nested array, which has been reported as an error.
+        return &STREAM_ELEMENT;
+    }
+
+    if (!state->err) {
+        // Never let exceptions propagate through hiredis. Instead, rethrow it after
+        // the whole reply has been read, so that the connection is still in sync.
+        try {
+            (*state->callback)(element);
+        } catch (...) {
+            state->err = std::current_exception();
+        }
+    }
+
+    return &STREAM_ELEMENT;
+}
+
+redisReply make_element(const redisReadTask *task) {
+    redisReply element;
+    std::memset(&element, 0, sizeof(element));
+
+    element.type = task->type;
+
+    return element;
+}
+
+void* stream_create_string(const redisReadTask *task, char *str, size_t len) {
+    if (task->parent == nullptr) {
+        auto *state = static_cast<StreamState*>(task->privdata);
+        return state->fn->createString(task, str, len);
+    }
+
+    // *str* points to the reader's buffer, and it's only valid during the callback.
+    auto element = make_element(task);
+    element.str = str;
+    element.len = len;
+
+    return stream_element(task, element);
+}
+
+#if defined(HIREDIS_MAJOR) && HIREDIS_MAJOR >= 1
+
+// Since hiredis 1.0, the number of elements is of type size_t.
+using ArraySize = size_t;
+
+#else
+
+using ArraySize = int;
+
+#endif
+
+void* stream_create_array(const redisReadTask *task, ArraySize /*elements*/) {
+    auto *state = static_cast<StreamState*>(task->privdata);
+
+    if (task->parent == nullptr) {
+        // Elements are passed to the callback, so the top level array is always empty.
+        return state->fn->createArray(task, 0);
+    }
+
+    if (!state->err) {
+        state->err = std::make_exception_ptr(
+                sw::redis::ProtoError("Nested array reply is not supported in streaming mode"));
+    }
+
+    return &STREAM_ELEMENT;
+}
+
+void* stream_create_integer(const redisReadTask *task, long long val) {
+    if (task->parent == nullptr) {
+        auto *state = static_cast<StreamState*>(task->privdata);
+        return state->fn->createInteger(task, val);
+    }
+
+    auto element = make_element(task);
+    element.integer = val;
+
+    return stream_element(task, element);
+}
+
+void* stream_create_nil(const redisReadTask *task) {
+    if (task->parent == nullptr) {
+        auto *state = static_cast<StreamState*>(task->privdata);
+        return state->fn->createNil(task);
+    }
+
+    auto element = make_element(task);
+
+    return stream_element(task, element);
+}
+
+#if defined(HIREDIS_MAJOR) && HIREDIS_MAJOR >= 1
+
+void* stream_create_double(const redisReadTask *task, double val, char *str, size_t len) {
+    if (task->parent == nullptr) {
+        auto *state = static_cast<StreamState*>(task->privdata);
+        return state->fn->createDouble(task, val, str, len);
+    }
+
+    auto element = make_element(task);
+    element.dval = val;
+    element.str = str;
+    element.len = len;
+
+    return stream_element(task, element);
+}
+
+void* stream_create_bool(const redisReadTask *task, int val) {
+    if (task->parent == nullptr) {
+        auto *state = static_cast<StreamState*>(task->privdata);
+        return state->fn->createBool(task, val);
+    }
+
+    auto element = make_element(task);
+    element.integer = val;
+
+    return stream_element(task, element);
+}
+
+#endif
+
+void stream_free_object(void *obj) {
+    if (obj != &STREAM_ELEMENT) {
+        // The top level reply, which is created by the default functions.
+        freeReplyObject(obj);
+    }
+}
+
+redisReplyObjectFunctions STREAM_FUNCTIONS = {
+    stream_create_string,
+    stream_create_array,
+    stream_create_integer,
+#if defined(HIREDIS_MAJOR) && HIREDIS_MAJOR >= 1
+    stream_create_double,
+    stream_create_nil,
+    stream_create_bool,
+#else
+    stream_create_nil,
+#endif
+    stream_free_object
+};
+
+// Attach the streaming functions to the reader, and restore it when it goes out of scope.
+class StreamGuard {
+public:
+    StreamGuard(redisReader &reader, StreamState &state) :
+                    _reader(reader),
+                    _fn(reader.fn),
+                    _privdata(reader.privdata) {
+        state.fn = _fn;
+
+        _reader.fn = &STREAM_FUNCTIONS;
+        _reader.privdata = &state;
+    }
+
+    ~StreamGuard() {
+        _reader.fn = _fn;
+        _reader.privdata = _privdata;
+    }
+
+private:
+    redisReader &_reader;
+
+    redisReplyObjectFunctions *_fn;
+
+    void *_privdata;
+};
+
+}
+
 namespace sw {
 
 namespace redis {
@@ -102,6 +351,10 @@ private:
 
     void _enable_keep_alive(redisContext &ctx) const;
 
+    void _set_socket_options(redisContext &ctx) const;
+
+    void _set_reader_options(redisContext &ctx) const;
+
     timeval _to_timeval(const std::chrono::milliseconds &dur) const;
 
     const ConnectionOptions &_opts;
@@ -122,6 +375,10 @@ Connection::ContextUPtr Connection::Connector::connect() const {
 
     _enable_keep_alive(*ctx);
 
+    _set_socket_options(*ctx);
+
+    _set_reader_options(*ctx);
+
     return ctx;
 }
 
@@ -188,6 +445,42 @@ void Connection::Connector::_enable_keep_alive(redisContext &ctx) const {
     }
 }
 
+void Connection::Connector::_set_socket_options(redisContext &ctx) const {
+    auto set_option = [&ctx](int level, int name, int val, const char *err_info) {
+        if (setsockopt(ctx.fd, level, name, &val, sizeof(val)) != 0) {
+            throw Error(std::string(err_info) + ": " + std::strerror(errno));
+        }
+    };
+
+    if (_opts.socket_recv_buffer_size > 0) {
+        set_option(SOL_SOCKET, SO_RCVBUF, _opts.socket_recv_buffer_size,
+                "Failed to set SO_RCVBUF");
+    }
+
+    if (_opts.socket_send_buffer_size > 0) {
+        set_option(SOL_SOCKET, SO_SNDBUF, _opts.socket_send_buffer_size,
+                "Failed to set SO_SNDBUF");
+    }
+
+    if (_opts.type == ConnectionType::TCP) {
+        // hiredis enables TCP_NODELAY by default, and we might need to disable it.
+        set_option(IPPROTO_TCP, TCP_NODELAY, _opts.tcp_nodelay ? 1 : 0,
+                "Failed to set TCP_NODELAY");
+    }
+}
+
+void Connection::Connector::_set_reader_options(redisContext &ctx) const {
+    if (_opts.read_buffer_strategy != ReadBufferStrategy::ADAPTIVE) {
+        return;
+    }
+
+    assert(ctx.reader != nullptr);
+
+    // By default, hiredis frees its buffer once it's empty and larger than 16KB,
+    // and it has to be reallocated for the next large reply.
+    ctx.reader->maxbuf = _opts.max_read_buffer_size;
+}
+
 timeval Connection::Connector::_to_timeval(const std::chrono::milliseconds &dur) const {
     auto sec = std::chrono::duration_cast<std::chrono::seconds>(dur);
     auto msec = std::chrono::duration_cast<std::chrono::microseconds>(dur - sec);
@@ -201,15 +494,35 @@ timeval Connection::Connector::_to_timeval(const std::chrono::milliseconds &dur)
 void swap(Connection &lhs, Connection &rhs) noexcept {
     std::swap(lhs._ctx, rhs._ctx);
     std::swap(lhs._last_active, rhs._last_active);
+    std::swap(lhs._create_time, rhs._create_time);
     std::swap(lhs._opts, rhs._opts);
+    std::swap(lhs._node_name, rhs._node_name);
+    std::swap(lhs._last_command, rhs._last_command);
+    std::swap(lhs._tracing, rhs._tracing);
+    std::swap(lhs._last_key, rhs._last_key);
+    std::swap(lhs._last_command_size, rhs._last_command_size);
+    std::swap(lhs._tracking_redirect, rhs._tracking_redirect);
+    std::swap(lhs._read_buffer, rhs._read_buffer);
+    std::swap(lhs._read_size, rhs._read_size);
 }
 
 Connection::Connection(const ConnectionOptions &opts) :
             _ctx(Connector(opts).connect()),
             _last_active(std::chrono::steady_clock::now()),
+            _create_time(_last_active),
             _opts(opts) {
     assert(_ctx && !broken());
 
+    if (_opts.type == ConnectionType::UNIX) {
+        _node_name = _opts.path;
+    } else {
+        _node_name = _opts.host + ":" + std::to_string(_opts.port);
+    }
+
+    if (_opts.read_buffer_strategy == ReadBufferStrategy::ADAPTIVE) {
+        _read_size = std::max<std::size_t>(_opts.read_buffer_size, 1);
+    }
+
     _set_options();
 }
 
@@ -219,34 +532,67 @@ void Connection::reconnect() {
     swap(*this, connection);
 }
 
+void Connection::invalidate() noexcept {
+    assert(_ctx);
+
+    if (_ctx->err == REDIS_OK) {
+        set_error(*_ctx, REDIS_ERR_OTHER, "Connection has been invalidated");
+    }
+}
+
 void Connection::send(int argc, const char **argv, const std::size_t *argv_len) {
     auto ctx = _context();
 
-    assert(ctx != nullptr);
+    assert(ctx != nullptr && argc > 0);
 
-    if (redisAppendCommandArgv(ctx,
-                                argc,
-                                argv,
-                                argv_len) != REDIS_OK) {
-        throw_error(*ctx, "Failed to send command");
+    _last_command.assign(argv[0], argv_len[0]);
+
+    // Total size of the encoded command, and size of the large arguments.
+    auto size = header_size(argc);
+    std::size_t gather_size = 0;
+    for (auto idx = 0; idx != argc; ++idx) {
+        auto len = argv_len[idx];
+        size += header_size(len) + len + 2;
+
+        if (len >= GATHER_THRESHOLD) {
+            gather_size += len;
+        }
+    }
+
+    if (_tracing) {
+        if (argc > 1) {
+            _last_key.assign(argv[1], argv_len[1]);
+        } else {
+            _last_key.clear();
+        }
+
+        _last_command_size = size;
+    }
+
+    if (gather_size == 0) {
+        _append_command(*ctx, argc, argv, argv_len, size);
+    } else {
+        _write_command(*ctx, argc, argv, argv_len, size, gather_size);
     }
 
     assert(!broken());
 }
 
 void Connection::send(CmdArgs &args) {
-    auto ctx = _context();
+    send(static_cast<int>(args.size()), args.argv(), args.argv_len());
+}
 
-    assert(ctx != nullptr);
+void Connection::flush() {
+    auto *ctx = _context();
 
-    if (redisAppendCommandArgv(ctx,
-                                args.size(),
-                                args.argv(),
-                                args.argv_len()) != REDIS_OK) {
-        throw_error(*ctx, "Failed to send command");
-    }
+    assert(ctx != nullptr);
 
-    assert(!broken());
+    int done = 0;
+    do {
+        if (redisBufferWrite(ctx, &done) != REDIS_OK) {
+            throw_error(*ctx, "Failed to flush commands");
+        }
+    } while (!done);
 }
 
 ReplyUPtr Connection::recv() {
@@ -255,7 +601,7 @@ ReplyUPtr Connection::recv() {
     assert(ctx != nullptr);
 
     void *r = nullptr;
-    if (redisGetReply(ctx, &r) != REDIS_OK) {
+    if (_get_reply(*ctx, &r) != REDIS_OK) {
         throw_error(*ctx, "Failed to get reply");
     }
 
@@ -270,10 +616,310 @@ ReplyUPtr Connection::recv() {
     return reply;
 }
 
+void Connection::_append_command(redisContext &ctx,
+                                    int argc,
+                                    const char **argv,
+                                    const std::size_t *argv_len,
+                                    std::size_t size) {
+    // Encode the command in place, i.e. no intermediate buffer.
+    auto obuf = sdsMakeRoomFor(ctx.obuf, size);
+    if (obuf == nullptr) {
+        throw OomError("Failed to send command: out of memory");
+    }
+
+    ctx.obuf = obuf;
+
+    auto *buf = obuf + sdslen(obuf);
+    buf = write_header(buf, '*', argc);
+    for (auto idx = 0; idx != argc; ++idx) {
+        auto len = argv_len[idx];
+        buf = write_header(buf, '$', len);
+
+        if (len > 0) {
+            std::memcpy(buf, argv[idx], len);
+            buf += len;
+        }
+
+        buf = write_crlf(buf);
+    }
+
+    assert(static_cast<std::size_t>(buf - (obuf + sdslen(obuf))) == size);
+
+    sdsIncrLen(obuf, static_cast<int>(size));
+}
+
+void Connection::_send_traced(const char *cmd, int len) {
+    assert(cmd != nullptr && len > 0);
+
+    std::unique_ptr<char, void (*)(char *)> guard(const_cast<char *>(cmd), redisFreeCommand);
+
+    // The command is encoded as *<argc>\r\n$<len>\r\n<name>\r\n$<len>\r\n<key>\r\n...
+    // Skip the array header and the command name, and get the first argument, if any.
+    _last_key.clear();
+
+    const char *end = cmd + len;
+    const char *pos = static_cast<const char *>(std::memchr(cmd, '\n', len));
+    for (auto idx = 0; idx != 2 && pos != nullptr && pos + 1 < end; ++idx) {
+        // Now, *pos* points to the '\n' before the '$' of the bulk string.
+        ++pos;
+        auto arg_len = std::strtoll(pos + 1, nullptr, 10);
+        pos = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+        if (pos == nullptr || arg_len < 0 || pos + 1 + arg_len > end) {
+            break;
+        }
+
+        if (idx == 1) {
+            _last_key.assign(pos + 1, arg_len);
+        } else {
+            // Skip the argument and the trailing "\r\n", and point to the last '\n'.
+            pos += arg_len + 2;
+        }
+    }
+
+    _last_command_size = len;
+
+    auto *ctx = _ctx.get();
+    if (redisAppendFormattedCommand(ctx, cmd, len) != REDIS_OK) {
+        throw_error(*ctx, "Failed to send command");
+    }
+}
+
+int Connection::_get_reply(redisContext &ctx, void **reply) {
+    if (_read_size == 0) {
+        // ReadBufferStrategy::DEFAULT
+        return redisGetReply(&ctx, reply);
+    }
+
+    // Same as redisGetReply: try the buffered data, flush the pending commands,
+    // and read until a complete reply is parsed.
+    if (redisGetReplyFromReader(&ctx, reply) != REDIS_OK) {
+        return REDIS_ERR;
+    }
+
+    if (*reply != nullptr) {
+        return REDIS_OK;
+    }
+
+    int done = 0;
+    do {
+        if (redisBufferWrite(&ctx, &done) != REDIS_OK) {
+            return REDIS_ERR;
+        }
+    } while (!done);
+
+    do {
+        if (_read(ctx) != REDIS_OK) {
+            return REDIS_ERR;
+        }
+
+        if (redisGetReplyFromReader(&ctx, reply) != REDIS_OK) {
+            return REDIS_ERR;
+        }
+    } while (*reply == nullptr);
+
+    return REDIS_OK;
+}
+
+int Connection::_read(redisContext &ctx) {
+    assert(ctx.reader != nullptr);
+
+    auto size = _next_read_size(*ctx.reader);
+    if (_read_buffer.size() < size) {
+        _read_buffer.resize(size);
+    }
+
+    ssize_t len = 0;
+    do {
+        len = ::read(ctx.fd, _read_buffer.data(), size);
+    } while (len < 0 && errno == EINTR);
+
+    if (len < 0) {
+        // *throw_error* checks errno to tell timeout from other IO errors,
+        // and std::strerror does NOT change errno.
+        set_error(ctx, REDIS_ERR_IO, std::strerror(errno));
+        return REDIS_ERR;
+    }
+
+    if (len == 0) {
+        set_error(ctx, REDIS_ERR_EOF, "Server closed the connection");
+        return REDIS_ERR;
+    }
+
+    if (redisReaderFeed(ctx.reader, _read_buffer.data(), len) != REDIS_OK) {
+        set_error(ctx, ctx.reader->err, ctx.reader->errstr);
+        return REDIS_ERR;
+    }
+
+    auto max_size = std::max(_opts.max_read_buffer_size, _opts.read_buffer_size);
+    if (static_cast<std::size_t>(len) == size && size >= _read_size) {
+        // The buffer is filled, and there might be more data.
+        _read_size = std::min(_read_size * 2, max_size);
+    } else if (static_cast<std::size_t>(len) < _read_size / 4) {
+        _read_size = std::max(_read_size / 2, _opts.read_buffer_size);
+
+        // Replies become small again, so release the memory taken by large ones.
+        // resize and shrink_to_fit are NOT guaranteed to do that, so reallocate it.
+        if (_read_buffer.capacity() > _read_size * 4) {
+            std::vector<char>(_read_size).swap(_read_buffer);
+        }
+    }
+
+    return REDIS_OK;
+}
+
+std::size_t Connection::_next_read_size(const redisReader &reader) const {
+    auto max_size = std::max(_opts.max_read_buffer_size, _opts.read_buffer_size);
+
+    // hiredis does NOT consume a bulk string, until it's complete. So if the pending data
+    // starts with a bulk string header, we know how many bytes are still needed.
+    if (reader.buf == nullptr || reader.pos >= reader.len || reader.buf[reader.pos] != '$') {
+        return _read_size;
+    }
+
+    const auto *begin = reader.buf + reader.pos;
+    const auto *end = reader.buf + reader.len;
+    const auto *crlf = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+    if (crlf == nullptr) {
+        return _read_size;
+    }
+
+    auto bulk_len = std::strtoll(begin + 1, nullptr, 10);
+    if (bulk_len <= 0) {
+        return _read_size;
+    }
+
+    // Header, data and the trailing CRLF.
+    auto total = static_cast<std::size_t>(crlf + 1 - begin)
+                    + static_cast<std::size_t>(bulk_len) + 2;
+    auto available = static_cast<std::size_t>(end - begin);
+    if (total <= available) {
+        return _read_size;
+    }
+
+    return std::min(std::max(total - available, _read_size), max_size);
+}
+
+void Connection::_write_command(redisContext &ctx,
+                                int argc,
+                                const char **argv,
+                                const std::size_t *argv_len,
+                                std::size_t size,
+                                std::size_t gather_size) {
+    // Commands in the output buffer should be sent before this one.
+    flush();
+
+    // Headers and small arguments are encoded into *scratch*, and large arguments
+    // are referenced by iovecs directly. *scratch* never grows, so pointers are stable.
+    std::vector<char> scratch(size - gather_size);
+    std::vector<iovec> iov;
+
+    auto *start = scratch.data();
+    auto *buf = write_header(start, '*', argc);
+    for (auto idx = 0; idx != argc; ++idx) {
+        auto len = argv_len[idx];
+        buf = write_header(buf, '$', len);
+
+        if (len >= GATHER_THRESHOLD) {
+            iov.push_back(iovec{start, static_cast<std::size_t>(buf - start)});
+            iov.push_back(iovec{const_cast<char*>(argv[idx]), len});
+            start = buf;
+        } else if (len > 0) {
+            std::memcpy(buf, argv[idx], len);
+            buf += len;
+        }
+
+        buf = write_crlf(buf);
+    }
+
+    assert(buf == scratch.data() + scratch.size());
+
+    iov.push_back(iovec{start, static_cast<std::size_t>(buf - start)});
+
+    std::size_t idx = 0;
+    while (idx != iov.size()) {
+        auto cnt = std::min<std::size_t>(iov.size() - idx, IOV_MAX);
+        auto written = ::writev(ctx.fd, iov.data() + idx, static_cast<int>(cnt));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            auto err = errno;
+
+            // The command might be partially written, so the connection is broken.
+            set_error(ctx, REDIS_ERR_IO, std::strerror(err));
+
+            auto err_msg = std::string("Failed to send command: ") + ctx.errstr;
+            if (err == EAGAIN || err == EWOULDBLOCK) {
+                throw TimeoutError(err_msg);
+            } else {
+                throw IoError(err_msg);
+            }
+        }
+
+        auto left = static_cast<std::size_t>(written);
+        while (idx != iov.size() && left >= iov[idx].iov_len) {
+            left -= iov[idx].iov_len;
+            ++idx;
+        }
+
+        if (left > 0) {
+            assert(idx != iov.size());
+
+            iov[idx].iov_base = static_cast<char*>(iov[idx].iov_base) + left;
+            iov[idx].iov_len -= left;
+        }
+    }
+}
+
+ReplyUPtr Connection::recv(const ReplyElementCallback &callback) {
+    auto *ctx = _context();
+
+    assert(ctx != nullptr && ctx->reader != nullptr);
+
+    StreamState state{&callback, nullptr, nullptr};
+
+    void *r = nullptr;
+    {
+        StreamGuard guard(*ctx->reader, state);
+
+        if (_get_reply(*ctx, &r) != REDIS_OK) {
+            try {
+                throw_error(*ctx, "Failed to get reply");
+            } catch (const TimeoutError &) {
+                // The partially parsed reply refers to the streaming state,
+                // so the connection CANNOT be reused, even if it's a timeout.
+                ctx->err = REDIS_ERR_IO;
+                throw;
+            }
+        }
+    }
+
+    assert(!broken() && r != nullptr);
+
+    auto reply = ReplyUPtr(static_cast<redisReply*>(r));
+
+    if (reply::is_error(*reply)) {
+        throw_error(*reply);
+    }
+
+    if (state.err) {
+        std::rethrow_exception(state.err);
+    }
+
+    if (!reply::is_array(*reply)) {
+        throw ProtoError("Expect ARRAY reply");
+    }
+
+    return reply;
+}
+
 void Connection::_set_options() {
     _auth();
 
     _select_db();
+
+    _enable_readonly();
 }
 
 void Connection::_auth() {
@@ -300,6 +946,18 @@ void Connection::_select_db() {
     reply::parse<void>(*reply);
 }
 
+void Connection::_enable_readonly() {
+    if (!_opts.readonly) {
+        return;
+    }
+
+    cmd::readonly(*this);
+
+    auto reply = recv();
+
+    reply::parse<void>(*reply);
+}
+
 }
 
 }
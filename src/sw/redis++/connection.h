@@ -22,7 +22,9 @@
 #include <memory>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <chrono>
+#include <functional>
 #include <hiredis/hiredis.h>
 #include "errors.h"
 #include "reply.h"
@@ -37,6 +39,20 @@ enum class ConnectionType {
     UNIX
 };
 
+enum class ReadBufferStrategy {
+    // Let hiredis read the socket, i.e. at most 16KB for each read, and hiredis frees
+    // its buffer whenever the buffer is empty and larger than 16KB.
+    DEFAULT = 0,
+
+    // Read the socket with a buffer owned by the connection, which is reused by all reads.
+    // The read size doubles if a read fills the buffer, and if an incomplete bulk string
+    // is pending, the remaining part of it is read at once. The read size halves if reads
+    // are much smaller than it, and the buffer is shrunk if it's much larger than the read
+    // size. Also hiredis keeps its buffer as long as it's NOT larger than
+    // *ConnectionOptions::max_read_buffer_size*.
+    ADAPTIVE
+};
+
 struct ConnectionOptions {
 public:
     ConnectionOptions() = default;
@@ -69,6 +85,25 @@ public:
 
     std::chrono::milliseconds socket_timeout{0};
 
+    // Send READONLY after connected, so that read commands can be sent to
+    // a replica node of Redis Cluster.
+    bool readonly = false;
+
+    ReadBufferStrategy read_buffer_strategy = ReadBufferStrategy::DEFAULT;
+
+    // Initial and max read size of ReadBufferStrategy::ADAPTIVE.
+    std::size_t read_buffer_size = 16 * 1024;
+
+    std::size_t max_read_buffer_size = 4 * 1024 * 1024;
+
+    // SO_RCVBUF and SO_SNDBUF of the socket. 0 means the system default.
+    int socket_recv_buffer_size = 0;
+
+    int socket_send_buffer_size = 0;
+
+    // Disable Nagle's algorithm, i.e. TCP_NODELAY, for TCP connections.
+    bool tcp_nodelay = true;
+
 private:
     ConnectionOptions _parse_options(const std::string &uri) const;
 
@@ -82,6 +117,9 @@ private:
 
 class CmdArgs;
 
+// Called with each element of an ARRAY reply, as soon as the element is parsed.
+using ReplyElementCallback = std::function<void (redisReply &)>;
+
 class Connection {
 public:
     explicit Connection(const ConnectionOptions &opts);
@@ -103,24 +141,83 @@ public:
 
     void reconnect();
 
+    // Mark the connection as broken, e.g. it has unread replies, or its state has been
+    // changed, so that it will be reconnected before it's reused.
+    void invalidate() noexcept;
+
     auto last_active() const
         -> std::chrono::time_point<std::chrono::steady_clock> {
         return _last_active;
     }
 
+    // The time that the connection is created or reconnected.
+    auto create_time() const
+        -> std::chrono::time_point<std::chrono::steady_clock> {
+        return _create_time;
+    }
+
     template <typename ...Args>
     void send(const char *format, Args &&...args);
 
+    // Encode the command with RESP, and append it to the output buffer. However, if some
+    // argument is very large, the buffered commands are flushed, and the command is written
+    // to the socket with writev, so that the large argument is never copied.
     void send(int argc, const char **argv, const std::size_t *argv_len);
 
     void send(CmdArgs &args);
 
+    // Write all buffered commands to the socket without waiting for replies.
+    // Normally, there's no need to call it, since *recv* flushes the buffer.
+    void flush();
+
     ReplyUPtr recv();
 
+    // Streaming version of *recv*. Elements of the ARRAY reply are passed to *callback*
+    // as soon as they're parsed, and they're NOT kept in the returned reply, i.e. the
+    // returned reply is an ARRAY reply without elements. So memory usage is bounded,
+    // no matter how large the reply is. Nested arrays are NOT supported.
+    ReplyUPtr recv(const ReplyElementCallback &callback);
+
     const ConnectionOptions& options() const {
         return _opts;
     }
 
+    // *host:port*, or path of the unix domain socket. It's built once when the connection
+    // is created, so that metrics and tracers don't need to format it for each command.
+    const std::string& node_name() const {
+        return _node_name;
+    }
+
+    // Name of the last command sent with the connection, e.g. GET.
+    const std::string& last_command() const {
+        return _last_command;
+    }
+
+    // If enabled, the first argument and the size of each command are recorded,
+    // i.e. *last_key* and *last_command_size*. It's used by Tracer.
+    void enable_tracing(bool enable) {
+        _tracing = enable;
+    }
+
+    const std::string& last_key() const {
+        return _last_key;
+    }
+
+    std::size_t last_command_size() const {
+        return _last_command_size;
+    }
+
+    // Id of the client that invalidation messages are redirected to, i.e. the one set with
+    // *CLIENT TRACKING ON REDIRECT id*, or -1 if tracking is NOT enabled. It's reset, when
+    // the connection is reconnected. It's used by ClientCache.
+    long long tracking_redirect() const {
+        return _tracking_redirect;
+    }
+
+    void set_tracking_redirect(long long client_id) {
+        _tracking_redirect = client_id;
+    }
+
     friend void swap(Connection &lhs, Connection &rhs) noexcept;
 
 private:
@@ -142,15 +239,62 @@ private:
 
     void _select_db();
 
+    void _enable_readonly();
+
     redisContext* _context();
 
+    void _append_command(redisContext &ctx,
+                            int argc,
+                            const char **argv,
+                            const std::size_t *argv_len,
+                            std::size_t size);
+
+    void _write_command(redisContext &ctx,
+                            int argc,
+                            const char **argv,
+                            const std::size_t *argv_len,
+                            std::size_t size,
+                            std::size_t gather_size);
+
+    // Send the RESP encoded command, and record its first argument and size.
+    void _send_traced(const char *cmd, int len);
+
+    // Same as redisGetReply, except that it reads the socket with *_read_buffer*,
+    // if ReadBufferStrategy::ADAPTIVE is used.
+    int _get_reply(redisContext &ctx, void **reply);
+
+    int _read(redisContext &ctx);
+
+    std::size_t _next_read_size(const redisReader &reader) const;
+
     ContextUPtr _ctx;
 
     // The time that the connection is created or the time that
     // the connection is used, i.e. *context()* is called.
     std::chrono::time_point<std::chrono::steady_clock> _last_active{};
 
+    std::chrono::time_point<std::chrono::steady_clock> _create_time{};
+
     ConnectionOptions _opts;
+
+    std::string _node_name;
+
+    // Command names are short, so it's usually stored inline, i.e. no allocation.
+    std::string _last_command;
+
+    bool _tracing = false;
+
+    // Only recorded if *_tracing* is true.
+    std::string _last_key;
+
+    std::size_t _last_command_size = 0;
+
+    long long _tracking_redirect = -1;
+
+    // Only used with ReadBufferStrategy::ADAPTIVE.
+    std::vector<char> _read_buffer;
+
+    std::size_t _read_size = 0;
 };
 
 using ConnectionSPtr = std::shared_ptr<Connection>;
@@ -168,7 +312,19 @@ inline void Connection::send(const char *format, Args &&...args) {
 
     assert(ctx != nullptr);
 
-    if (redisAppendCommand(ctx,
+    // The command name is the first word of the format string.
+    _last_command.assign(format, std::strcspn(format, " "));
+
+    if (_tracing) {
+        // Format it by ourselves to get the arguments and size of the encoded command.
+        char *cmd = nullptr;
+        auto len = redisFormatCommand(&cmd, format, std::forward<Args>(args)...);
+        if (len < 0) {
+            throw Error("Failed to format command: " + _last_command);
+        }
+
+        _send_traced(cmd, len);
+    } else if (redisAppendCommand(ctx,
                 format,
                 std::forward<Args>(args)...) != REDIS_OK) {
         throw_error(*ctx, "Failed to send command");
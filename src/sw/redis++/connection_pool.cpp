@@ -16,8 +16,25 @@
 
 #include "connection_pool.h"
 #include <cassert>
+#include <algorithm>
+#include <system_error>
+#include <thread>
+#include "command.h"
 #include "errors.h"
 
+namespace {
+
+// Threads are assigned to shards in a round-robin way, when they use a pool for the first time.
+std::size_t thread_index() {
+    static std::atomic<std::size_t> next_index{0};
+
+    thread_local std::size_t index = next_index++;
+
+    return index;
+}
+
+}
+
 namespace sw {
 
 namespace redis {
@@ -30,7 +47,20 @@ ConnectionPool::ConnectionPool(const ConnectionPoolOptions &pool_opts,
         throw Error("CANNOT create an empty pool");
     }
 
-    // Lazily create connections.
+    if (_pool_opts.min_idle > _pool_opts.size) {
+        throw Error("min_idle should NOT be larger than pool size");
+    }
+
+    if (_pool_opts.max_idle != 0 && _pool_opts.max_idle < _pool_opts.min_idle) {
+        throw Error("max_idle should NOT be less than min_idle");
+    }
+
+    _init_shards();
+
+    // Other connections are created lazily.
+    warm_up(_pool_opts.min_idle);
+
+    _start_maintainer();
 }
 
 ConnectionPool::ConnectionPool(SimpleSentinel sentinel,
@@ -49,86 +79,149 @@ ConnectionPool::ConnectionPool(SimpleSentinel sentinel,
         throw Error("With sentinel, connection timeout and socket timeout cannot be 0");
     }
 
+    if (_pool_opts.min_idle > _pool_opts.size) {
+        throw Error("min_idle should NOT be larger than pool size");
+    }
+
+    if (_pool_opts.max_idle != 0 && _pool_opts.max_idle < _pool_opts.min_idle) {
+        throw Error("max_idle should NOT be less than min_idle");
+    }
+
     // Cleanup connection options.
     _update_connection_opts("", -1);
 
     assert(_sentinel);
+
+    _init_shards();
+
+    warm_up(_pool_opts.min_idle);
+
+    _start_maintainer();
+}
+
+ConnectionPool::ConnectionPool() {
+    _init_shards();
 }
 
 ConnectionPool::ConnectionPool(ConnectionPool &&that) {
-    std::lock_guard<std::mutex> lock(that._mutex);
+    // The maintainer thread refers to *that*, so stop it, and start a new one for this object.
+    that._stop_maintainer();
+
+    {
+        std::lock_guard<std::mutex> lock(that._mutex);
+
+        _move(std::move(that));
+    }
 
-    _move(std::move(that));
+    _start_maintainer();
 }
 
 ConnectionPool& ConnectionPool::operator=(ConnectionPool &&that) {
     if (this != &that) {
-        std::lock(_mutex, that._mutex);
-        std::lock_guard<std::mutex> lock_this(_mutex, std::adopt_lock);
-        std::lock_guard<std::mutex> lock_that(that._mutex, std::adopt_lock);
+        _stop_maintainer();
+        that._stop_maintainer();
 
-        _move(std::move(that));
+        {
+            std::lock(_mutex, that._mutex);
+            std::lock_guard<std::mutex> lock_this(_mutex, std::adopt_lock);
+            std::lock_guard<std::mutex> lock_that(that._mutex, std::adopt_lock);
+
+            _move(std::move(that));
+        }
+
+        _start_maintainer();
     }
 
     return *this;
 }
 
+ConnectionPool::~ConnectionPool() {
+    _stop_maintainer();
+}
+
 Connection ConnectionPool::fetch() {
-    std::unique_lock<std::mutex> lock(_mutex);
+    // Computed when we wait for the first time.
+    auto deadline = std::chrono::steady_clock::time_point::min();
+    std::chrono::steady_clock::time_point wait_start;
 
-    if (_pool.empty()) {
-        if (_used_connections == _pool_opts.size) {
-            _wait_for_connection(lock);
-        } else {
-            // Lazily create a new connection.
-            auto connection = _create();
+    while (true) {
+        std::unique_lock<std::mutex> lock;
+        auto *shard = _lock_idle_shard(lock);
+        if (shard != nullptr) {
+            auto connection = _pop(*shard);
 
-            ++_used_connections;
+            _count_reused(*shard);
 
-            return connection;
-        }
-    }
+            lock.unlock();
 
-    // _pool is NOT empty.
-    auto connection = _fetch();
+            _record_wait(deadline, wait_start);
 
-    auto connection_lifetime = _pool_opts.connection_lifetime;
+            return _prepare(std::move(connection));
+        }
 
-    if (_sentinel) {
-        auto opts = _opts;
-        auto role_changed = _role_changed(connection.options());
-        auto sentinel = _sentinel;
+        if (_reserve()) {
+            _record_wait(deadline, wait_start);
 
-        lock.unlock();
+            // Lazily create a new connection.
+            return _create_reserved();
+        }
 
-        if (role_changed || _need_reconnect(connection, connection_lifetime)) {
-            try {
-                connection = _create(sentinel, opts, false);
-            } catch (const Error &e) {
-                // Failed to reconnect, return it to the pool, and retry latter.
-                release(std::move(connection));
-                throw;
+        if (deadline == std::chrono::steady_clock::time_point::min()) {
+            wait_start = std::chrono::steady_clock::now();
+
+            auto timeout = _pool_opts.wait_timeout;
+            if (timeout > std::chrono::milliseconds(0)) {
+                deadline = wait_start + timeout;
+            } else {
+                deadline = std::chrono::steady_clock::time_point::max();
             }
         }
 
+        try {
+            _wait_for_connection(deadline);
+        } catch (const Error &) {
+            _record_wait(deadline, wait_start);
+            throw;
+        }
+    }
+}
+
+Connection ConnectionPool::borrow() {
+    std::unique_lock<std::mutex> lock;
+    auto *shard = _lock_idle_shard(lock);
+    if (shard == nullptr) {
+        auto connection = create();
+
+        ++_created;
+
         return connection;
     }
 
+    auto connection = _pop(*shard);
+
+    _count_reused(*shard);
+
     lock.unlock();
 
-    if (_need_reconnect(connection, connection_lifetime)) {
-        try {
-            connection.reconnect();
-        } catch (const Error &e) {
-            // Failed to reconnect, return it to the pool, and retry latter.
-            release(std::move(connection));
-            throw;
-        }
-    }
+    connection = _prepare(std::move(connection));
+
+    // Detach it from the pool, so that others can create a new one, if needed.
+    --_used_connections;
+
+    _notify();
 
     return connection;
 }
 
+void ConnectionPool::reclaim(Connection connection) {
+    if (!_reserve()) {
+        // Pool is full, and the connection is closed.
+        return;
+    }
+
+    _push(_home_shard(), std::move(connection));
+}
+
 ConnectionOptions ConnectionPool::connection_options() {
     std::lock_guard<std::mutex> lock(_mutex);
 
@@ -136,13 +229,103 @@ ConnectionOptions ConnectionPool::connection_options() {
 }
 
 void ConnectionPool::release(Connection connection) {
-    {
-        std::lock_guard<std::mutex> lock(_mutex);
+    if (_suspended.load(std::memory_order_relaxed)) {
+        // Close it, and give up its place.
+        _cancel_reservation(1);
+        return;
+    }
+
+    _push(_home_shard(), std::move(connection));
+}
+
+ConnectionPoolStats ConnectionPool::stats() {
+    ConnectionPoolStats stats;
+    stats.created = _created;
+    stats.reconnects = _reconnects;
+    stats.create_failures = _create_failures;
+
+    std::size_t idle = 0;
+    for (const auto &shard : _shards) {
+        idle += shard->idle.load(std::memory_order_relaxed);
+        stats.reused += shard->reused.load(std::memory_order_relaxed);
+    }
+
+    // Counters are loaded independently, so make sure the numbers are sane.
+    auto used = _used_connections.load();
+    stats.idle = idle;
+    stats.in_use = used > idle ? used - idle : 0;
+
+    stats.wait_time = _wait_time->stats();
+
+    return stats;
+}
+
+void ConnectionPool::warm_up(std::size_t num) {
+    if (_suspended) {
+        return;
+    }
+
+    std::size_t reserved = 0;
+    for (auto idle = _idle_num(); idle + reserved < num; ++reserved) {
+        // Reserve places for new connections, so that the pool never exceeds its size.
+        if (!_reserve()) {
+            break;
+        }
+    }
+
+    std::vector<std::future<Connection>> futures;
+    futures.reserve(reserved);
+    try {
+        for (std::size_t idx = 0; idx != reserved; ++idx) {
+            futures.push_back(std::async(std::launch::async, [this]() { return this->create(); }));
+        }
+    } catch (const std::system_error &) {
+        // Failed to start a thread, and create connections as much as possible.
+        _cancel_reservation(reserved - futures.size());
+    }
+
+    for (std::size_t idx = 0; idx != futures.size(); ++idx) {
+        try {
+            auto connection = futures[idx].get();
+
+            ++_created;
+
+            // Spread connections to all shards.
+            _push(*_shards[idx % _shards.size()], std::move(connection));
+        } catch (const Error &) {
+            _cancel_reservation(1);
+        }
+    }
+}
+
+void ConnectionPool::suspend() {
+    _suspended = true;
+
+    _stop_maintainer();
+
+    // Close all idle connections.
+    while (true) {
+        std::unique_lock<std::mutex> lock;
+        auto *shard = _lock_idle_shard(lock);
+        if (shard == nullptr) {
+            break;
+        }
+
+        _pop(*shard);
+
+        lock.unlock();
 
-        _pool.push_back(std::move(connection));
+        _cancel_reservation(1);
     }
+}
+
+void ConnectionPool::resume() {
+    _suspended = false;
+
+    // Might be resumed without being suspended.
+    _stop_maintainer();
 
-    _cv.notify_one();
+    _start_maintainer();
 }
 
 Connection ConnectionPool::create() {
@@ -150,34 +333,51 @@ Connection ConnectionPool::create() {
 
     auto opts = _opts;
 
-    if (_sentinel) {
-        auto sentinel = _sentinel;
+    try {
+        if (_sentinel) {
+            auto sentinel = _sentinel;
 
-        lock.unlock();
+            lock.unlock();
 
-        return _create(sentinel, opts, false);
-    } else {
-        lock.unlock();
+            return _create(sentinel, opts, false);
+        } else {
+            lock.unlock();
 
-        return Connection(opts);
+            return Connection(opts);
+        }
+    } catch (const Error &) {
+        ++_create_failures;
+        throw;
     }
 }
 
 void ConnectionPool::_move(ConnectionPool &&that) {
     _opts = std::move(that._opts);
     _pool_opts = std::move(that._pool_opts);
-    _pool = std::move(that._pool);
-    _used_connections = that._used_connections;
+    _shards = std::move(that._shards);
+    _used_connections = that._used_connections.load();
+    _created = that._created.load();
+    _reconnects = that._reconnects.load();
+    _create_failures = that._create_failures.load();
+    _wait_time = std::move(that._wait_time);
     _sentinel = std::move(that._sentinel);
+    _suspended = that._suspended.load();
 }
 
-Connection ConnectionPool::_create() {
-    if (_sentinel) {
-        // Get Redis host and port info from sentinel.
-        return _create(_sentinel, _opts, true);
+void ConnectionPool::_init_shards() {
+    auto num = _pool_opts.shards;
+    if (num == 0) {
+        num = std::max(std::thread::hardware_concurrency(), 1U);
     }
 
-    return Connection(_opts);
+    // No need to have more shards than connections.
+    num = std::max<std::size_t>(std::min(num, _pool_opts.size), 1);
+
+    _shards.clear();
+    _shards.reserve(num);
+    for (std::size_t idx = 0; idx != num; ++idx) {
+        _shards.emplace_back(new Shard);
+    }
 }
 
 Connection ConnectionPool::_create(SimpleSentinel &sentinel,
@@ -203,28 +403,230 @@ Connection ConnectionPool::_create(SimpleSentinel &sentinel,
     }
 }
 
-Connection ConnectionPool::_fetch() {
-    assert(!_pool.empty());
+auto ConnectionPool::_home_shard() -> Shard& {
+    assert(!_shards.empty());
+
+    return *_shards[thread_index() % _shards.size()];
+}
+
+auto ConnectionPool::_lock_idle_shard(std::unique_lock<std::mutex> &lock) -> Shard* {
+    auto home = thread_index();
+    for (std::size_t idx = 0; idx != _shards.size(); ++idx) {
+        // Try the home shard first, and then steal from others.
+        auto &shard = *_shards[(home + idx) % _shards.size()];
+
+        // Skip empty shards without taking their locks.
+        if (shard.idle.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> shard_lock(shard.mutex);
+        if (!shard.connections.empty()) {
+            lock = std::move(shard_lock);
+
+            return &shard;
+        }
+    }
+
+    return nullptr;
+}
+
+std::size_t ConnectionPool::_idle_num() const {
+    std::size_t idle = 0;
+    for (const auto &shard : _shards) {
+        idle += shard->idle.load(std::memory_order_relaxed);
+    }
+
+    return idle;
+}
+
+Connection ConnectionPool::_pop(Shard &shard) {
+    assert(!shard.connections.empty());
 
-    auto connection = std::move(_pool.front());
-    _pool.pop_front();
+    auto connection = std::move(shard.connections.front());
+    shard.connections.pop_front();
+
+    // Only updated with the shard's lock held, so there's no need for an atomic RMW.
+    shard.idle.store(shard.connections.size(), std::memory_order_relaxed);
 
     return connection;
 }
 
-void ConnectionPool::_wait_for_connection(std::unique_lock<std::mutex> &lock) {
-    auto timeout = _pool_opts.wait_timeout;
-    if (timeout > std::chrono::milliseconds(0)) {
-        // Wait until _pool is no longer empty or timeout.
-        if (!_cv.wait_for(lock,
-                    timeout,
-                    [this] { return !(this->_pool).empty(); })) {
-            throw Error("Failed to fetch a connection in "
-                    + std::to_string(timeout.count()) + " milliseconds");
+void ConnectionPool::_count_reused(Shard &shard) {
+    shard.reused.store(shard.reused.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+}
+
+void ConnectionPool::_push(Shard &shard, Connection connection) {
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        shard.connections.push_back(std::move(connection));
+
+        shard.idle.store(shard.connections.size(), std::memory_order_relaxed);
+    }
+
+    _notify();
+}
+
+Connection ConnectionPool::_prepare(Connection connection) {
+    try {
+        _reconnect_if_needed(connection);
+    } catch (const Error &e) {
+        // Failed to reconnect, return it to the pool, and retry latter.
+        release(std::move(connection));
+        throw;
+    }
+
+    return connection;
+}
+
+bool ConnectionPool::_reconnect_if_needed(Connection &connection) {
+    auto connection_lifetime = _pool_opts.connection_lifetime;
+
+    if (_sentinel) {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        auto opts = _opts;
+        auto role_changed = _role_changed(connection.options());
+        auto sentinel = _sentinel;
+
+        lock.unlock();
+
+        if (role_changed || _need_reconnect(connection, connection_lifetime)) {
+            ++_reconnects;
+
+            try {
+                connection = _create(sentinel, opts, false);
+            } catch (const Error &) {
+                ++_create_failures;
+                throw;
+            }
+
+            return true;
         }
-    } else {
+
+        return false;
+    }
+
+    if (_need_reconnect(connection, connection_lifetime)) {
+        _reconnect(connection);
+
+        return true;
+    }
+
+    return false;
+}
+
+void ConnectionPool::_reconnect(Connection &connection) {
+    ++_reconnects;
+
+    try {
+        connection.reconnect();
+    } catch (const Error &) {
+        ++_create_failures;
+        throw;
+    }
+}
+
+void ConnectionPool::_record_wait(const std::chrono::steady_clock::time_point &deadline,
+                                    const std::chrono::steady_clock::time_point &wait_start) {
+    if (deadline == std::chrono::steady_clock::time_point::min()) {
+        // Never waited.
+        return;
+    }
+
+    _wait_time->record(std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - wait_start));
+}
+
+bool ConnectionPool::_reserve() {
+    auto used = _used_connections.load();
+    while (used < _pool_opts.size) {
+        if (_used_connections.compare_exchange_weak(used, used + 1)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Connection ConnectionPool::_create_reserved() {
+    try {
+        // Connect without lock, so that other threads won't be blocked.
+        auto connection = create();
+
+        ++_created;
+
+        return connection;
+    } catch (...) {
+        _cancel_reservation(1);
+        throw;
+    }
+}
+
+void ConnectionPool::_cancel_reservation(std::size_t num) {
+    if (num == 0) {
+        return;
+    }
+
+    assert(_used_connections >= num);
+
+    _used_connections -= num;
+
+    // Waiters can create new connections now.
+    _notify(true);
+}
+
+void ConnectionPool::_wait_for_connection(const std::chrono::steady_clock::time_point &deadline) {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    ++_waiters;
+
+    // Pairs with the fence in *_notify*: either we see the released connection,
+    // or the releaser sees us waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Wait until there's an idle connection, or some place is available, or timeout.
+    auto ready = [this]() {
+        return this->_idle_num() > 0 || this->_used_connections < this->_pool_opts.size;
+    };
+
+    auto ok = true;
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
         // Wait forever.
-        _cv.wait(lock, [this] { return !(this->_pool).empty(); });
+        _cv.wait(lock, ready);
+    } else {
+        ok = _cv.wait_until(lock, deadline, ready);
+    }
+
+    --_waiters;
+
+    if (!ok) {
+        throw Error("Failed to fetch a connection in "
+                + std::to_string(_pool_opts.wait_timeout.count()) + " milliseconds");
+    }
+}
+
+void ConnectionPool::_notify(bool all) {
+    // Idle counters are updated with relaxed order. Pairs with the fence in
+    // *_wait_for_connection*, so that the notification won't be lost.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (_waiters.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    {
+        // A waiter might have checked the condition, but NOT started waiting yet.
+        // Lock the mutex, so that the notification won't be lost.
+        std::lock_guard<std::mutex> lock(_mutex);
+    }
+
+    if (all) {
+        _cv.notify_all();
+    } else {
+        _cv.notify_one();
     }
 }
 
@@ -236,7 +638,8 @@ bool ConnectionPool::_need_reconnect(const Connection &connection,
 
     if (connection_lifetime > std::chrono::milliseconds(0)) {
         auto now = std::chrono::steady_clock::now();
-        if (now - connection.last_active() > connection_lifetime) {
+        // NOT *last_active*, which is also updated by health checks.
+        if (now - connection.create_time() > connection_lifetime) {
             return true;
         }
     }
@@ -244,6 +647,123 @@ bool ConnectionPool::_need_reconnect(const Connection &connection,
     return false;
 }
 
+void ConnectionPool::_start_maintainer() {
+    if (_pool_opts.health_check_interval <= std::chrono::milliseconds(0)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_maintainer_mutex);
+
+        _maintainer_stopped = false;
+    }
+
+    _maintainer = std::thread([this]() { this->_maintain(); });
+}
+
+void ConnectionPool::_stop_maintainer() {
+    {
+        std::lock_guard<std::mutex> lock(_maintainer_mutex);
+
+        _maintainer_stopped = true;
+    }
+
+    _maintainer_cv.notify_all();
+
+    if (_maintainer.joinable()) {
+        _maintainer.join();
+    }
+}
+
+void ConnectionPool::_maintain() {
+    std::unique_lock<std::mutex> lock(_maintainer_mutex);
+
+    while (true) {
+        if (_maintainer_cv.wait_for(lock,
+                    _pool_opts.health_check_interval,
+                    [this]() { return this->_maintainer_stopped; })) {
+            break;
+        }
+
+        lock.unlock();
+
+        _trim();
+
+        for (auto &shard : _shards) {
+            _check_idle(*shard);
+        }
+
+        // Replace connections that have been closed.
+        warm_up(_pool_opts.min_idle);
+
+        lock.lock();
+    }
+}
+
+void ConnectionPool::_check_idle(Shard &shard) {
+    auto interval = _pool_opts.health_check_interval;
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+
+        if (shard.connections.empty()) {
+            break;
+        }
+
+        // Connections are released to the back, so the front one is the least recently used.
+        // If it's still fresh, so are the others.
+        auto &front = shard.connections.front();
+        if (std::chrono::steady_clock::now() - front.last_active() < interval
+                && !_need_reconnect(front, _pool_opts.connection_lifetime)) {
+            break;
+        }
+
+        auto connection = _pop(shard);
+
+        lock.unlock();
+
+        try {
+            if (!_reconnect_if_needed(connection)) {
+                try {
+                    cmd::ping(connection);
+                    connection.recv();
+                } catch (const Error &) {
+                    // The connection might have unread reply, e.g. timeout, so reconnect it.
+                    _reconnect(connection);
+                }
+            }
+        } catch (const Error &) {
+            // Failed to reconnect, close it, and a new one will be created lazily.
+            _cancel_reservation(1);
+            continue;
+        }
+
+        _push(shard, std::move(connection));
+    }
+}
+
+void ConnectionPool::_trim() {
+    auto max_idle = _pool_opts.max_idle;
+    if (max_idle == 0) {
+        return;
+    }
+
+    while (_idle_num() > max_idle) {
+        std::unique_lock<std::mutex> lock;
+        auto *shard = _lock_idle_shard(lock);
+        if (shard == nullptr) {
+            break;
+        }
+
+        // Close the least recently used one.
+        _pop(*shard);
+
+        lock.unlock();
+
+        _cancel_reservation(1);
+    }
+}
+
 }
 
 }
@@ -21,8 +21,13 @@
 #include <mutex>
 #include <memory>
 #include <condition_variable>
+#include <atomic>
 #include <deque>
+#include <thread>
+#include <vector>
+#include <future>
 #include "connection.h"
+#include "metrics.h"
 #include "sentinel.h"
 
 namespace sw {
@@ -36,8 +41,73 @@ struct ConnectionPoolOptions {
     // Max time to wait for a connection. 0ms means client waits forever.
     std::chrono::milliseconds wait_timeout{0};
 
-    // Max lifetime of a connection. 0ms means we never expire the connection.
+    // Max lifetime of a connection, i.e. a connection created, or reconnected, more than
+    // this long ago is reconnected before it's reused. 0ms means we never expire
+    // the connection.
     std::chrono::milliseconds connection_lifetime{0};
+
+    // Number of connections created in parallel when the pool is constructed,
+    // so that the first burst of commands doesn't need to wait for connecting.
+    // It should NOT be larger than *size*.
+    std::size_t min_idle = 0;
+
+    // Number of shards of idle connections. Each shard has its own lock, and each thread
+    // fetches and releases connections with its home shard, i.e. no pool-wide lock is
+    // taken, unless the home shard is empty, and the thread steals connections from
+    // other shards, or waits for a connection. 0 means the number of hardware threads.
+    // It's capped by *size*.
+    std::size_t shards = 1;
+
+    // How often a background thread checks idle connections. Connections that have been
+    // idle for at least this long are PINGed, and broken or expired ones are reconnected,
+    // so that *fetch* seldom needs to reconnect on the request path. 0ms disables
+    // the background thread.
+    // NOTE: PING does NOT extend *connection_lifetime*, i.e. expired connections are still
+    // reconnected, even if they're checked regularly.
+    std::chrono::milliseconds health_check_interval{0};
+
+    // Max number of idle connections. The background thread closes idle connections
+    // above it, and then creates connections until there're *min_idle* ones again.
+    // 0 means no limit. It only takes effect when *health_check_interval* is set,
+    // and it should NOT be less than *min_idle*.
+    std::size_t max_idle = 0;
+
+    // If true, commands sent by concurrent threads with *Redis* are coalesced, and
+    // sent in batches with connections of the pool, i.e. auto-pipelining.
+    // NOTE: It's ignored by *RedisCluster*.
+    bool auto_pipeline = false;
+
+    // If true, *Redis::lrange*, *Redis::hgetall*, *Redis::smembers* and *Redis::zrange*
+    // write each element of the reply to the output iterator as soon as it's parsed,
+    // instead of keeping the whole reply in memory. It helps with huge replies, but costs
+    // more than the buffered way for small ones, and these commands are NOT auto-pipelined.
+    // NOTE: It's ignored by *RedisCluster*.
+    bool stream_replies = false;
+};
+
+struct ConnectionPoolStats {
+    // Number of connections created by *fetch* and *borrow*.
+    long long created = 0;
+
+    // Number of times that an idle connection is fetched or borrowed, i.e. reused.
+    long long reused = 0;
+
+    // Number of connections reconnected, because they're broken, expired, or the master
+    // has changed, or they failed the health check.
+    long long reconnects = 0;
+
+    // Number of failures to create or reconnect a connection.
+    long long create_failures = 0;
+
+    // Number of idle connections.
+    std::size_t idle = 0;
+
+    // Number of connections fetched from the pool, including those being created.
+    std::size_t in_use = 0;
+
+    // Time spent by *fetch* waiting for a connection, when the pool is exhausted.
+    // Fetches that do NOT need to wait are NOT recorded.
+    LatencyStats wait_time;
 };
 
 class ConnectionPool {
@@ -49,7 +119,7 @@ public:
                     const ConnectionPoolOptions &pool_opts,
                     const ConnectionOptions &connection_opts);
 
-    ConnectionPool() = default;
+    ConnectionPool();
 
     ConnectionPool(ConnectionPool &&that);
     ConnectionPool& operator=(ConnectionPool &&that);
@@ -57,11 +127,20 @@ public:
     ConnectionPool(const ConnectionPool &) = delete;
     ConnectionPool& operator=(const ConnectionPool &) = delete;
 
-    ~ConnectionPool() = default;
+    ~ConnectionPool();
 
     // Fetch a connection from pool.
     Connection fetch();
 
+    // Borrow an idle connection, which is detached from the pool, i.e. it no longer counts
+    // towards the pool size. If there's no idle connection, create a new one. Unlike *fetch*,
+    // it never waits, so a caller, which holds connections of the pool, never waits for itself.
+    // The connection should be returned with *reclaim*.
+    Connection borrow();
+
+    // Return a connection got by *borrow*. If the pool is already full, it's closed.
+    void reclaim(Connection connection);
+
     ConnectionOptions connection_options();
 
     void release(Connection connection);
@@ -69,21 +148,116 @@ public:
     // Create a new connection.
     Connection create();
 
+    ConnectionPoolStats stats();
+
+    // Create connections in parallel, until there're at least *num* idle connections,
+    // or the pool is full. Failures are ignored, and connections will be created lazily.
+    void warm_up(std::size_t num);
+
+    // Close idle connections, and stop the background health check. Connections in use
+    // are closed when they're released. However, the pool still works, i.e. *fetch* creates
+    // connections on demand. It's used when the node leaves the cluster, while in-flight
+    // commands might still use the pool.
+    void suspend();
+
+    // Restart the background health check stopped by *suspend*, and keep released connections
+    // again. Idle connections are NOT created, call *warm_up* if needed.
+    void resume();
+
 private:
+    // Size of padding that keeps hot data of different threads on different cache lines.
+    static const std::size_t CACHE_LINE_SIZE = 64;
+
+    // Idle connections are partitioned into shards, and each shard has its own lock and
+    // counters, so that threads working with their home shards share no cache line.
+    struct Shard {
+        std::mutex mutex;
+
+        std::deque<Connection> connections;
+
+        // Size of *connections*, which can be read without lock. Only updated with
+        // *mutex* held, so it's updated with relaxed load and store.
+        std::atomic<std::size_t> idle{0};
+
+        // Number of idle connections fetched or borrowed from this shard.
+        // Also only updated with *mutex* held.
+        std::atomic<long long> reused{0};
+
+        // Shards are allocated separately. Pad them, so that two shards never share
+        // a cache line.
+        char padding[CACHE_LINE_SIZE];
+    };
+
+    using ShardUPtr = std::unique_ptr<Shard>;
+
     void _move(ConnectionPool &&that);
 
-    // NOT thread-safe
-    Connection _create();
+    void _init_shards();
 
     Connection _create(SimpleSentinel &sentinel, const ConnectionOptions &opts, bool locked);
 
-    Connection _fetch();
+    // Shard that the current thread releases connections to, and fetches connections from.
+    Shard& _home_shard();
+
+    // Find a shard with idle connections, starting from the home shard, and return it
+    // with *lock* held. Returns nullptr, if all shards are empty.
+    Shard* _lock_idle_shard(std::unique_lock<std::mutex> &lock);
+
+    // Number of idle connections in all shards. It's NOT exact, if others are
+    // fetching or releasing connections.
+    std::size_t _idle_num() const;
+
+    // NOT thread-safe, i.e. caller should lock the shard, and the shard should NOT be empty.
+    Connection _pop(Shard &shard);
+
+    // NOT thread-safe, i.e. caller should lock the shard.
+    void _count_reused(Shard &shard);
 
-    void _wait_for_connection(std::unique_lock<std::mutex> &lock);
+    void _push(Shard &shard, Connection connection);
+
+    // Reconnect the idle connection, if it's broken, expired, or the master has changed.
+    // If it fails, the connection is returned to the pool.
+    Connection _prepare(Connection connection);
+
+    // Returns true, if the connection is reconnected.
+    bool _reconnect_if_needed(Connection &connection);
+
+    void _reconnect(Connection &connection);
+
+    // Record the time spent waiting for a connection, if *fetch* ever waited.
+    void _record_wait(const std::chrono::steady_clock::time_point &deadline,
+                        const std::chrono::steady_clock::time_point &wait_start);
+
+    // Reserve a place for a new connection. Returns false, if the pool is full.
+    bool _reserve();
+
+    // Create a connection for the reserved place.
+    Connection _create_reserved();
+
+    // Give back places reserved for connections that failed to be created.
+    void _cancel_reservation(std::size_t num);
+
+    void _wait_for_connection(const std::chrono::steady_clock::time_point &deadline);
+
+    // Wake up threads waiting for a connection.
+    void _notify(bool all = false);
 
     bool _need_reconnect(const Connection &connection,
                             const std::chrono::milliseconds &connection_lifetime) const;
 
+    void _start_maintainer();
+
+    void _stop_maintainer();
+
+    // Loop of the background thread.
+    void _maintain();
+
+    // PING, or reconnect, idle connections of the shard.
+    void _check_idle(Shard &shard);
+
+    // Close idle connections above *max_idle*.
+    void _trim();
+
     void _update_connection_opts(const std::string &host, int port) {
         _opts.host = host;
         _opts.port = port;
@@ -93,19 +267,54 @@ private:
         return opts.port != _opts.port || opts.host != _opts.host;
     }
 
+    // Protected by *_mutex*.
     ConnectionOptions _opts;
 
     ConnectionPoolOptions _pool_opts;
 
-    std::deque<Connection> _pool;
+    std::vector<ShardUPtr> _shards;
+
+    // Number of connections that belong to the pool, including both in-use and idle ones,
+    // and places reserved for connections being created. It's only updated when a connection
+    // is created, closed, borrowed or reclaimed, i.e. NOT when it's fetched or released.
+    std::atomic<std::size_t> _used_connections{0};
+
+    // Counters of slow paths.
+    std::atomic<long long> _created{0};
+
+    std::atomic<long long> _reconnects{0};
+
+    std::atomic<long long> _create_failures{0};
+
+    // *_waiters* is read every time a connection is released, and written by threads waiting
+    // for a connection. Keep it on its own cache line, so that writes to counters above
+    // don't invalidate it.
+    char _waiters_padding_before[CACHE_LINE_SIZE];
+
+    std::atomic<std::size_t> _waiters{0};
 
-    std::size_t _used_connections = 0;
+    char _waiters_padding_after[CACHE_LINE_SIZE];
 
+    std::unique_ptr<LatencyHistogram> _wait_time{new LatencyHistogram};
+
+    // Protects *_opts*, and it's used with *_cv* to wait for a connection.
     std::mutex _mutex;
 
     std::condition_variable _cv;
 
     SimpleSentinel _sentinel;
+
+    // If true, released connections are closed, and *warm_up* does nothing.
+    std::atomic<bool> _suspended{false};
+
+    std::thread _maintainer;
+
+    // Protected by *_maintainer_mutex*.
+    bool _maintainer_stopped = false;
+
+    std::mutex _maintainer_mutex;
+
+    std::condition_variable _maintainer_cv;
 };
 
 }
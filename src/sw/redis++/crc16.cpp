@@ -83,11 +83,53 @@ static const uint16_t crc16tab[256]= {
     0x6e17,0x7e36,0x4e55,0x5e74,0x2e93,0x3eb2,0x0ed1,0x1ef0
 };
 
+namespace {
+
+// Tables for slice-by-8, i.e. tables[k][b] is the CRC of byte *b* followed by *k* zero bytes.
+// Since the CRC is linear, the CRC of 8 bytes is the XOR of 8 independent lookups,
+// instead of 8 lookups that depend on each other.
+struct Crc16Tables {
+    Crc16Tables() {
+        for (int b = 0; b < 256; b++) {
+            tables[0][b] = crc16tab[b];
+        }
+
+        for (int k = 1; k < 8; k++) {
+            for (int b = 0; b < 256; b++) {
+                uint16_t crc = tables[k - 1][b];
+                tables[k][b] = static_cast<uint16_t>((crc<<8) ^ crc16tab[(crc>>8)&0x00FF]);
+            }
+        }
+    }
+
+    uint16_t tables[8][256];
+};
+
+const Crc16Tables& crc16_tables() {
+    static const Crc16Tables tables;
+
+    return tables;
+}
+
+}
+
 uint16_t crc16(const char *buf, int len) {
-    int counter;
+    const auto *p = reinterpret_cast<const unsigned char *>(buf);
     uint16_t crc = 0;
-    for (counter = 0; counter < len; counter++)
-            crc = (crc<<8) ^ crc16tab[((crc>>8) ^ *buf++)&0x00FF];
+
+    if (len >= 8) {
+        const auto &t = crc16_tables().tables;
+        do {
+            // The current CRC is XORed into the first 2 bytes.
+            crc = t[7][p[0] ^ (crc>>8)] ^ t[6][p[1] ^ (crc&0x00FF)]
+                    ^ t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+            p += 8;
+            len -= 8;
+        } while (len >= 8);
+    }
+
+    for (; len > 0; len--)
+            crc = (crc<<8) ^ crc16tab[((crc>>8) ^ *p++)&0x00FF];
     return crc;
 }
 
@@ -0,0 +1,311 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "event_loop.h"
+#include <cassert>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include "errors.h"
+
+namespace sw {
+
+namespace redis {
+
+EventLoop::EventLoop() {
+    if (pipe(_notify_fds) != 0) {
+        throw Error(std::string("Failed to create event loop: ") + std::strerror(errno));
+    }
+
+    for (auto fd : _notify_fds) {
+        auto flags = fcntl(fd, F_GETFL);
+        if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+            close(_notify_fds[0]);
+            close(_notify_fds[1]);
+            throw Error(std::string("Failed to create event loop: ") + std::strerror(errno));
+        }
+    }
+
+    _loop_thread = std::thread([this]() { this->_run(); });
+}
+
+EventLoop::~EventLoop() {
+    // Tasks posted before this one will be done before the loop stops.
+    post([this]() { this->_stop = true; });
+
+    _loop_thread.join();
+
+    close(_notify_fds[0]);
+    close(_notify_fds[1]);
+}
+
+void EventLoop::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _tasks.push_back(std::move(task));
+    }
+
+    _notify();
+
+    _cv.notify_one();
+}
+
+void EventLoop::attach(redisAsyncContext &ctx, ErrorHandler on_error) {
+    assert(in_loop_thread());
+
+    _watchers.emplace_back(new Watcher(ctx, std::move(on_error)));
+
+    auto &ev = ctx.ev;
+    ev.data = _watchers.back().get();
+    ev.addRead = _add_read;
+    ev.delRead = _del_read;
+    ev.addWrite = _add_write;
+    ev.delWrite = _del_write;
+    ev.cleanup = _cleanup;
+}
+
+void EventLoop::set_timer(const redisAsyncContext &ctx, const std::chrono::milliseconds &timeout) {
+    assert(in_loop_thread() && ctx.ev.data != nullptr);
+
+    static_cast<Watcher*>(ctx.ev.data)->deadline = std::chrono::steady_clock::now() + timeout;
+}
+
+void EventLoop::cancel_timer(const redisAsyncContext &ctx) {
+    assert(in_loop_thread() && ctx.ev.data != nullptr);
+
+    static_cast<Watcher*>(ctx.ev.data)->deadline = std::chrono::steady_clock::time_point::max();
+}
+
+void EventLoop::_add_read(void *data) {
+    static_cast<Watcher*>(data)->reading = true;
+}
+
+void EventLoop::_del_read(void *data) {
+    static_cast<Watcher*>(data)->reading = false;
+}
+
+void EventLoop::_add_write(void *data) {
+    static_cast<Watcher*>(data)->writing = true;
+}
+
+void EventLoop::_del_write(void *data) {
+    static_cast<Watcher*>(data)->writing = false;
+}
+
+void EventLoop::_cleanup(void *data) {
+    auto *watcher = static_cast<Watcher*>(data);
+    watcher->reading = false;
+    watcher->writing = false;
+    watcher->alive = false;
+}
+
+void EventLoop::_run() {
+    while (!_stop) {
+        if (!_err) {
+            try {
+                _poll();
+            } catch (...) {
+                _fail(std::current_exception());
+            }
+        } else {
+            _wait_tasks();
+        }
+
+        _run_tasks();
+
+        // Remove watchers whose context has been freed.
+        for (auto iter = _watchers.begin(); iter != _watchers.end(); ) {
+            if (!(*iter)->alive) {
+                iter = _watchers.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+}
+
+void EventLoop::_poll() {
+    std::vector<pollfd> fds;
+    std::vector<Watcher*> polled;
+    fds.reserve(_watchers.size() + 1);
+    polled.reserve(_watchers.size());
+
+    fds.push_back(pollfd{_notify_fds[0], POLLIN, 0});
+
+    for (auto &watcher : _watchers) {
+        if (!watcher->alive || !(watcher->reading || watcher->writing)) {
+            continue;
+        }
+
+        short events = 0;
+        if (watcher->reading) {
+            events |= POLLIN;
+        }
+
+        if (watcher->writing) {
+            events |= POLLOUT;
+        }
+
+        fds.push_back(pollfd{watcher->ctx->c.fd, events, 0});
+        polled.push_back(watcher.get());
+    }
+
+    if (poll(fds.data(), fds.size(), _poll_timeout()) < 0) {
+        if (errno == EINTR) {
+            return;
+        }
+
+        throw Error(std::string("Failed to poll: ") + std::strerror(errno));
+    }
+
+    if (fds[0].revents != 0) {
+        _drain_notification();
+    }
+
+    for (std::size_t idx = 0; idx != polled.size(); ++idx) {
+        auto *watcher = polled[idx];
+        auto revents = fds[idx + 1].revents;
+
+        // Callbacks of a previous context might free this one, e.g. disconnect callback.
+        if (revents == 0 || !watcher->alive) {
+            continue;
+        }
+
+        if (watcher->reading && (revents & (POLLIN | POLLERR | POLLHUP))) {
+            redisAsyncHandleRead(watcher->ctx);
+        }
+
+        if (watcher->alive && watcher->writing && (revents & (POLLOUT | POLLERR | POLLHUP))) {
+            redisAsyncHandleWrite(watcher->ctx);
+        }
+    }
+
+    _expire_timers();
+}
+
+int EventLoop::_poll_timeout() const {
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    for (const auto &watcher : _watchers) {
+        if (watcher->alive && watcher->deadline < deadline) {
+            deadline = watcher->deadline;
+        }
+    }
+
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        return -1;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (deadline <= now) {
+        return 0;
+    }
+
+    // Round up, so that we don't wake up before the timer expires.
+    auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now)
+                    + std::chrono::milliseconds(1);
+
+    return static_cast<int>(std::min<std::chrono::milliseconds::rep>(timeout.count(), 60000));
+}
+
+void EventLoop::_expire_timers() {
+    auto now = std::chrono::steady_clock::now();
+    for (auto &watcher : _watchers) {
+        if (!watcher->alive || watcher->deadline > now) {
+            continue;
+        }
+
+        watcher->deadline = std::chrono::steady_clock::time_point::max();
+
+        // The handler frees the context, and *_cleanup* marks the watcher as dead.
+        if (watcher->on_error) {
+            try {
+                watcher->on_error(std::make_exception_ptr(TimeoutError("Operation timed out")));
+            } catch (...) {
+                // Keep checking other contexts.
+            }
+        }
+    }
+}
+
+void EventLoop::_run_tasks() {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        tasks.swap(_tasks);
+    }
+
+    for (auto &task : tasks) {
+        try {
+            task();
+        } catch (...) {
+            // An exception escaping the loop thread terminates the process,
+            // so tasks are responsible for reporting their own errors.
+        }
+    }
+}
+
+void EventLoop::_wait_tasks() {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _cv.wait(lock, [this]() { return !this->_tasks.empty(); });
+}
+
+void EventLoop::_fail(std::exception_ptr err) {
+    _err = err;
+
+    for (auto &watcher : _watchers) {
+        // The handler frees the context, and *_cleanup* marks the watcher as dead.
+        if (watcher->alive && watcher->on_error) {
+            try {
+                watcher->on_error(err);
+            } catch (...) {
+                // Keep notifying other contexts.
+            }
+        }
+    }
+}
+
+void EventLoop::_notify() {
+    char c = 0;
+
+    // If the pipe is full, there're already pending notifications.
+    while (write(_notify_fds[1], &c, 1) < 0 && errno == EINTR) {}
+}
+
+void EventLoop::_drain_notification() {
+    char buf[256];
+    while (true) {
+        auto len = read(_notify_fds[0], buf, sizeof(buf));
+        if (len > 0) {
+            continue;
+        }
+
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+
+        break;
+    }
+}
+
+}
+
+}
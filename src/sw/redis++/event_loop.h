@@ -0,0 +1,168 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_EVENT_LOOP_H
+#define SEWENEW_REDISPLUSPLUS_EVENT_LOOP_H
+
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <vector>
+#include <list>
+#include <memory>
+#include <hiredis/async.h>
+
+namespace sw {
+
+namespace redis {
+
+// EventLoop runs a background thread, which polls sockets of *redisAsyncContext*s,
+// and drives hiredis' async API. Since *redisAsyncContext* is NOT thread-safe,
+// all operations on it MUST be done in the event loop thread, i.e. post them
+// as tasks with *EventLoop::post*.
+//
+// Exceptions thrown by tasks are ignored, i.e. tasks should report errors by themselves.
+// If polling fails, the loop is broken: each attached context's error handler is called,
+// and later, tasks still run, but no context is polled. See *EventLoop::error*.
+// Each context can also have a timer, and if it expires, the context's error handler is
+// called with TimeoutError.
+class EventLoop {
+public:
+    using Task = std::function<void ()>;
+
+    using ErrorHandler = std::function<void (std::exception_ptr err)>;
+
+    EventLoop();
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop& operator=(const EventLoop &) = delete;
+
+    EventLoop(EventLoop &&) = delete;
+    EventLoop& operator=(EventLoop &&) = delete;
+
+    // Run the remaining tasks, and stop the event loop thread.
+    ~EventLoop();
+
+    // Thread-safe. Run the task in the event loop thread.
+    void post(Task task);
+
+    // NOT thread-safe, i.e. it MUST be called in the event loop thread.
+    // Install event hooks, so that the loop polls the context's socket. If the loop
+    // is broken, *on_error* is called in the loop thread, and it should free the context.
+    void attach(redisAsyncContext &ctx, ErrorHandler on_error);
+
+    // NOT thread-safe, i.e. it MUST be called in the event loop thread. The context MUST
+    // have been attached. Call the context's error handler with TimeoutError, if the timer
+    // is NOT cancelled in *timeout*. Each context has at most one timer, and setting
+    // a new one replaces the old one.
+    void set_timer(const redisAsyncContext &ctx, const std::chrono::milliseconds &timeout);
+
+    // NOT thread-safe, i.e. it MUST be called in the event loop thread.
+    void cancel_timer(const redisAsyncContext &ctx);
+
+    // NOT thread-safe, i.e. it MUST be called in the event loop thread.
+    // Returns the error that broke the loop, or null if it's NOT broken.
+    std::exception_ptr error() const {
+        return _err;
+    }
+
+    bool in_loop_thread() const {
+        return std::this_thread::get_id() == _loop_thread.get_id();
+    }
+
+private:
+    // Which events hiredis wants for a context.
+    struct Watcher {
+        Watcher(redisAsyncContext &c, ErrorHandler handler) :
+            ctx(&c), on_error(std::move(handler)) {}
+
+        redisAsyncContext *ctx;
+
+        ErrorHandler on_error;
+
+        bool reading = false;
+
+        bool writing = false;
+
+        // Set to false when the context has been freed by hiredis.
+        bool alive = true;
+
+        // When the timer expires, or max, if there's no timer.
+        std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::time_point::max();
+    };
+
+    static void _add_read(void *data);
+
+    static void _del_read(void *data);
+
+    static void _add_write(void *data);
+
+    static void _del_write(void *data);
+
+    static void _cleanup(void *data);
+
+    void _run();
+
+    void _poll();
+
+    // Milliseconds until the earliest timer expires, or -1 if there's no timer.
+    int _poll_timeout() const;
+
+    // Call error handlers of contexts whose timers have expired.
+    void _expire_timers();
+
+    void _run_tasks();
+
+    // Wait for tasks without polling, since the loop is broken.
+    void _wait_tasks();
+
+    // Break the loop, and notify all contexts.
+    void _fail(std::exception_ptr err);
+
+    void _notify();
+
+    void _drain_notification();
+
+    // Self-pipe to wake up the loop thread when new tasks arrive.
+    int _notify_fds[2];
+
+    std::list<std::unique_ptr<Watcher>> _watchers;
+
+    std::vector<Task> _tasks;
+
+    bool _stop = false;
+
+    std::exception_ptr _err;
+
+    std::mutex _mutex;
+
+    // Notified when tasks arrive, and only waited for if the loop is broken.
+    std::condition_variable _cv;
+
+    std::thread _loop_thread;
+};
+
+using EventLoopSPtr = std::shared_ptr<EventLoop>;
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_EVENT_LOOP_H
@@ -0,0 +1,306 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "metrics.h"
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include "connection.h"
+
+namespace {
+
+// Each power of 2 is split into 2^SUB_BUCKET_BITS linear sub-buckets.
+const int SUB_BUCKET_BITS = 4;
+
+const long long SUB_BUCKET_NUM = 1LL << SUB_BUCKET_BITS;
+
+// Latencies larger than 2^MAX_EXPONENT microseconds, i.e. about 19 hours, fall into
+// the last bucket.
+const int MAX_EXPONENT = 36;
+
+const std::size_t BUCKET_NUM = SUB_BUCKET_NUM * (MAX_EXPONENT - SUB_BUCKET_BITS + 1);
+
+const long long MAX_LATENCY = (1LL << MAX_EXPONENT) - 1;
+
+char to_upper(char c) {
+    return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+}
+
+}
+
+namespace sw {
+
+namespace redis {
+
+std::chrono::microseconds LatencyStats::mean() const {
+    if (count == 0) {
+        return std::chrono::microseconds(0);
+    }
+
+    return total / count;
+}
+
+std::chrono::microseconds LatencyStats::percentile(double p) const {
+    if (count == 0) {
+        return std::chrono::microseconds(0);
+    }
+
+    p = std::min(std::max(p, 0.0), 100.0);
+
+    auto rank = std::max(static_cast<long long>(std::ceil(p / 100 * count)), 1LL);
+
+    long long seen = 0;
+    for (std::size_t idx = 0; idx != buckets.size(); ++idx) {
+        seen += buckets[idx];
+        if (seen >= rank) {
+            auto upper = std::chrono::microseconds(LatencyHistogram::bucket_upper_bound(idx));
+            return std::min(upper, max);
+        }
+    }
+
+    return max;
+}
+
+void LatencyStats::merge(const LatencyStats &that) {
+    count += that.count;
+    total += that.total;
+    max = std::max(max, that.max);
+
+    if (buckets.size() < that.buckets.size()) {
+        buckets.resize(that.buckets.size(), 0);
+    }
+
+    for (std::size_t idx = 0; idx != that.buckets.size(); ++idx) {
+        buckets[idx] += that.buckets[idx];
+    }
+}
+
+LatencyHistogram::LatencyHistogram() : _buckets(BUCKET_NUM) {}
+
+void LatencyHistogram::record(std::chrono::microseconds latency) {
+    auto val = std::max<long long>(latency.count(), 0);
+
+    _buckets[bucket_index(val)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _total.fetch_add(val, std::memory_order_relaxed);
+
+    auto cur = _max.load(std::memory_order_relaxed);
+    while (val > cur && !_max.compare_exchange_weak(cur, val, std::memory_order_relaxed)) {}
+}
+
+LatencyStats LatencyHistogram::stats() const {
+    // Counters are updated independently, so the snapshot might be slightly inconsistent,
+    // if it's taken while others are recording.
+    LatencyStats stats;
+    stats.count = _count.load(std::memory_order_relaxed);
+    stats.total = std::chrono::microseconds(_total.load(std::memory_order_relaxed));
+    stats.max = std::chrono::microseconds(_max.load(std::memory_order_relaxed));
+
+    stats.buckets.reserve(_buckets.size());
+    for (const auto &bucket : _buckets) {
+        stats.buckets.push_back(bucket.load(std::memory_order_relaxed));
+    }
+
+    return stats;
+}
+
+std::size_t LatencyHistogram::bucket_index(long long latency) {
+    assert(latency >= 0);
+
+    if (latency < SUB_BUCKET_NUM) {
+        return static_cast<std::size_t>(latency);
+    }
+
+    latency = std::min(latency, MAX_LATENCY);
+
+    // Index of the highest bit.
+    auto exponent = SUB_BUCKET_BITS;
+    while ((latency >> (exponent + 1)) != 0) {
+        ++exponent;
+    }
+
+    auto shift = exponent - SUB_BUCKET_BITS;
+    auto sub_bucket = (latency >> shift) - SUB_BUCKET_NUM;
+
+    return static_cast<std::size_t>(SUB_BUCKET_NUM * (shift + 1) + sub_bucket);
+}
+
+long long LatencyHistogram::bucket_upper_bound(std::size_t idx) {
+    auto bucket = static_cast<long long>(idx);
+    if (bucket < SUB_BUCKET_NUM) {
+        return bucket;
+    }
+
+    auto shift = bucket / SUB_BUCKET_NUM - 1;
+    auto sub_bucket = bucket % SUB_BUCKET_NUM;
+
+    return ((SUB_BUCKET_NUM + sub_bucket + 1) << shift) - 1;
+}
+
+std::size_t Metrics::CaseInsensitiveHash::operator()(const std::string &str) const {
+    // FNV-1a
+    std::size_t hash = 2166136261U;
+    for (auto c : str) {
+        hash = (hash ^ static_cast<unsigned char>(to_upper(c))) * 16777619U;
+    }
+
+    return hash;
+}
+
+bool Metrics::CaseInsensitiveEqual::operator()(const std::string &lhs,
+                                                const std::string &rhs) const {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+
+    for (std::size_t idx = 0; idx != lhs.size(); ++idx) {
+        if (to_upper(lhs[idx]) != to_upper(rhs[idx])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Metrics::Metrics(const MetricsOptions &opts) : _opts(opts) {
+    _commands.maps.emplace_back(new CommandMap);
+    _commands.current = _commands.maps.back().get();
+
+    _nodes.maps.emplace_back(new NodeMap);
+    _nodes.current = _nodes.maps.back().get();
+}
+
+void Metrics::record(const Connection &connection, std::chrono::microseconds latency, bool ok) {
+    const auto &command = _metric(_commands, connection.last_command());
+    const auto &node = _metric(_nodes, connection.node_name());
+
+    for (auto *metric : {command.second, node.second}) {
+        metric->latency.record(latency);
+
+        if (!ok) {
+            metric->errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (_opts.callback) {
+        _opts.callback(CommandSample{command.first, node.first, latency, ok});
+    }
+}
+
+MetricsStats Metrics::stats() const {
+    MetricsStats stats;
+    _snapshot(_commands, stats.commands);
+    _snapshot(_nodes, stats.nodes);
+
+    return stats;
+}
+
+template <typename Map>
+auto Metrics::_metric(MetricMaps<Map> &metrics, const std::string &name)
+    -> const typename Map::value_type& {
+    auto *current = metrics.current.load(std::memory_order_acquire);
+
+    auto iter = current->find(name);
+    if (iter != current->end()) {
+        return *iter;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Others might have added it, before we got the lock.
+    current = metrics.current.load(std::memory_order_relaxed);
+    iter = current->find(name);
+    if (iter != current->end()) {
+        return *iter;
+    }
+
+    // Command names are reported in upper case, and node names are reported as is.
+    auto key = name;
+    if (std::is_same<Map, CommandMap>::value) {
+        std::transform(key.begin(), key.end(), key.begin(), to_upper);
+    }
+
+    _metrics.emplace_back(new Metric);
+    auto *metric = _metrics.back().get();
+
+    std::unique_ptr<Map> updated(new Map(*current));
+    auto &entry = *(updated->emplace(std::move(key), metric).first);
+
+    metrics.maps.push_back(std::move(updated));
+    metrics.current.store(metrics.maps.back().get(), std::memory_order_release);
+
+    return entry;
+}
+
+template <typename Map>
+void Metrics::_snapshot(const MetricMaps<Map> &metrics,
+                        std::unordered_map<std::string, CommandStats> &stats) const {
+    const auto *current = metrics.current.load(std::memory_order_acquire);
+
+    for (const auto &ele : *current) {
+        CommandStats command_stats;
+        command_stats.errors = ele.second->errors.load(std::memory_order_relaxed);
+        command_stats.latency = ele.second->latency.stats();
+
+        stats.emplace(ele.first, std::move(command_stats));
+    }
+}
+
+
+void CommandTimer::_start(Tracer *tracer) {
+    if (tracer != nullptr && tracer->sample()) {
+        _tracer = tracer;
+        _start_wall_time = std::chrono::system_clock::now();
+        _connection.enable_tracing(true);
+    }
+
+    _start_time = std::chrono::steady_clock::now();
+}
+
+void CommandTimer::_finish() noexcept {
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - _start_time);
+
+    try {
+        if (_metrics != nullptr) {
+            _metrics->record(_connection, latency, _ok);
+        }
+
+        if (_tracer != nullptr) {
+            _connection.enable_tracing(false);
+
+            TraceSpan span;
+            span.command = _connection.last_command();
+            span.key = _connection.last_key();
+            span.node = _connection.node_name();
+            span.bytes_sent = _connection.last_command_size();
+            span.bytes_received = (_ok && _reply != nullptr) ? resp_size(*_reply) : 0;
+            span.start = _start_wall_time;
+            span.end = _start_wall_time + latency;
+            span.ok = _ok;
+
+            _tracer->trace(span);
+        }
+    } catch (...) {
+        // Failures of recording, e.g. out of memory, should NOT fail the command.
+    }
+}
+
+}
+
+}
@@ -0,0 +1,259 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_METRICS_H
+#define SEWENEW_REDISPLUSPLUS_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "utils.h"
+#include "tracer.h"
+
+namespace sw {
+
+namespace redis {
+
+class Connection;
+
+// Snapshot of a LatencyHistogram.
+struct LatencyStats {
+    long long count = 0;
+
+    std::chrono::microseconds total{0};
+
+    std::chrono::microseconds max{0};
+
+    // Number of samples in each bucket. See LatencyHistogram for the layout.
+    std::vector<long long> buckets;
+
+    std::chrono::microseconds mean() const;
+
+    // Returns the upper bound of the bucket holding the *p*th percentile,
+    // e.g. percentile(99) for P99. *p* should be in [0, 100].
+    std::chrono::microseconds percentile(double p) const;
+
+    // Add samples of *that* into this one.
+    void merge(const LatencyStats &that);
+};
+
+// HDR-style histogram of latencies. Latencies less than 16us are recorded exactly, and larger
+// ones are recorded with 16 linear sub-buckets for each power of 2, i.e. the relative error
+// is less than 1/16. Recording is lock-free, and takes a few relaxed atomic additions.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram &) = delete;
+
+    LatencyHistogram(LatencyHistogram &&) = delete;
+    LatencyHistogram& operator=(LatencyHistogram &&) = delete;
+
+    ~LatencyHistogram() = default;
+
+    void record(std::chrono::microseconds latency);
+
+    LatencyStats stats() const;
+
+    static std::size_t bucket_index(long long latency);
+
+    // Max latency, in microseconds, that falls into the bucket.
+    static long long bucket_upper_bound(std::size_t idx);
+
+private:
+    std::vector<std::atomic<long long>> _buckets;
+
+    std::atomic<long long> _count{0};
+
+    std::atomic<long long> _total{0};
+
+    std::atomic<long long> _max{0};
+};
+
+struct CommandStats {
+    // Number of commands failed, including error replies, IO errors and timeouts.
+    long long errors = 0;
+
+    // Round trip time of commands, i.e. from sending the command to receiving the reply.
+    LatencyStats latency;
+};
+
+struct MetricsStats {
+    // Stats of each command, e.g. GET, indexed by upper case command name.
+    std::unordered_map<std::string, CommandStats> commands;
+
+    // Stats of each node, indexed by *host:port*, or path of the unix domain socket.
+    std::unordered_map<std::string, CommandStats> nodes;
+};
+
+// A finished command, which is passed to *MetricsOptions::callback*.
+struct CommandSample {
+    StringView command;
+
+    StringView node;
+
+    std::chrono::microseconds latency;
+
+    bool ok;
+};
+
+struct MetricsOptions {
+    // If set, it's called, in the thread sending the command, each time a command is done.
+    // It should be cheap, and never throw.
+    std::function<void (const CommandSample &sample)> callback;
+};
+
+// Latency histograms of each command and each node. Histograms are created, with a mutex
+// held, the first time a command or a node is seen. After that, recording a command takes
+// two hash lookups in immutable maps and a few relaxed atomic additions, i.e. no lock and
+// no allocation. However, histograms are shared by all threads, so threads sending the same
+// command still write the same cache lines.
+class Metrics {
+public:
+    explicit Metrics(const MetricsOptions &opts);
+
+    Metrics(const Metrics &) = delete;
+    Metrics& operator=(const Metrics &) = delete;
+
+    Metrics(Metrics &&) = delete;
+    Metrics& operator=(Metrics &&) = delete;
+
+    ~Metrics() = default;
+
+    // Record the last command sent with the connection.
+    void record(const Connection &connection, std::chrono::microseconds latency, bool ok);
+
+    MetricsStats stats() const;
+
+private:
+    struct Metric {
+        LatencyHistogram latency;
+
+        std::atomic<long long> errors{0};
+    };
+
+    // Command names are case-insensitive, so that they can be looked up without
+    // being copied and converted to upper case.
+    struct CaseInsensitiveHash {
+        std::size_t operator()(const std::string &str) const;
+    };
+
+    struct CaseInsensitiveEqual {
+        bool operator()(const std::string &lhs, const std::string &rhs) const;
+    };
+
+    using CommandMap = std::unordered_map<std::string, Metric*,
+                                            CaseInsensitiveHash, CaseInsensitiveEqual>;
+
+    using NodeMap = std::unordered_map<std::string, Metric*>;
+
+    // Maps are copy-on-write. Readers only load the published map, and writers copy it,
+    // add the new metric, and publish the copy with *_mutex* held. Replaced maps are kept
+    // until Metrics is destroyed, since readers might still be using them. There're only
+    // so many commands and nodes, so they won't take much memory.
+    template <typename Map>
+    struct MetricMaps {
+        std::atomic<const Map*> current{nullptr};
+
+        std::vector<std::unique_ptr<Map>> maps;
+    };
+
+    // Returns the entry of *name*, whose key is the name that's reported, e.g. in upper case
+    // for commands. Entries are never removed, so the reference is always valid.
+    template <typename Map>
+    const typename Map::value_type& _metric(MetricMaps<Map> &metrics, const std::string &name);
+
+    template <typename Map>
+    void _snapshot(const MetricMaps<Map> &metrics,
+                    std::unordered_map<std::string, CommandStats> &stats) const;
+
+    MetricsOptions _opts;
+
+    MetricMaps<CommandMap> _commands;
+
+    MetricMaps<NodeMap> _nodes;
+
+    // All metrics, which are referenced by maps above.
+    std::vector<std::unique_ptr<Metric>> _metrics;
+
+    std::mutex _mutex;
+};
+
+// Record the latency of a command sent with *connection* into *metrics*, and trace it
+// with *tracer*, when it goes out of scope. Either of them can be null, and if both are
+// null, it does nothing. Call *done* after the reply is received, otherwise, the command
+// is recorded as failed.
+class CommandTimer {
+public:
+    CommandTimer(Metrics *metrics, Tracer *tracer, Connection &connection) :
+                    _metrics(metrics),
+                    _connection(connection) {
+        if (_metrics != nullptr || tracer != nullptr) {
+            _start(tracer);
+        }
+    }
+
+    CommandTimer(const CommandTimer &) = delete;
+    CommandTimer& operator=(const CommandTimer &) = delete;
+
+    CommandTimer(CommandTimer &&) = delete;
+    CommandTimer& operator=(CommandTimer &&) = delete;
+
+    ~CommandTimer() {
+        if (_metrics != nullptr || _tracer != nullptr) {
+            _finish();
+        }
+    }
+
+    // *reply* is used to get the number of bytes received, and it can be null,
+    // if the reply is streamed.
+    void done(const redisReply *reply = nullptr) {
+        _ok = true;
+        _reply = reply;
+    }
+
+private:
+    void _start(Tracer *tracer);
+
+    void _finish() noexcept;
+
+    Metrics *_metrics;
+
+    // Only set, if the command is sampled.
+    Tracer *_tracer = nullptr;
+
+    Connection &_connection;
+
+    std::chrono::steady_clock::time_point _start_time;
+
+    std::chrono::system_clock::time_point _start_wall_time;
+
+    const redisReply *_reply = nullptr;
+
+    bool _ok = false;
+};
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_METRICS_H
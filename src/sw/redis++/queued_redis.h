@@ -33,6 +33,8 @@ namespace redis {
 
 class QueuedReplies;
 
+class ClusterPipeline;
+
 // If any command throws, QueuedRedis resets the connection, and becomes invalid.
 // In this case, the only thing we can do is to destory the QueuedRedis object.
 template <typename Impl>
@@ -41,9 +43,12 @@ public:
     QueuedRedis(QueuedRedis &&) = default;
     QueuedRedis& operator=(QueuedRedis &&) = default;
 
-    // When it destructs, the underlying *Connection* will be closed,
-    // and any command that has NOT been executed will be ignored.
-    ~QueuedRedis() = default;
+    // When it destructs, any command that has NOT been executed will be ignored, and
+    // the underlying *Connection* will be closed. If the connection is borrowed from
+    // a pool, e.g. created by *RedisCluster*, it's returned to the pool instead. However,
+    // if there're unexecuted commands, or the connection has been shared with *redis()*,
+    // the connection is marked as broken, and it will be reconnected before reuse.
+    ~QueuedRedis();
 
     Redis redis();
 
@@ -1773,6 +1778,10 @@ private:
     std::vector<std::size_t> _georadius_cmd_indexes;
 
     bool _valid = true;
+
+    // Whether the connection has been shared with a Redis object, which might
+    // change the connection's state, e.g. WATCH.
+    bool _shared = false;
 };
 
 class QueuedReplies {
@@ -1781,6 +1790,8 @@ public:
 
     redisReply& get(std::size_t idx);
 
+    // If *Result* is, or contains, StringView, e.g. OptionalStringView, std::vector<StringView>,
+    // the views borrow the reply, and are valid as long as the QueuedReplies object is alive.
     template <typename Result>
     Result get(std::size_t idx);
 
@@ -1791,6 +1802,8 @@ private:
     template <typename Impl>
     friend class QueuedRedis;
 
+    friend class ClusterPipeline;
+
     explicit QueuedReplies(std::vector<ReplyUPtr> replies) : _replies(std::move(replies)) {}
 
     void _index_check(std::size_t idx) const;
@@ -29,8 +29,18 @@ QueuedRedis<Impl>::QueuedRedis(const ConnectionSPtr &connection, Args &&...args)
     assert(_connection);
 }
 
+template <typename Impl>
+QueuedRedis<Impl>::~QueuedRedis() {
+    // If the object has been moved, *_connection* is null.
+    if (_connection && (!_valid || _cmd_num > 0 || _shared)) {
+        _connection->invalidate();
+    }
+}
+
 template <typename Impl>
 Redis QueuedRedis<Impl>::redis() {
+    _shared = true;
+
     return Redis(_connection);
 }
 
@@ -21,5 +21,7 @@
 #include "redis_cluster.h"
 #include "queued_redis.h"
 #include "sentinel.h"
+#include "async_redis.h"
+#include "async_redis_cluster.h"
 
 #endif // end SEWENEW_REDISPLUSPLUS_REDISPLUSPLUS_H
@@ -15,11 +15,34 @@
  *************************************************************************/
 
 #include "redis.h"
+#include <cctype>
+#include <unordered_set>
 #include <hiredis/hiredis.h>
 #include "command.h"
 #include "errors.h"
 #include "queued_redis.h"
 
+namespace {
+
+bool is_read_only(const sw::redis::StringView &cmd_name) {
+    static const std::unordered_set<std::string> READ_ONLY_COMMANDS = {
+        "DBSIZE", "ECHO", "EXISTS", "GET", "GETRANGE", "HEXISTS", "HGET", "HGETALL",
+        "HKEYS", "HLEN", "HMGET", "HSCAN", "HSTRLEN", "HVALS", "INFO", "KEYS", "LINDEX",
+        "LLEN", "LRANGE", "MGET", "PING", "PTTL", "SCAN", "SCARD", "SISMEMBER", "SMEMBERS",
+        "SMISMEMBER", "SSCAN", "STRLEN", "TIME", "TTL", "TYPE", "ZCARD", "ZCOUNT", "ZRANGE",
+        "ZRANGEBYSCORE", "ZRANK", "ZREVRANGE", "ZREVRANK", "ZSCAN", "ZSCORE"
+    };
+
+    std::string name(cmd_name.data(), cmd_name.size());
+    for (auto &c : name) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+
+    return READ_ONLY_COMMANDS.find(name) != READ_ONLY_COMMANDS.end();
+}
+
+}
+
 namespace sw {
 
 namespace redis {
@@ -42,6 +65,42 @@ Subscriber Redis::subscriber() {
     return Subscriber(_pool.create());
 }
 
+void Redis::enable_client_cache(const ClientCacheOptions &opts) {
+    if (_connection) {
+        throw Error("Client cache only works with connection pool");
+    }
+
+    _client_cache.reset(new ClientCache(_pool.connection_options(), opts));
+}
+
+ClientCacheStats Redis::client_cache_stats() const {
+    if (!_client_cache) {
+        return ClientCacheStats{};
+    }
+
+    return _client_cache->stats();
+}
+
+void Redis::enable_metrics(const MetricsOptions &opts) {
+    _metrics.reset(new Metrics(opts));
+}
+
+MetricsStats Redis::metrics_stats() const {
+    if (!_metrics) {
+        return MetricsStats{};
+    }
+
+    return _metrics->stats();
+}
+
+ConnectionPoolStats Redis::pool_stats() {
+    return _pool.stats();
+}
+
+void Redis::set_tracer(TracerSPtr tracer) {
+    _tracer = std::move(tracer);
+}
+
 // CONNECTION commands.
 
 void Redis::auth(const StringView &password) {
@@ -97,12 +156,16 @@ long long Redis::dbsize() {
 void Redis::flushall(bool async) {
     auto reply = command(cmd::flushall, async);
 
+    _flush_cached();
+
     reply::parse<void>(*reply);
 }
 
 void Redis::flushdb(bool async) {
     auto reply = command(cmd::flushdb, async);
 
+    _flush_cached();
+
     reply::parse<void>(*reply);
 }
 
@@ -135,6 +198,8 @@ void Redis::save() {
 long long Redis::del(const StringView &key) {
     auto reply = command(cmd::del, key);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
@@ -153,18 +218,24 @@ long long Redis::exists(const StringView &key) {
 bool Redis::expire(const StringView &key, long long timeout) {
     auto reply = command(cmd::expire, key, timeout);
 
+    _invalidate_cached(key);
+
     return reply::parse<bool>(*reply);
 }
 
 bool Redis::expireat(const StringView &key, long long timestamp) {
     auto reply = command(cmd::expireat, key, timestamp);
 
+    _invalidate_cached(key);
+
     return reply::parse<bool>(*reply);
 }
 
 bool Redis::move(const StringView &key, long long db) {
     auto reply = command(cmd::move, key, db);
 
+    _invalidate_cached(key);
+
     return reply::parse<bool>(*reply);
 }
 
@@ -177,12 +248,16 @@ bool Redis::persist(const StringView &key) {
 bool Redis::pexpire(const StringView &key, long long timeout) {
     auto reply = command(cmd::pexpire, key, timeout);
 
+    _invalidate_cached(key);
+
     return reply::parse<bool>(*reply);
 }
 
 bool Redis::pexpireat(const StringView &key, long long timestamp) {
     auto reply = command(cmd::pexpireat, key, timestamp);
 
+    _invalidate_cached(key);
+
     return reply::parse<bool>(*reply);
 }
 
@@ -201,12 +276,18 @@ OptionalString Redis::randomkey() {
 void Redis::rename(const StringView &key, const StringView &newkey) {
     auto reply = command(cmd::rename, key, newkey);
 
+    _invalidate_cached(key);
+    _invalidate_cached(newkey);
+
     reply::parse<void>(*reply);
 }
 
 bool Redis::renamenx(const StringView &key, const StringView &newkey) {
     auto reply = command(cmd::renamenx, key, newkey);
 
+    _invalidate_cached(key);
+    _invalidate_cached(newkey);
+
     return reply::parse<bool>(*reply);
 }
 
@@ -216,6 +297,8 @@ void Redis::restore(const StringView &key,
                     bool replace) {
     auto reply = command(cmd::restore, key, val, ttl, replace);
 
+    _invalidate_cached(key);
+
     reply::parse<void>(*reply);
 }
 
@@ -240,11 +323,13 @@ std::string Redis::type(const StringView &key) {
 long long Redis::unlink(const StringView &key) {
     auto reply = command(cmd::unlink, key);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
 long long Redis::wait(long long numslaves, long long timeout) {
-    auto reply = command(cmd::wait, numslaves, timeout);
+    auto reply = _blocking_command(cmd::wait, numslaves, timeout);
 
     return reply::parse<long long>(*reply);
 }
@@ -254,6 +339,8 @@ long long Redis::wait(long long numslaves, long long timeout) {
 long long Redis::append(const StringView &key, const StringView &val) {
     auto reply = command(cmd::append, key, val);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
@@ -266,6 +353,8 @@ long long Redis::bitcount(const StringView &key, long long start, long long end)
 long long Redis::bitop(BitOp op, const StringView &destination, const StringView &key) {
     auto reply = command(cmd::bitop, op, destination, key);
 
+    _invalidate_cached(destination);
+
     return reply::parse<long long>(*reply);
 }
 
@@ -281,21 +370,35 @@ long long Redis::bitpos(const StringView &key,
 long long Redis::decr(const StringView &key) {
     auto reply = command(cmd::decr, key);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
 long long Redis::decrby(const StringView &key, long long decrement) {
     auto reply = command(cmd::decrby, key, decrement);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
 OptionalString Redis::get(const StringView &key) {
+    if (_client_cache) {
+        return _cached_get(key);
+    }
+
     auto reply = command(cmd::get, key);
 
     return reply::parse<OptionalString>(*reply);
 }
 
+ReplyView<OptionalStringView> Redis::get_view(const StringView &key) {
+    auto reply = command(cmd::get, key);
+
+    return ReplyView<OptionalStringView>(std::move(reply));
+}
+
 long long Redis::getbit(const StringView &key, long long offset) {
     auto reply = command(cmd::getbit, key, offset);
 
@@ -311,24 +414,32 @@ std::string Redis::getrange(const StringView &key, long long start, long long en
 OptionalString Redis::getset(const StringView &key, const StringView &val) {
     auto reply = command(cmd::getset, key, val);
 
+    _invalidate_cached(key);
+
     return reply::parse<OptionalString>(*reply);
 }
 
 long long Redis::incr(const StringView &key) {
     auto reply = command(cmd::incr, key);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
 long long Redis::incrby(const StringView &key, long long increment) {
     auto reply = command(cmd::incrby, key, increment);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
 double Redis::incrbyfloat(const StringView &key, double increment) {
     auto reply = command(cmd::incrbyfloat, key, increment);
 
+    _invalidate_cached(key);
+
     return reply::parse<double>(*reply);
 }
 
@@ -337,6 +448,8 @@ void Redis::psetex(const StringView &key,
                         const StringView &val) {
     auto reply = command(cmd::psetex, key, ttl, val);
 
+    _invalidate_cached(key);
+
     reply::parse<void>(*reply);
 }
 
@@ -346,6 +459,8 @@ bool Redis::set(const StringView &key,
                     UpdateType type) {
     auto reply = command(cmd::set, key, val, ttl.count(), type);
 
+    _invalidate_cached(key);
+
     reply::rewrite_set_reply(*reply);
 
     return reply::parse<bool>(*reply);
@@ -356,18 +471,24 @@ void Redis::setex(const StringView &key,
                     const StringView &val) {
     auto reply = command(cmd::setex, key, ttl, val);
 
+    _invalidate_cached(key);
+
     reply::parse<void>(*reply);
 }
 
 bool Redis::setnx(const StringView &key, const StringView &val) {
     auto reply = command(cmd::setnx, key, val);
 
+    _invalidate_cached(key);
+
     return reply::parse<bool>(*reply);
 }
 
 long long Redis::setrange(const StringView &key, long long offset, const StringView &val) {
     auto reply = command(cmd::setrange, key, offset, val);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
@@ -380,7 +501,7 @@ long long Redis::strlen(const StringView &key) {
 // LIST commands.
 
 OptionalStringPair Redis::blpop(const StringView &key, long long timeout) {
-    auto reply = command(cmd::blpop, key, timeout);
+    auto reply = _blocking_command(cmd::blpop, key, timeout);
 
     return reply::parse<OptionalStringPair>(*reply);
 }
@@ -392,7 +513,7 @@ OptionalStringPair Redis::blpop(const StringView &key, const std::chrono::second
 OptionalString Redis::brpoplpush(const StringView &source,
                                     const StringView &destination,
                                     long long timeout) {
-    auto reply = command(cmd::brpoplpush, source, destination, timeout);
+    auto reply = _blocking_command(cmd::brpoplpush, source, destination, timeout);
 
     return reply::parse<OptionalString>(*reply);
 }
@@ -436,6 +557,14 @@ long long Redis::lpushx(const StringView &key, const StringView &val) {
     return reply::parse<long long>(*reply);
 }
 
+ReplyView<std::vector<StringView>> Redis::lrange_view(const StringView &key,
+                                                      long long start,
+                                                      long long stop) {
+    auto reply = command(cmd::lrange, key, start, stop);
+
+    return ReplyView<std::vector<StringView>>(std::move(reply));
+}
+
 long long Redis::lrem(const StringView &key, long long count, const StringView &val) {
     auto reply = command(cmd::lrem, key, count, val);
 
@@ -481,6 +610,8 @@ long long Redis::rpushx(const StringView &key, const StringView &val) {
 long long Redis::hdel(const StringView &key, const StringView &field) {
     auto reply = command(cmd::hdel, key, field);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
@@ -491,20 +622,34 @@ bool Redis::hexists(const StringView &key, const StringView &field) {
 }
 
 OptionalString Redis::hget(const StringView &key, const StringView &field) {
+    if (_client_cache) {
+        return _cached_hget(key, field);
+    }
+
     auto reply = command(cmd::hget, key, field);
 
     return reply::parse<OptionalString>(*reply);
 }
 
+ReplyView<OptionalStringView> Redis::hget_view(const StringView &key, const StringView &field) {
+    auto reply = command(cmd::hget, key, field);
+
+    return ReplyView<OptionalStringView>(std::move(reply));
+}
+
 long long Redis::hincrby(const StringView &key, const StringView &field, long long increment) {
     auto reply = command(cmd::hincrby, key, field, increment);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
 double Redis::hincrbyfloat(const StringView &key, const StringView &field, double increment) {
     auto reply = command(cmd::hincrbyfloat, key, field, increment);
 
+    _invalidate_cached(key);
+
     return reply::parse<double>(*reply);
 }
 
@@ -517,6 +662,8 @@ long long Redis::hlen(const StringView &key) {
 bool Redis::hset(const StringView &key, const StringView &field, const StringView &val) {
     auto reply = command(cmd::hset, key, field, val);
 
+    _invalidate_cached(key);
+
     return reply::parse<bool>(*reply);
 }
 
@@ -527,6 +674,8 @@ bool Redis::hset(const StringView &key, const std::pair<StringView, StringView>
 bool Redis::hsetnx(const StringView &key, const StringView &field, const StringView &val) {
     auto reply = command(cmd::hsetnx, key, field, val);
 
+    _invalidate_cached(key);
+
     return reply::parse<bool>(*reply);
 }
 
@@ -590,14 +739,14 @@ long long Redis::srem(const StringView &key, const StringView &member) {
 
 auto Redis::bzpopmax(const StringView &key, long long timeout)
     -> Optional<std::tuple<std::string, std::string, double>> {
-    auto reply = command(cmd::bzpopmax, key, timeout);
+    auto reply = _blocking_command(cmd::bzpopmax, key, timeout);
 
     return reply::parse<Optional<std::tuple<std::string, std::string, double>>>(*reply);
 }
 
 auto Redis::bzpopmin(const StringView &key, long long timeout)
     -> Optional<std::tuple<std::string, std::string, double>> {
-    auto reply = command(cmd::bzpopmin, key, timeout);
+    auto reply = _blocking_command(cmd::bzpopmin, key, timeout);
 
     return reply::parse<Optional<std::tuple<std::string, std::string, double>>>(*reply);
 }
@@ -831,6 +980,83 @@ long long Redis::xtrim(const StringView &key, long long count, bool approx) {
     return reply::parse<long long>(*reply);
 }
 
+std::unique_ptr<AutoPipeline> Redis::_create_auto_pipeline(const ConnectionPoolOptions &opts) {
+    if (!opts.auto_pipeline) {
+        return nullptr;
+    }
+
+    // At most one batch for each connection.
+    return std::unique_ptr<AutoPipeline>(new AutoPipeline(opts.size));
+}
+
+OptionalString Redis::_cached_get(const StringView &key) {
+    assert(_client_cache);
+
+    OptionalString val;
+    if (_client_cache->get(key, val)) {
+        // Cache hit, and no connection is needed.
+        return val;
+    }
+
+    auto ticket = _client_cache->ticket(key);
+    if (ticket.client_id < 0) {
+        // Invalidation connection is NOT ready.
+        auto reply = command(cmd::get, key);
+
+        return reply::parse<OptionalString>(*reply);
+    }
+
+    auto reply = _tracked_command(ticket.client_id, cmd::get, key);
+
+    val = reply::parse<OptionalString>(*reply);
+
+    _client_cache->set(ticket, key, val);
+
+    return val;
+}
+
+void Redis::_invalidate_cached(const StringView &key) {
+    if (_client_cache) {
+        _client_cache->invalidate(key);
+    }
+}
+
+void Redis::_flush_cached() {
+    if (_client_cache) {
+        _client_cache->flush();
+    }
+}
+
+void Redis::_flush_cached(const StringView &cmd_name) {
+    if (_client_cache && !is_read_only(cmd_name)) {
+        _client_cache->flush();
+    }
+}
+
+OptionalString Redis::_cached_hget(const StringView &key, const StringView &field) {
+    assert(_client_cache);
+
+    OptionalString val;
+    if (_client_cache->hget(key, field, val)) {
+        return val;
+    }
+
+    auto ticket = _client_cache->ticket(key);
+    if (ticket.client_id < 0) {
+        auto reply = command(cmd::hget, key, field);
+
+        return reply::parse<OptionalString>(*reply);
+    }
+
+    auto reply = _tracked_command(ticket.client_id, cmd::hget, key, field);
+
+    val = reply::parse<OptionalString>(*reply);
+
+    _client_cache->hset(ticket, key, field, val);
+
+    return val;
+}
+
 }
 
 }
@@ -22,7 +22,11 @@
 #include <memory>
 #include <initializer_list>
 #include <tuple>
+#include <vector>
 #include "connection_pool.h"
+#include "auto_pipeline.h"
+#include "client_cache.h"
+#include "metrics.h"
 #include "reply.h"
 #include "command_options.h"
 #include "utils.h"
@@ -45,7 +49,10 @@ using Pipeline = QueuedRedis<PipelineImpl>;
 class Redis {
 public:
     Redis(const ConnectionOptions &connection_opts,
-            const ConnectionPoolOptions &pool_opts = {}) : _pool(pool_opts, connection_opts) {}
+            const ConnectionPoolOptions &pool_opts = {}) :
+                _pool(pool_opts, connection_opts),
+                _auto_pipeline(_create_auto_pipeline(pool_opts)),
+                _stream_replies(pool_opts.stream_replies) {}
 
     // Construct Redis instance with URI:
     // "tcp://127.0.0.1", "tcp://127.0.0.1:6379", or "unix://path/to/socket"
@@ -56,7 +63,9 @@ public:
             Role role,
             const ConnectionOptions &connection_opts,
             const ConnectionPoolOptions &pool_opts = {}) :
-                _pool(SimpleSentinel(sentinel, master_name, role), pool_opts, connection_opts) {}
+                _pool(SimpleSentinel(sentinel, master_name, role), pool_opts, connection_opts),
+                _auto_pipeline(_create_auto_pipeline(pool_opts)),
+                _stream_replies(pool_opts.stream_replies) {}
 
     Redis(const Redis &) = delete;
     Redis& operator=(const Redis &) = delete;
@@ -70,6 +79,29 @@ public:
 
     Subscriber subscriber();
 
+    // Cache replies of GET and HGET in process, and invalidate them with Redis' CLIENT
+    // TRACKING, which requires Redis 6.0 or later. Only works in pool mode.
+    // NOTE: It's NOT thread-safe, i.e. call it before sharing the Redis object.
+    void enable_client_cache(const ClientCacheOptions &opts = {});
+
+    ClientCacheStats client_cache_stats() const;
+
+    // Record latencies of commands, and errors, for each command and each node.
+    // Commands sent with Pipeline, Transaction, Subscriber or auto-pipelining
+    // are NOT recorded.
+    // NOTE: It's NOT thread-safe, i.e. call it before sharing the Redis object.
+    void enable_metrics(const MetricsOptions &opts = {});
+
+    // Returns empty stats, if *enable_metrics* is NOT called.
+    MetricsStats metrics_stats() const;
+
+    ConnectionPoolStats pool_stats();
+
+    // Trace commands with *tracer*. Pass nullptr to disable tracing. Commands are traced
+    // in the same places where metrics are recorded, see *enable_metrics*.
+    // NOTE: It's NOT thread-safe, i.e. call it before sharing the Redis object.
+    void set_tracer(TracerSPtr tracer);
+
     template <typename Cmd, typename ...Args>
     auto command(Cmd cmd, Args &&...args)
         -> typename std::enable_if<!std::is_convertible<Cmd, StringView>::value, ReplyUPtr>::type;
@@ -300,6 +332,10 @@ public:
 
     OptionalString get(const StringView &key);
 
+    // Same as *get*, but the value is NOT copied out of the reply. Instead, the returned
+    // ReplyView owns the reply, and the StringView is valid as long as the ReplyView is alive.
+    ReplyView<OptionalStringView> get_view(const StringView &key);
+
     long long getbit(const StringView &key, long long offset);
 
     std::string getrange(const StringView &key, long long start, long long end);
@@ -442,6 +478,10 @@ public:
     template <typename Output>
     void lrange(const StringView &key, long long start, long long stop, Output output);
 
+    ReplyView<std::vector<StringView>> lrange_view(const StringView &key,
+                                                    long long start,
+                                                    long long stop);
+
     long long lrem(const StringView &key, long long count, const StringView &val);
 
     void lset(const StringView &key, long long index, const StringView &val);
@@ -480,6 +520,8 @@ public:
 
     OptionalString hget(const StringView &key, const StringView &field);
 
+    ReplyView<OptionalStringView> hget_view(const StringView &key, const StringView &field);
+
     template <typename Output>
     void hgetall(const StringView &key, Output output);
 
@@ -1448,6 +1490,47 @@ private:
     template <typename Cmd, typename ...Args>
     ReplyUPtr _command(Connection &connection, Cmd cmd, Args &&...args);
 
+    // Send *CLIENT TRACKING ON REDIRECT client_id* before the command, so that
+    // invalidation messages of keys read by the command go to the client cache.
+    // It's only sent if the connection hasn't been enabled with *client_id*, i.e. it's
+    // a new or reconnected connection, or the invalidation connection has changed.
+    template <typename Cmd, typename ...Args>
+    ReplyUPtr _tracked_command(long long client_id, Cmd cmd, Args &&...args);
+
+    OptionalString _cached_get(const StringView &key);
+
+    OptionalString _cached_hget(const StringView &key, const StringView &field);
+
+    // Remove keys modified with this Redis object from the client cache, so that we can
+    // read our own writes without waiting for invalidation messages. They do nothing,
+    // if *enable_client_cache* is NOT called.
+    void _invalidate_cached(const StringView &key);
+
+    template <typename Input>
+    void _invalidate_cached(Input first, Input last);
+
+    void _flush_cached();
+
+    // Flush the client cache after a generic command, since we don't know which keys
+    // are modified by it. Known read-only commands, e.g. GET, skip the flush.
+    void _flush_cached(const StringView &cmd_name);
+
+    // Blocking commands are never auto-pipelined, since they block the whole batch.
+    template <typename Cmd, typename ...Args>
+    ReplyUPtr _blocking_command(Cmd cmd, Args &&...args);
+
+    // Send the command, and stream elements of the ARRAY reply into *output*,
+    // i.e. the whole reply is never kept in memory.
+    template <typename Output, typename Cmd, typename ...Args>
+    void _stream_command(Output output, Cmd cmd, Args &&...args);
+
+    // Send the command, and write elements of the ARRAY reply into *output*. The reply is
+    // streamed if *ConnectionPoolOptions::stream_replies* is true, and buffered otherwise.
+    template <typename Output, typename Cmd, typename ...Args>
+    void _array_command(Output output, Cmd cmd, Args &&...args);
+
+    static std::unique_ptr<AutoPipeline> _create_auto_pipeline(const ConnectionPoolOptions &opts);
+
     template <typename Cmd, typename ...Args>
     ReplyUPtr _score_command(std::true_type, Cmd cmd, Args &&... args);
 
@@ -1467,6 +1550,21 @@ private:
     // This is used when we create Transaction, Pipeline and Subscriber.
     // In this case, *_pool* is empty, and is never used.
     ConnectionSPtr _connection;
+
+    // Only used in Pool Mode, and if *ConnectionPoolOptions::auto_pipeline* is true.
+    std::unique_ptr<AutoPipeline> _auto_pipeline;
+
+    // Only used in Pool Mode, and set with *ConnectionPoolOptions::stream_replies*.
+    bool _stream_replies = false;
+
+    // Only used in Pool Mode, and if *enable_client_cache* is called.
+    std::unique_ptr<ClientCache> _client_cache;
+
+    // Only used if *enable_metrics* is called.
+    std::unique_ptr<Metrics> _metrics;
+
+    // Only used if *set_tracer* is called with a non-null tracer.
+    TracerSPtr _tracer;
 };
 
 }
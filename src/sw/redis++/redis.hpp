@@ -37,6 +37,9 @@ auto Redis::command(Cmd cmd, Args &&...args)
         }
 
         return _command(*_connection, cmd, std::forward<Args>(args)...);
+    } else if (_auto_pipeline) {
+        // Pool Mode with auto-pipelining.
+        return _auto_pipeline->command(_pool, cmd, std::forward<Args>(args)...);
     } else {
         // Pool Mode, i.e. get connection from pool.
         auto connection = _pool.fetch();
@@ -58,7 +61,11 @@ auto Redis::command(const StringView &cmd_name, Args &&...args)
                     connection.send(cmd_args);
     };
 
-    return command(cmd, cmd_name, std::forward<Args>(args)...);
+    auto reply = command(cmd, cmd_name, std::forward<Args>(args)...);
+
+    _flush_cached(cmd_name);
+
+    return reply;
 }
 
 template <typename Input>
@@ -77,7 +84,11 @@ auto Redis::command(Input first, Input last)
                     connection.send(cmd_args);
     };
 
-    return command(cmd, first, last);
+    auto reply = command(cmd, first, last);
+
+    _flush_cached(*first);
+
+    return reply;
 }
 
 template <typename Result, typename ...Args>
@@ -131,6 +142,8 @@ long long Redis::del(Input first, Input last) {
 
     auto reply = command(cmd::del_range<Input>, first, last);
 
+    _invalidate_cached(first, last);
+
     return reply::parse<long long>(*reply);
 }
 
@@ -228,6 +241,8 @@ long long Redis::unlink(Input first, Input last) {
 
     auto reply = command(cmd::unlink_range<Input>, first, last);
 
+    _invalidate_cached(first, last);
+
     return reply::parse<long long>(*reply);
 }
 
@@ -245,6 +260,8 @@ long long Redis::bitop(BitOp op, const StringView &destination, Input first, Inp
 
     auto reply = command(cmd::bitop_range<Input>, op, destination, first, last);
 
+    _invalidate_cached(destination);
+
     return reply::parse<long long>(*reply);
 }
 
@@ -267,6 +284,10 @@ void Redis::mset(Input first, Input last) {
 
     auto reply = command(cmd::mset<Input>, first, last);
 
+    for (; first != last; ++first) {
+        _invalidate_cached(first->first);
+    }
+
     reply::parse<void>(*reply);
 }
 
@@ -278,6 +299,10 @@ bool Redis::msetnx(Input first, Input last) {
 
     auto reply = command(cmd::msetnx<Input>, first, last);
 
+    for (; first != last; ++first) {
+        _invalidate_cached(first->first);
+    }
+
     return reply::parse<bool>(*reply);
 }
 
@@ -301,7 +326,7 @@ OptionalStringPair Redis::blpop(Input first, Input last, long long timeout) {
         throw Error("BLPOP: no key specified");
     }
 
-    auto reply = command(cmd::blpop_range<Input>, first, last, timeout);
+    auto reply = _blocking_command(cmd::blpop_range<Input>, first, last, timeout);
 
     return reply::parse<OptionalStringPair>(*reply);
 }
@@ -319,7 +344,7 @@ OptionalStringPair Redis::brpop(Input first, Input last, long long timeout) {
         throw Error("BRPOP: no key specified");
     }
 
-    auto reply = command(cmd::brpop<Input>, first, last, timeout);
+    auto reply = _blocking_command(cmd::brpop<Input>, first, last, timeout);
 
     return reply::parse<OptionalStringPair>(*reply);
 }
@@ -350,9 +375,7 @@ inline long long Redis::lpush(const StringView &key, Input first, Input last) {
 
 template <typename Output>
 inline void Redis::lrange(const StringView &key, long long start, long long stop, Output output) {
-    auto reply = command(cmd::lrange, key, start, stop);
-
-    reply::to_array(*reply, output);
+    _array_command(output, cmd::lrange, key, start, stop);
 }
 
 template <typename Input>
@@ -376,14 +399,14 @@ inline long long Redis::hdel(const StringView &key, Input first, Input last) {
 
     auto reply = command(cmd::hdel_range<Input>, key, first, last);
 
+    _invalidate_cached(key);
+
     return reply::parse<long long>(*reply);
 }
 
 template <typename Output>
 inline void Redis::hgetall(const StringView &key, Output output) {
-    auto reply = command(cmd::hgetall, key);
-
-    reply::to_array(*reply, output);
+    _array_command(output, cmd::hgetall, key);
 }
 
 template <typename Output>
@@ -412,6 +435,8 @@ inline void Redis::hmset(const StringView &key, Input first, Input last) {
 
     auto reply = command(cmd::hmset<Input>, key, first, last);
 
+    _invalidate_cached(key);
+
     reply::parse<void>(*reply);
 }
 
@@ -519,9 +544,7 @@ long long Redis::sinterstore(const StringView &destination,
 
 template <typename Output>
 void Redis::smembers(const StringView &key, Output output) {
-    auto reply = command(cmd::smembers, key);
-
-    reply::to_array(*reply, output);
+    _array_command(output, cmd::smembers, key);
 }
 
 template <typename Output>
@@ -615,7 +638,7 @@ inline auto Redis::bzpopmax(const StringView &key, const std::chrono::seconds &t
 template <typename Input>
 auto Redis::bzpopmax(Input first, Input last, long long timeout)
     -> Optional<std::tuple<std::string, std::string, double>> {
-    auto reply = command(cmd::bzpopmax_range<Input>, first, last, timeout);
+    auto reply = _blocking_command(cmd::bzpopmax_range<Input>, first, last, timeout);
 
     return reply::parse<Optional<std::tuple<std::string, std::string, double>>>(*reply);
 }
@@ -636,7 +659,7 @@ inline auto Redis::bzpopmin(const StringView &key, const std::chrono::seconds &t
 template <typename Input>
 auto Redis::bzpopmin(Input first, Input last, long long timeout)
     -> Optional<std::tuple<std::string, std::string, double>> {
-    auto reply = command(cmd::bzpopmin_range<Input>, first, last, timeout);
+    auto reply = _blocking_command(cmd::bzpopmin_range<Input>, first, last, timeout);
 
     return reply::parse<Optional<std::tuple<std::string, std::string, double>>>(*reply);
 }
@@ -712,9 +735,7 @@ void Redis::zpopmin(const StringView &key, long long count, Output output) {
 
 template <typename Output>
 void Redis::zrange(const StringView &key, long long start, long long stop, Output output) {
-    auto reply = _score_command<Output>(cmd::zrange, key, start, stop);
-
-    reply::to_array(*reply, output);
+    _array_command(output, cmd::zrange, key, start, stop, IsKvPairIter<Output>::value);
 }
 
 template <typename Interval, typename Output>
@@ -1198,7 +1219,7 @@ void Redis::xread(const StringView &key,
                     const std::chrono::milliseconds &timeout,
                     long long count,
                     Output output) {
-    auto reply = command(cmd::xread_block, key, id, timeout.count(), count);
+    auto reply = _blocking_command(cmd::xread_block, key, id, timeout.count(), count);
 
     if (!reply::is_nil(*reply)) {
         reply::to_array(*reply, output);
@@ -1216,7 +1237,7 @@ auto Redis::xread(Input first,
         throw Error("XREAD: no key specified");
     }
 
-    auto reply = command(cmd::xread_block_range<Input>, first, last, timeout.count(), count);
+    auto reply = _blocking_command(cmd::xread_block_range<Input>, first, last, timeout.count(), count);
 
     if (!reply::is_nil(*reply)) {
         reply::to_array(*reply, output);
@@ -1267,7 +1288,7 @@ void Redis::xreadgroup(const StringView &group,
                         long long count,
                         bool noack,
                         Output output) {
-    auto reply = command(cmd::xreadgroup_block,
+    auto reply = _blocking_command(cmd::xreadgroup_block,
                             group,
                             consumer,
                             key,
@@ -1295,7 +1316,7 @@ auto Redis::xreadgroup(const StringView &group,
         throw Error("XREADGROUP: no key specified");
     }
 
-    auto reply = command(cmd::xreadgroup_block_range<Input>,
+    auto reply = _blocking_command(cmd::xreadgroup_block_range<Input>,
                             group,
                             consumer,
                             first,
@@ -1334,13 +1355,132 @@ template <typename Cmd, typename ...Args>
 ReplyUPtr Redis::_command(Connection &connection, Cmd cmd, Args &&...args) {
     assert(!connection.broken());
 
+    CommandTimer timer(_metrics.get(), _tracer.get(), connection);
+
     cmd(connection, std::forward<Args>(args)...);
 
     auto reply = connection.recv();
 
+    timer.done(reply.get());
+
     return reply;
 }
 
+template <typename Input>
+void Redis::_invalidate_cached(Input first, Input last) {
+    if (!_client_cache) {
+        return;
+    }
+
+    for (; first != last; ++first) {
+        _client_cache->invalidate(*first);
+    }
+}
+
+template <typename Cmd, typename ...Args>
+ReplyUPtr Redis::_tracked_command(long long client_id, Cmd cmd, Args &&...args) {
+    auto connection = _pool.fetch();
+
+    assert(!connection.broken());
+
+    ConnectionPoolGuard guard(_pool, connection);
+
+    if (connection.tracking_redirect() == client_id) {
+        // Tracking has already been enabled with this connection.
+        return _command(connection, cmd, std::forward<Args>(args)...);
+    }
+
+    // Pipeline them, and we still have a single round trip.
+    cmd::client_tracking_redirect(connection, client_id);
+
+    CommandTimer timer(_metrics.get(), _tracer.get(), connection);
+
+    cmd(connection, std::forward<Args>(args)...);
+
+    // Always read both replies, so that the connection stays in sync.
+    std::exception_ptr err;
+    try {
+        reply::parse<void>(*connection.recv());
+    } catch (const ReplyError &) {
+        err = std::current_exception();
+    }
+
+    auto reply = connection.recv();
+
+    if (err) {
+        std::rethrow_exception(err);
+    }
+
+    connection.set_tracking_redirect(client_id);
+
+    timer.done(reply.get());
+
+    return reply;
+}
+
+template <typename Cmd, typename ...Args>
+ReplyUPtr Redis::_blocking_command(Cmd cmd, Args &&...args) {
+    if (!_auto_pipeline) {
+        return command(cmd, std::forward<Args>(args)...);
+    }
+
+    auto connection = _pool.fetch();
+
+    assert(!connection.broken());
+
+    ConnectionPoolGuard guard(_pool, connection);
+
+    return _command(connection, cmd, std::forward<Args>(args)...);
+}
+
+template <typename Output, typename Cmd, typename ...Args>
+void Redis::_stream_command(Output output, Cmd cmd, Args &&...args) {
+    reply::ArrayStream<Output> stream(output);
+
+    if (_connection) {
+        // Single Connection Mode.
+        if (_connection->broken()) {
+            throw Error("Connection is broken");
+        }
+
+        CommandTimer timer(_metrics.get(), _tracer.get(), *_connection);
+
+        cmd(*_connection, std::forward<Args>(args)...);
+
+        _connection->recv(std::ref(stream));
+
+        timer.done();
+    } else {
+        // Pool Mode. The reply is streamed, so it's NOT auto-pipelined.
+        auto connection = _pool.fetch();
+
+        assert(!connection.broken());
+
+        ConnectionPoolGuard guard(_pool, connection);
+
+        CommandTimer timer(_metrics.get(), _tracer.get(), connection);
+
+        cmd(connection, std::forward<Args>(args)...);
+
+        connection.recv(std::ref(stream));
+
+        timer.done();
+    }
+
+    stream.finish();
+}
+
+template <typename Output, typename Cmd, typename ...Args>
+void Redis::_array_command(Output output, Cmd cmd, Args &&...args) {
+    if (_stream_replies) {
+        _stream_command(output, cmd, std::forward<Args>(args)...);
+    } else {
+        auto reply = command(cmd, std::forward<Args>(args)...);
+
+        reply::to_array(*reply, output);
+    }
+}
+
 template <typename Cmd, typename ...Args>
 inline ReplyUPtr Redis::_score_command(std::true_type, Cmd cmd, Args &&... args) {
     return command(cmd, std::forward<Args>(args)..., true);
@@ -27,24 +27,43 @@ namespace redis {
 RedisCluster::RedisCluster(const std::string &uri) : RedisCluster(ConnectionOptions(uri)) {}
 
 Redis RedisCluster::redis(const StringView &hash_tag) {
-    auto opts = _pool.connection_options(hash_tag);
-    return Redis(std::make_shared<Connection>(opts));
+    return Redis(_pool.borrow(hash_tag));
 }
 
 Pipeline RedisCluster::pipeline(const StringView &hash_tag) {
-    auto opts = _pool.connection_options(hash_tag);
-    return Pipeline(std::make_shared<Connection>(opts));
+    return Pipeline(_pool.borrow(hash_tag));
 }
 
-
-
 Pipeline RedisCluster::pipeline(std::shared_ptr<Connection> con_) {
     return Pipeline(con_);
 }
 
+ClusterPipeline RedisCluster::cluster_pipeline() {
+    return ClusterPipeline(_pool);
+}
+
 Transaction RedisCluster::transaction(const StringView &hash_tag, bool piped) {
-    auto opts = _pool.connection_options(hash_tag);
-    return Transaction(std::make_shared<Connection>(opts), piped);
+    return Transaction(_pool.borrow(hash_tag), piped);
+}
+
+ConnectionPoolStats RedisCluster::pool_stats() {
+    return _pool.stats();
+}
+
+void RedisCluster::enable_metrics(const MetricsOptions &opts) {
+    _metrics.reset(new Metrics(opts));
+}
+
+MetricsStats RedisCluster::metrics_stats() const {
+    if (!_metrics) {
+        return MetricsStats{};
+    }
+
+    return _metrics->stats();
+}
+
+void RedisCluster::set_tracer(TracerSPtr tracer) {
+    _tracer = std::move(tracer);
 }
 
 Subscriber RedisCluster::subscriber() {
@@ -52,6 +71,10 @@ Subscriber RedisCluster::subscriber() {
     return Subscriber(Connection(opts));
 }
 
+ClusterScanner RedisCluster::scanner(const ClusterScanOptions &opts) {
+    return ClusterScanner(_pool.masters(), opts);
+}
+
 // KEY commands.
 
 long long RedisCluster::del(const StringView &key) {
@@ -61,13 +84,13 @@ long long RedisCluster::del(const StringView &key) {
 }
 
 OptionalString RedisCluster::dump(const StringView &key) {
-    auto reply = command(cmd::dump, key);
+    auto reply = _read_command(cmd::dump, key);
 
     return reply::parse<OptionalString>(*reply);
 }
 
 long long RedisCluster::exists(const StringView &key) {
-    auto reply = command(cmd::exists, key);
+    auto reply = _read_command(cmd::exists, key);
 
     return reply::parse<long long>(*reply);
 }
@@ -103,7 +126,7 @@ bool RedisCluster::pexpireat(const StringView &key, long long timestamp) {
 }
 
 long long RedisCluster::pttl(const StringView &key) {
-    auto reply = command(cmd::pttl, key);
+    auto reply = _read_command(cmd::pttl, key);
 
     return reply::parse<long long>(*reply);
 }
@@ -136,13 +159,13 @@ long long RedisCluster::touch(const StringView &key) {
 }
 
 long long RedisCluster::ttl(const StringView &key) {
-    auto reply = command(cmd::ttl, key);
+    auto reply = _read_command(cmd::ttl, key);
 
     return reply::parse<long long>(*reply);
 }
 
 std::string RedisCluster::type(const StringView &key) {
-    auto reply = command(cmd::type, key);
+    auto reply = _read_command(cmd::type, key);
 
     return reply::parse<std::string>(*reply);
 }
@@ -162,7 +185,7 @@ long long RedisCluster::append(const StringView &key, const StringView &val) {
 }
 
 long long RedisCluster::bitcount(const StringView &key, long long start, long long end) {
-    auto reply = command(cmd::bitcount, key, start, end);
+    auto reply = _read_command(cmd::bitcount, key, start, end);
 
     return reply::parse<long long>(*reply);
 }
@@ -177,7 +200,7 @@ long long RedisCluster::bitpos(const StringView &key,
                             long long bit,
                             long long start,
                             long long end) {
-    auto reply = command(cmd::bitpos, key, bit, start, end);
+    auto reply = _read_command(cmd::bitpos, key, bit, start, end);
 
     return reply::parse<long long>(*reply);
 }
@@ -195,19 +218,25 @@ long long RedisCluster::decrby(const StringView &key, long long decrement) {
 }
 
 OptionalString RedisCluster::get(const StringView &key) {
-    auto reply = command(cmd::get, key);
+    auto reply = _read_command(cmd::get, key);
 
     return reply::parse<OptionalString>(*reply);
 }
 
+ReplyView<OptionalStringView> RedisCluster::get_view(const StringView &key) {
+    auto reply = _read_command(cmd::get, key);
+
+    return ReplyView<OptionalStringView>(std::move(reply));
+}
+
 long long RedisCluster::getbit(const StringView &key, long long offset) {
-    auto reply = command(cmd::getbit, key, offset);
+    auto reply = _read_command(cmd::getbit, key, offset);
 
     return reply::parse<long long>(*reply);
 }
 
 std::string RedisCluster::getrange(const StringView &key, long long start, long long end) {
-    auto reply = command(cmd::getrange, key, start, end);
+    auto reply = _read_command(cmd::getrange, key, start, end);
 
     return reply::parse<std::string>(*reply);
 }
@@ -276,7 +305,7 @@ long long RedisCluster::setrange(const StringView &key, long long offset, const
 }
 
 long long RedisCluster::strlen(const StringView &key) {
-    auto reply = command(cmd::strlen, key);
+    auto reply = _read_command(cmd::strlen, key);
 
     return reply::parse<long long>(*reply);
 }
@@ -302,7 +331,7 @@ OptionalString RedisCluster::brpoplpush(const StringView &source,
 }
 
 OptionalString RedisCluster::lindex(const StringView &key, long long index) {
-    auto reply = command(cmd::lindex, key, index);
+    auto reply = _read_command(cmd::lindex, key, index);
 
     return reply::parse<OptionalString>(*reply);
 }
@@ -317,7 +346,7 @@ long long RedisCluster::linsert(const StringView &key,
 }
 
 long long RedisCluster::llen(const StringView &key) {
-    auto reply = command(cmd::llen, key);
+    auto reply = _read_command(cmd::llen, key);
 
     return reply::parse<long long>(*reply);
 }
@@ -340,6 +369,14 @@ long long RedisCluster::lpushx(const StringView &key, const StringView &val) {
     return reply::parse<long long>(*reply);
 }
 
+ReplyView<std::vector<StringView>> RedisCluster::lrange_view(const StringView &key,
+                                                             long long start,
+                                                             long long stop) {
+    auto reply = _read_command(cmd::lrange, key, start, stop);
+
+    return ReplyView<std::vector<StringView>>(std::move(reply));
+}
+
 long long RedisCluster::lrem(const StringView &key, long long count, const StringView &val) {
     auto reply = command(cmd::lrem, key, count, val);
 
@@ -389,17 +426,23 @@ long long RedisCluster::hdel(const StringView &key, const StringView &field) {
 }
 
 bool RedisCluster::hexists(const StringView &key, const StringView &field) {
-    auto reply = command(cmd::hexists, key, field);
+    auto reply = _read_command(cmd::hexists, key, field);
 
     return reply::parse<bool>(*reply);
 }
 
 OptionalString RedisCluster::hget(const StringView &key, const StringView &field) {
-    auto reply = command(cmd::hget, key, field);
+    auto reply = _read_command(cmd::hget, key, field);
 
     return reply::parse<OptionalString>(*reply);
 }
 
+ReplyView<OptionalStringView> RedisCluster::hget_view(const StringView &key, const StringView &field) {
+    auto reply = _read_command(cmd::hget, key, field);
+
+    return ReplyView<OptionalStringView>(std::move(reply));
+}
+
 long long RedisCluster::hincrby(const StringView &key, const StringView &field, long long increment) {
     auto reply = command(cmd::hincrby, key, field, increment);
 
@@ -413,7 +456,7 @@ double RedisCluster::hincrbyfloat(const StringView &key, const StringView &field
 }
 
 long long RedisCluster::hlen(const StringView &key) {
-    auto reply = command(cmd::hlen, key);
+    auto reply = _read_command(cmd::hlen, key);
 
     return reply::parse<long long>(*reply);
 }
@@ -439,7 +482,7 @@ bool RedisCluster::hsetnx(const StringView &key, const std::pair<StringView, Str
 }
 
 long long RedisCluster::hstrlen(const StringView &key, const StringView &field) {
-    auto reply = command(cmd::hstrlen, key, field);
+    auto reply = _read_command(cmd::hstrlen, key, field);
 
     return reply::parse<long long>(*reply);
 }
@@ -453,13 +496,13 @@ long long RedisCluster::sadd(const StringView &key, const StringView &member) {
 }
 
 long long RedisCluster::scard(const StringView &key) {
-    auto reply = command(cmd::scard, key);
+    auto reply = _read_command(cmd::scard, key);
 
     return reply::parse<long long>(*reply);
 }
 
 bool RedisCluster::sismember(const StringView &key, const StringView &member) {
-    auto reply = command(cmd::sismember, key, member);
+    auto reply = _read_command(cmd::sismember, key, member);
 
     return reply::parse<bool>(*reply);
 }
@@ -479,7 +522,7 @@ OptionalString RedisCluster::spop(const StringView &key) {
 }
 
 OptionalString RedisCluster::srandmember(const StringView &key) {
-    auto reply = command(cmd::srandmember, key);
+    auto reply = _read_command(cmd::srandmember, key);
 
     return reply::parse<OptionalString>(*reply);
 }
@@ -517,7 +560,7 @@ long long RedisCluster::zadd(const StringView &key,
 }
 
 long long RedisCluster::zcard(const StringView &key) {
-    auto reply = command(cmd::zcard, key);
+    auto reply = _read_command(cmd::zcard, key);
 
     return reply::parse<long long>(*reply);
 }
@@ -541,7 +584,7 @@ Optional<std::pair<std::string, double>> RedisCluster::zpopmin(const StringView
 }
 
 OptionalLongLong RedisCluster::zrank(const StringView &key, const StringView &member) {
-    auto reply = command(cmd::zrank, key, member);
+    auto reply = _read_command(cmd::zrank, key, member);
 
     return reply::parse<OptionalLongLong>(*reply);
 }
@@ -559,13 +602,13 @@ long long RedisCluster::zremrangebyrank(const StringView &key, long long start,
 }
 
 OptionalLongLong RedisCluster::zrevrank(const StringView &key, const StringView &member) {
-    auto reply = command(cmd::zrevrank, key, member);
+    auto reply = _read_command(cmd::zrevrank, key, member);
 
     return reply::parse<OptionalLongLong>(*reply);
 }
 
 OptionalDouble RedisCluster::zscore(const StringView &key, const StringView &member) {
-    auto reply = command(cmd::zscore, key, member);
+    auto reply = _read_command(cmd::zscore, key, member);
 
     return reply::parse<OptionalDouble>(*reply);
 }
@@ -597,7 +640,7 @@ OptionalDouble RedisCluster::geodist(const StringView &key,
                                 const StringView &member1,
                                 const StringView &member2,
                                 GeoUnit unit) {
-    auto reply = command(cmd::geodist, key, member1, member2, unit);
+    auto reply = _read_command(cmd::geodist, key, member1, member2, unit);
 
     return reply::parse<OptionalDouble>(*reply);
 }
@@ -698,7 +741,7 @@ long long RedisCluster::xgroup_delconsumer(const StringView &key,
 }
 
 long long RedisCluster::xlen(const StringView &key) {
-    auto reply = command(cmd::xlen, key);
+    auto reply = _read_command(cmd::xlen, key);
 
     return reply::parse<long long>(*reply);
 }
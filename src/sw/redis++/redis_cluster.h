@@ -21,12 +21,15 @@
 #include <chrono>
 #include <initializer_list>
 #include <tuple>
+#include <vector>
 #include "shards_pool.h"
 #include "reply.h"
 #include "command_options.h"
 #include "utils.h"
 #include "subscriber.h"
 #include "pipeline.h"
+#include "cluster_pipeline.h"
+#include "cluster_scanner.h"
 #include "transaction.h"
 #include "redis.h"
 
@@ -44,8 +47,9 @@ using Pipeline = QueuedRedis<PipelineImpl>;
 class RedisCluster {
 public:
     RedisCluster(const ConnectionOptions &connection_opts,
-                    const ConnectionPoolOptions &pool_opts = {}) :
-                        _pool(pool_opts, connection_opts) {}
+                    const ConnectionPoolOptions &pool_opts = {},
+                    const ClusterOptions &cluster_opts = {}) :
+                        _pool(pool_opts, connection_opts, cluster_opts) {}
 
     // Construct RedisCluster with URI:
     // "tcp://127.0.0.1" or "tcp://127.0.0.1:6379"
@@ -58,17 +62,56 @@ public:
     RedisCluster(RedisCluster &&) = default;
     RedisCluster& operator=(RedisCluster &&) = default;
 
+    // Redis, Pipeline and Transaction objects created with hash tag borrow a connection
+    // from the pool of the node holding the slot, and return it when they're destroyed.
+    // So DO NOT change the connection's state with the Redis object, e.g. WATCH keys
+    // without EXEC or UNWATCH, since the connection will be reused by others.
     Redis redis(const StringView &hash_tag);
 
     Pipeline pipeline(const StringView &hash_tag);
 
     Pipeline pipeline(std::shared_ptr<Connection> connection);
 
+    // Unlike *pipeline(hash_tag)*, keys of commands in ClusterPipeline
+    // DO NOT need to be located on the same slot.
+    ClusterPipeline cluster_pipeline();
 
     Transaction transaction(const StringView &hash_tag, bool piped = false);
 
     Subscriber subscriber();
 
+    // Iterate keys of all masters, e.g. to warm up a cache or migrate data.
+    // See ClusterScanner for details.
+    ClusterScanner scanner(const ClusterScanOptions &opts = {});
+
+    // Get the slot of *key*. It doesn't talk to the cluster.
+    Slot slot(const StringView &key) const {
+        return _pool.slot(key);
+    }
+
+    // Get slots of keys in range [first, last), and write them to *output*.
+    template <typename Input, typename Output>
+    void slots(Input first, Input last, Output output) const {
+        _pool.slots(first, last, output);
+    }
+
+    // Statistics of connection pools of all nodes.
+    ConnectionPoolStats pool_stats();
+
+    // Record latencies of commands, and errors, for each command and each node.
+    // Commands sent with Redis, Pipeline, Transaction, ClusterPipeline or Subscriber
+    // objects created by RedisCluster are NOT recorded.
+    // NOTE: It's NOT thread-safe, i.e. call it before sharing the RedisCluster object.
+    void enable_metrics(const MetricsOptions &opts = {});
+
+    // Returns empty stats, if *enable_metrics* is NOT called.
+    MetricsStats metrics_stats() const;
+
+    // Trace commands with *tracer*. Pass nullptr to disable tracing. Commands are traced
+    // in the same places where metrics are recorded, see *enable_metrics*.
+    // NOTE: It's NOT thread-safe, i.e. call it before sharing the RedisCluster object.
+    void set_tracer(TracerSPtr tracer);
+
     template <typename Cmd, typename Key, typename ...Args>
     auto command(Cmd cmd, Key &&key, Args &&...args)
         -> typename std::enable_if<!std::is_convertible<Cmd, StringView>::value, ReplyUPtr>::type;
@@ -104,6 +147,11 @@ public:
 
     // KEY commands.
 
+    // NOTE: Keys of the following multiple-key commands, i.e. DEL, EXISTS, TOUCH, UNLINK,
+    // MGET and MSET, DO NOT need to be located on the same slot. Keys are grouped by slot,
+    // and commands of each slot are pipelined to the node holding the slot. However,
+    // in this case, these commands are NOT atomic any more.
+
     long long del(const StringView &key);
 
     template <typename Input>
@@ -217,6 +265,8 @@ public:
 
     OptionalString get(const StringView &key);
 
+    ReplyView<OptionalStringView> get_view(const StringView &key);
+
     long long getbit(const StringView &key, long long offset);
 
     std::string getrange(const StringView &key, long long start, long long end);
@@ -359,6 +409,10 @@ public:
     template <typename Output>
     void lrange(const StringView &key, long long start, long long stop, Output output);
 
+    ReplyView<std::vector<StringView>> lrange_view(const StringView &key,
+                                                    long long start,
+                                                    long long stop);
+
     long long lrem(const StringView &key, long long count, const StringView &val);
 
     void lset(const StringView &key, long long index, const StringView &val);
@@ -397,6 +451,8 @@ public:
 
     OptionalString hget(const StringView &key, const StringView &field);
 
+    ReplyView<OptionalStringView> hget_view(const StringView &key, const StringView &field);
+
     template <typename Output>
     void hgetall(const StringView &key, Output output);
 
@@ -1369,7 +1425,62 @@ private:
     template <typename Output, typename Cmd, typename ...Args>
     ReplyUPtr _score_command(Cmd cmd, Args &&... args);
 
+    // Send read-only command to a master or a replica, according to the read preference.
+    // If the replica fails, fall back to the master.
+    template <typename Cmd, typename ...Args>
+    ReplyUPtr _read_command(Cmd cmd, const StringView &key, Args &&...args);
+
+    template <typename Output, typename Cmd, typename ...Args>
+    ReplyUPtr _read_score_command(Cmd cmd, const StringView &key, Args &&...args);
+
+    // Keys, or key-value pairs, of a multiple-key command, which belong to the same slot.
+    template <typename T>
+    struct SlotBatch {
+        using Iterator = typename std::vector<T>::iterator;
+
+        explicit SlotBatch(Slot s) : slot(s) {}
+
+        Slot slot;
+
+        std::vector<T> items;
+
+        // Positions of items in the range specified by user.
+        std::vector<std::size_t> indexes;
+
+        ReplyUPtr reply;
+    };
+
+    using KeyBatch = SlotBatch<StringView>;
+
+    using KvBatch = SlotBatch<std::pair<StringView, StringView>>;
+
+    static const StringView& _batch_key(const StringView &key) {
+        return key;
+    }
+
+    static const StringView& _batch_key(const std::pair<StringView, StringView> &kv) {
+        return kv.first;
+    }
+
+    template <typename T, typename Input>
+    std::vector<SlotBatch<T>> _split_by_slot(Input first, Input last);
+
+    template <typename Cmd, typename T>
+    void _multi_slot_command(Cmd cmd, std::vector<SlotBatch<T>> &batches);
+
+    template <typename Cmd, typename T>
+    std::vector<SlotBatch<T>*> _send_batches(Cmd cmd, const std::vector<SlotBatch<T>*> &batches);
+
+    template <typename Cmd, typename Input>
+    long long _multi_slot_count(Cmd cmd, Input first, Input last);
+
     ShardsPool _pool;
+
+    // Only used if *enable_metrics* is called.
+    std::unique_ptr<Metrics> _metrics;
+
+    // Only used if *set_tracer* is called with a non-null tracer.
+    TracerSPtr _tracer;
 };
 
 }
@@ -18,6 +18,9 @@
 #define SEWENEW_REDISPLUSPLUS_REDIS_CLUSTER_HPP
 
 #include <utility>
+#include <vector>
+#include <unordered_map>
+#include <exception>
 #include "command.h"
 #include "reply.h"
 #include "utils.h"
@@ -124,9 +127,7 @@ long long RedisCluster::del(Input first, Input last) {
         throw Error("DEL: no key specified");
     }
 
-    auto reply = command(cmd::del_range<Input>, first, last);
-
-    return reply::parse<long long>(*reply);
+    return _multi_slot_count(cmd::del_range<KeyBatch::Iterator>, first, last);
 }
 
 template <typename Input>
@@ -135,9 +136,7 @@ long long RedisCluster::exists(Input first, Input last) {
         throw Error("EXISTS: no key specified");
     }
 
-    auto reply = command(cmd::exists_range<Input>, first, last);
-
-    return reply::parse<long long>(*reply);
+    return _multi_slot_count(cmd::exists_range<KeyBatch::Iterator>, first, last);
 }
 
 inline bool RedisCluster::expire(const StringView &key, const std::chrono::seconds &timeout) {
@@ -173,9 +172,7 @@ long long RedisCluster::touch(Input first, Input last) {
         throw Error("TOUCH: no key specified");
     }
 
-    auto reply = command(cmd::touch_range<Input>, first, last);
-
-    return reply::parse<long long>(*reply);
+    return _multi_slot_count(cmd::touch_range<KeyBatch::Iterator>, first, last);
 }
 
 template <typename Input>
@@ -184,9 +181,7 @@ long long RedisCluster::unlink(Input first, Input last) {
         throw Error("UNLINK: no key specified");
     }
 
-    auto reply = command(cmd::unlink_range<Input>, first, last);
-
-    return reply::parse<long long>(*reply);
+    return _multi_slot_count(cmd::unlink_range<KeyBatch::Iterator>, first, last);
 }
 
 // STRING commands.
@@ -208,9 +203,41 @@ void RedisCluster::mget(Input first, Input last, Output output) {
         throw Error("MGET: no key specified");
     }
 
-    auto reply = command(cmd::mget<Input>, first, last);
+    auto batches = _split_by_slot<StringView>(first, last);
 
-    reply::to_array(*reply, output);
+    _multi_slot_command(cmd::mget<KeyBatch::Iterator>, batches);
+
+    // Reorder replies with the positions of keys.
+    std::size_t key_num = 0;
+    for (const auto &batch : batches) {
+        key_num += batch.items.size();
+    }
+
+    std::vector<redisReply*> replies(key_num, nullptr);
+    for (const auto &batch : batches) {
+        assert(batch.reply);
+
+        auto &r = *(batch.reply);
+        if (!reply::is_array(r)
+                || r.element == nullptr
+                || r.elements != batch.indexes.size()) {
+            throw ProtoError("Invalid MGET reply");
+        }
+
+        for (std::size_t idx = 0; idx != r.elements; ++idx) {
+            replies[batch.indexes[idx]] = r.element[idx];
+        }
+    }
+
+    for (auto *sub_reply : replies) {
+        if (sub_reply == nullptr) {
+            throw ProtoError("Null array element reply");
+        }
+
+        *output = reply::parse<typename IterType<Output>::type>(*sub_reply);
+
+        ++output;
+    }
 }
 
 template <typename Input>
@@ -219,9 +246,15 @@ void RedisCluster::mset(Input first, Input last) {
         throw Error("MSET: no key specified");
     }
 
-    auto reply = command(cmd::mset<Input>, first, last);
+    auto batches = _split_by_slot<std::pair<StringView, StringView>>(first, last);
 
-    reply::parse<void>(*reply);
+    _multi_slot_command(cmd::mset<KvBatch::Iterator>, batches);
+
+    for (const auto &batch : batches) {
+        assert(batch.reply);
+
+        reply::parse<void>(*(batch.reply));
+    }
 }
 
 template <typename Input>
@@ -304,7 +337,7 @@ inline long long RedisCluster::lpush(const StringView &key, Input first, Input l
 
 template <typename Output>
 inline void RedisCluster::lrange(const StringView &key, long long start, long long stop, Output output) {
-    auto reply = command(cmd::lrange, key, start, stop);
+    auto reply = _read_command(cmd::lrange, key, start, stop);
 
     reply::to_array(*reply, output);
 }
@@ -335,14 +368,14 @@ inline long long RedisCluster::hdel(const StringView &key, Input first, Input la
 
 template <typename Output>
 inline void RedisCluster::hgetall(const StringView &key, Output output) {
-    auto reply = command(cmd::hgetall, key);
+    auto reply = _read_command(cmd::hgetall, key);
 
     reply::to_array(*reply, output);
 }
 
 template <typename Output>
 inline void RedisCluster::hkeys(const StringView &key, Output output) {
-    auto reply = command(cmd::hkeys, key);
+    auto reply = _read_command(cmd::hkeys, key);
 
     reply::to_array(*reply, output);
 }
@@ -353,7 +386,7 @@ inline void RedisCluster::hmget(const StringView &key, Input first, Input last,
         throw Error("HMGET: no key specified");
     }
 
-    auto reply = command(cmd::hmget<Input>, key, first, last);
+    auto reply = _read_command(cmd::hmget<Input>, key, first, last);
 
     reply::to_array(*reply, output);
 }
@@ -375,7 +408,7 @@ long long RedisCluster::hscan(const StringView &key,
                         const StringView &pattern,
                         long long count,
                         Output output) {
-    auto reply = command(cmd::hscan, key, cursor, pattern, count);
+    auto reply = _read_command(cmd::hscan, key, cursor, pattern, count);
 
     return reply::parse_scan_reply(*reply, output);
 }
@@ -405,7 +438,7 @@ inline long long RedisCluster::hscan(const StringView &key,
 
 template <typename Output>
 inline void RedisCluster::hvals(const StringView &key, Output output) {
-    auto reply = command(cmd::hvals, key);
+    auto reply = _read_command(cmd::hvals, key);
 
     reply::to_array(*reply, output);
 }
@@ -473,7 +506,7 @@ long long RedisCluster::sinterstore(const StringView &destination,
 
 template <typename Output>
 void RedisCluster::smembers(const StringView &key, Output output) {
-    auto reply = command(cmd::smembers, key);
+    auto reply = _read_command(cmd::smembers, key);
 
     reply::to_array(*reply, output);
 }
@@ -487,7 +520,7 @@ void RedisCluster::spop(const StringView &key, long long count, Output output) {
 
 template <typename Output>
 void RedisCluster::srandmember(const StringView &key, long long count, Output output) {
-    auto reply = command(cmd::srandmember_range, key, count);
+    auto reply = _read_command(cmd::srandmember_range, key, count);
 
     reply::to_array(*reply, output);
 }
@@ -509,7 +542,7 @@ long long RedisCluster::sscan(const StringView &key,
                         const StringView &pattern,
                         long long count,
                         Output output) {
-    auto reply = command(cmd::sscan, key, cursor, pattern, count);
+    auto reply = _read_command(cmd::sscan, key, cursor, pattern, count);
 
     return reply::parse_scan_reply(*reply, output);
 }
@@ -620,7 +653,7 @@ long long RedisCluster::zadd(const StringView &key,
 
 template <typename Interval>
 long long RedisCluster::zcount(const StringView &key, const Interval &interval) {
-    auto reply = command(cmd::zcount<Interval>, key, interval);
+    auto reply = _read_command(cmd::zcount<Interval>, key, interval);
 
     return reply::parse<long long>(*reply);
 }
@@ -645,7 +678,7 @@ long long RedisCluster::zinterstore(const StringView &destination,
 
 template <typename Interval>
 long long RedisCluster::zlexcount(const StringView &key, const Interval &interval) {
-    auto reply = command(cmd::zlexcount<Interval>, key, interval);
+    auto reply = _read_command(cmd::zlexcount<Interval>, key, interval);
 
     return reply::parse<long long>(*reply);
 }
@@ -666,7 +699,7 @@ void RedisCluster::zpopmin(const StringView &key, long long count, Output output
 
 template <typename Output>
 void RedisCluster::zrange(const StringView &key, long long start, long long stop, Output output) {
-    auto reply = _score_command<Output>(cmd::zrange, key, start, stop);
+    auto reply = _read_score_command<Output>(cmd::zrange, key, start, stop);
 
     reply::to_array(*reply, output);
 }
@@ -681,7 +714,7 @@ void RedisCluster::zrangebylex(const StringView &key,
                         const Interval &interval,
                         const LimitOptions &opts,
                         Output output) {
-    auto reply = command(cmd::zrangebylex<Interval>, key, interval, opts);
+    auto reply = _read_command(cmd::zrangebylex<Interval>, key, interval, opts);
 
     reply::to_array(*reply, output);
 }
@@ -698,10 +731,10 @@ void RedisCluster::zrangebyscore(const StringView &key,
                             const Interval &interval,
                             const LimitOptions &opts,
                             Output output) {
-    auto reply = _score_command<Output>(cmd::zrangebyscore<Interval>,
-                                        key,
-                                        interval,
-                                        opts);
+    auto reply = _read_score_command<Output>(cmd::zrangebyscore<Interval>,
+                                                key,
+                                                interval,
+                                                opts);
 
     reply::to_array(*reply, output);
 }
@@ -733,7 +766,7 @@ long long RedisCluster::zremrangebyscore(const StringView &key, const Interval &
 
 template <typename Output>
 void RedisCluster::zrevrange(const StringView &key, long long start, long long stop, Output output) {
-    auto reply = _score_command<Output>(cmd::zrevrange, key, start, stop);
+    auto reply = _read_score_command<Output>(cmd::zrevrange, key, start, stop);
 
     reply::to_array(*reply, output);
 }
@@ -750,7 +783,7 @@ void RedisCluster::zrevrangebylex(const StringView &key,
                             const Interval &interval,
                             const LimitOptions &opts,
                             Output output) {
-    auto reply = command(cmd::zrevrangebylex<Interval>, key, interval, opts);
+    auto reply = _read_command(cmd::zrevrangebylex<Interval>, key, interval, opts);
 
     reply::to_array(*reply, output);
 }
@@ -765,7 +798,7 @@ void RedisCluster::zrevrangebyscore(const StringView &key,
                                 const Interval &interval,
                                 const LimitOptions &opts,
                                 Output output) {
-    auto reply = _score_command<Output>(cmd::zrevrangebyscore<Interval>, key, interval, opts);
+    auto reply = _read_score_command<Output>(cmd::zrevrangebyscore<Interval>, key, interval, opts);
 
     reply::to_array(*reply, output);
 }
@@ -776,7 +809,7 @@ long long RedisCluster::zscan(const StringView &key,
                         const StringView &pattern,
                         long long count,
                         Output output) {
-    auto reply = command(cmd::zscan, key, cursor, pattern, count);
+    auto reply = _read_command(cmd::zscan, key, cursor, pattern, count);
 
     return reply::parse_scan_reply(*reply, output);
 }
@@ -880,7 +913,7 @@ void RedisCluster::geohash(const StringView &key, Input first, Input last, Outpu
         throw Error("GEOHASH: no key specified");
     }
 
-    auto reply = command(cmd::geohash_range<Input>, key, first, last);
+    auto reply = _read_command(cmd::geohash_range<Input>, key, first, last);
 
     reply::to_array(*reply, output);
 }
@@ -891,7 +924,7 @@ void RedisCluster::geopos(const StringView &key, Input first, Input last, Output
         throw Error("GEOPOS: no key specified");
     }
 
-    auto reply = command(cmd::geopos_range<Input>, key, first, last);
+    auto reply = _read_command(cmd::geopos_range<Input>, key, first, last);
 
     reply::to_array(*reply, output);
 }
@@ -1106,7 +1139,7 @@ void RedisCluster::xrange(const StringView &key,
                             const StringView &start,
                             const StringView &end,
                             Output output) {
-    auto reply = command(cmd::xrange, key, start, end);
+    auto reply = _read_command(cmd::xrange, key, start, end);
 
     reply::to_array(*reply, output);
 }
@@ -1117,7 +1150,7 @@ void RedisCluster::xrange(const StringView &key,
                             const StringView &end,
                             long long count,
                             Output output) {
-    auto reply = command(cmd::xrange_count, key, start, end, count);
+    auto reply = _read_command(cmd::xrange_count, key, start, end, count);
 
     reply::to_array(*reply, output);
 }
@@ -1279,7 +1312,7 @@ void RedisCluster::xrevrange(const StringView &key,
                             const StringView &end,
                             const StringView &start,
                             Output output) {
-    auto reply = command(cmd::xrevrange, key, end, start);
+    auto reply = _read_command(cmd::xrevrange, key, end, start);
 
     reply::to_array(*reply, output);
 }
@@ -1290,7 +1323,7 @@ void RedisCluster::xrevrange(const StringView &key,
                                 const StringView &start,
                                 long long count,
                                 Output output) {
-    auto reply = command(cmd::xrevrange_count, key, end, start, count);
+    auto reply = _read_command(cmd::xrevrange_count, key, end, start, count);
 
     reply::to_array(*reply, output);
 }
@@ -1339,9 +1372,15 @@ template <typename Cmd, typename ...Args>
 ReplyUPtr RedisCluster::_command(Cmd cmd, Connection &connection, Args &&...args) {
     assert(!connection.broken());
 
+    CommandTimer timer(_metrics.get(), _tracer.get(), connection);
+
     cmd(connection, std::forward<Args>(args)...);
 
-    return connection.recv();
+    auto reply = connection.recv();
+
+    timer.done(reply.get());
+
+    return reply;
 }
 
 template <typename Cmd, typename ...Args>
@@ -1365,8 +1404,13 @@ ReplyUPtr RedisCluster::_command(Cmd cmd, const StringView &key, Args &&...args)
             // 2. If it's NOT exist, update slot mapping, and retry.
             // 3. If it's still exist, that means the node is down, NOT removed, throw exception.
         } catch (const MovedError &err) {
-            // Slot mapping has been changed, update it and try again.
-            _pool.update();
+            // Slot has been moved. Only patch the slot, and try again. If it's moved again,
+            // e.g. the node is NOT the owner yet, the whole mapping will be updated.
+            if (idx == 0) {
+                _pool.update(err.slot(), err.node());
+            } else {
+                _pool.update();
+            }
         } catch (const AskError &err) {
             auto guarded_connection = _pool.fetch(err.node());
             auto &connection = guarded_connection.connection();
@@ -1391,6 +1435,199 @@ ReplyUPtr RedisCluster::_command(Cmd cmd, const StringView &key, Args &&...args)
     throw Error("Failed to send command with key: " + std::string(key.data(), key.size()));
 }
 
+template <typename Cmd, typename ...Args>
+ReplyUPtr RedisCluster::_read_command(Cmd cmd, const StringView &key, Args &&...args) {
+    if (_pool.read_preference() != ReadPreference::MASTER) {
+        auto replica_failed = false;
+        try {
+            auto guarded_connection = _pool.fetch_read(key);
+
+            return _command(cmd, guarded_connection.connection(), key, args...);
+        } catch (const RedirectionError &) {
+            // The replica doesn't serve the slot any more,
+            // and the master's MOVED reply triggers the update.
+        } catch (const IoError &) {
+            // The replica might be down, or it has been removed.
+            replica_failed = true;
+        } catch (const ClosedError &) {
+            replica_failed = true;
+        }
+
+        if (replica_failed) {
+            try {
+                _pool.update();
+            } catch (const Error &) {
+                // Fall back to master anyway, since the master might still work.
+            }
+        }
+
+        // Fall back to master.
+    }
+
+    return _command(cmd, key, key, std::forward<Args>(args)...);
+}
+
+template <typename Output, typename Cmd, typename ...Args>
+inline ReplyUPtr RedisCluster::_read_score_command(Cmd cmd,
+                                                    const StringView &key,
+                                                    Args &&...args) {
+    return _read_command(cmd, key, std::forward<Args>(args)..., IsKvPairIter<Output>::value);
+}
+
+template <typename T, typename Input>
+auto RedisCluster::_split_by_slot(Input first, Input last) -> std::vector<SlotBatch<T>> {
+    std::vector<SlotBatch<T>> batches;
+
+    // Slot -> index of the batch in *batches*.
+    std::unordered_map<Slot, std::size_t> slot_index;
+
+    for (std::size_t idx = 0; first != last; ++first, ++idx) {
+        T item(*first);
+
+        auto slot = _pool.slot(_batch_key(item));
+
+        auto iter = slot_index.find(slot);
+        if (iter == slot_index.end()) {
+            iter = slot_index.emplace(slot, batches.size()).first;
+            batches.emplace_back(slot);
+        }
+
+        auto &batch = batches[iter->second];
+        batch.items.push_back(item);
+        batch.indexes.push_back(idx);
+    }
+
+    return batches;
+}
+
+template <typename Cmd, typename T>
+void RedisCluster::_multi_slot_command(Cmd cmd, std::vector<SlotBatch<T>> &batches) {
+    std::vector<SlotBatch<T>*> pending;
+    pending.reserve(batches.size());
+    for (auto &batch : batches) {
+        pending.push_back(&batch);
+    }
+
+    for (auto idx = 0; idx < 2; ++idx) {
+        pending = _send_batches(cmd, pending);
+        if (pending.empty()) {
+            return;
+        }
+
+        // Some batches failed with MOVED error, or IoError. Either slot mapping has been
+        // changed, or master is down. Update the mapping, and only resend these batches.
+        _pool.update();
+    }
+
+    throw Error("Failed to send command to " + std::to_string(pending.size()) + " slots");
+}
+
+template <typename Cmd, typename T>
+auto RedisCluster::_send_batches(Cmd cmd, const std::vector<SlotBatch<T>*> &batches)
+    -> std::vector<SlotBatch<T>*> {
+    std::unordered_map<ConnectionPool*, std::vector<SlotBatch<T>*>> node_batches;
+    for (auto *batch : batches) {
+        node_batches[_pool.fetch_pool(batch->slot)].push_back(batch);
+    }
+
+    // Batches that need to be resent after updating slot mapping.
+    std::vector<SlotBatch<T>*> failed;
+
+    // 1. Pipeline batches of the same node with a single connection, and flush commands
+    //    to all nodes before receiving any reply, so that nodes can work in parallel.
+    std::vector<std::pair<GuardedConnection, std::vector<SlotBatch<T>*>>> sent;
+    sent.reserve(node_batches.size());
+    for (auto &node : node_batches) {
+        try {
+            GuardedConnection guarded_connection(*(node.first));
+
+            auto &connection = guarded_connection.connection();
+            for (auto *batch : node.second) {
+                cmd(connection, batch->items.begin(), batch->items.end());
+            }
+
+            connection.flush();
+
+            sent.emplace_back(std::move(guarded_connection), std::move(node.second));
+        } catch (const IoError &err) {
+            failed.insert(failed.end(), node.second.begin(), node.second.end());
+        } catch (const ClosedError &err) {
+            failed.insert(failed.end(), node.second.begin(), node.second.end());
+        }
+    }
+
+    // 2. Receive replies.
+    std::exception_ptr reply_err;
+    std::vector<std::pair<SlotBatch<T>*, Node>> ask_batches;
+    for (auto &node : sent) {
+        auto &connection = node.first.connection();
+        auto &sent_batches = node.second;
+        for (auto iter = sent_batches.begin(); iter != sent_batches.end(); ++iter) {
+            auto *batch = *iter;
+            try {
+                batch->reply = connection.recv();
+            } catch (const MovedError &err) {
+                failed.push_back(batch);
+            } catch (const AskError &err) {
+                ask_batches.emplace_back(batch, err.node());
+            } catch (const IoError &err) {
+                // Replies of the remaining batches are lost.
+                failed.insert(failed.end(), iter, sent_batches.end());
+                break;
+            } catch (const ClosedError &err) {
+                failed.insert(failed.end(), iter, sent_batches.end());
+                break;
+            } catch (const Error &err) {
+                // Keep receiving the remaining replies, so that the connection
+                // can be reused, and throw the first error after that.
+                if (!reply_err) {
+                    reply_err = std::current_exception();
+                }
+            }
+        }
+    }
+
+    if (reply_err) {
+        std::rethrow_exception(reply_err);
+    }
+
+    // 3. Resend batches of migrating slots to the importing nodes.
+    for (auto &ask : ask_batches) {
+        auto *batch = ask.first;
+        auto guarded_connection = _pool.fetch(ask.second);
+        auto &connection = guarded_connection.connection();
+
+        _asking(connection);
+
+        try {
+            batch->reply = _command(cmd,
+                                    connection,
+                                    batch->items.begin(),
+                                    batch->items.end());
+        } catch (const MovedError &err) {
+            throw Error("Slot migrating... ASKING node hasn't been set to IMPORTING state");
+        }
+    }
+
+    return failed;
+}
+
+template <typename Cmd, typename Input>
+long long RedisCluster::_multi_slot_count(Cmd cmd, Input first, Input last) {
+    auto batches = _split_by_slot<StringView>(first, last);
+
+    _multi_slot_command(cmd, batches);
+
+    long long num = 0;
+    for (const auto &batch : batches) {
+        assert(batch.reply);
+
+        num += reply::parse<long long>(*(batch.reply));
+    }
+
+    return num;
+}
+
 template <typename Cmd, typename ...Args>
 inline ReplyUPtr RedisCluster::_score_command(std::true_type, Cmd cmd, Args &&... args) {
     return command(cmd, std::forward<Args>(args)..., true);
@@ -50,6 +50,18 @@ std::string parse(ParseTag<std::string>, redisReply &reply) {
     return std::string(reply.str, reply.len);
 }
 
+StringView parse(ParseTag<StringView>, redisReply &reply) {
+    if (!reply::is_string(reply) && !reply::is_status(reply)) {
+        throw ProtoError("Expect STRING reply");
+    }
+
+    if (reply.str == nullptr) {
+        throw ProtoError("A null string reply");
+    }
+
+    return StringView(reply.str, reply.len);
+}
+
 long long parse(ParseTag<long long>, redisReply &reply) {
     if (!reply::is_integer(reply)) {
         throw ProtoError("Expect INTEGER reply");
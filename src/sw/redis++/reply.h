@@ -40,6 +40,55 @@ struct ReplyDeleter {
 
 using ReplyUPtr = std::unique_ptr<redisReply, ReplyDeleter>;
 
+// ReplyView owns the reply, and *T* is parsed from it without copying strings,
+// e.g. StringView, OptionalStringView, std::vector<StringView>. So views in *T*
+// are valid as long as the ReplyView object is alive, even if it's moved.
+template <typename T>
+class ReplyView {
+public:
+    explicit ReplyView(ReplyUPtr reply);
+
+    ReplyView(const ReplyView &) = delete;
+    ReplyView& operator=(const ReplyView &) = delete;
+
+    ReplyView(ReplyView &&) = default;
+    ReplyView& operator=(ReplyView &&) = default;
+
+    ~ReplyView() = default;
+
+    T& value() {
+        return _value;
+    }
+
+    const T& value() const {
+        return _value;
+    }
+
+    T* operator->() {
+        return &_value;
+    }
+
+    const T* operator->() const {
+        return &_value;
+    }
+
+    T& operator*() {
+        return _value;
+    }
+
+    const T& operator*() const {
+        return _value;
+    }
+
+private:
+    static T _parse(const ReplyUPtr &reply);
+
+    // *_reply* MUST be declared before *_value*, since *_value* is parsed from it.
+    ReplyUPtr _reply;
+
+    T _value;
+};
+
 namespace reply {
 
 template <typename T>
@@ -54,6 +103,10 @@ void parse(ParseTag<void>, redisReply &reply);
 
 std::string parse(ParseTag<std::string>, redisReply &reply);
 
+// The returned StringView borrows the buffer of *reply*, so it's only valid
+// until *reply* is freed.
+StringView parse(ParseTag<StringView>, redisReply &reply);
+
 long long parse(ParseTag<long long>, redisReply &reply);
 
 double parse(ParseTag<double>, redisReply &reply);
@@ -117,10 +170,83 @@ template <typename Output>
 auto parse_xpending_reply(redisReply &reply, Output output)
     -> std::tuple<long long, OptionalString, OptionalString>;
 
+// Parse elements of an ARRAY reply one by one, and write them to *output*.
+// It works with Connection::recv(const ReplyElementCallback &). If *Output*
+// is an iterator of std::pair, every two elements are written as a pair.
+template <typename Output, typename IsPair = typename IsKvPairIter<Output>::type>
+class ArrayStream;
+
+template <typename Output>
+class ArrayStream<Output, std::false_type> {
+public:
+    explicit ArrayStream(Output output) : _output(output) {}
+
+    void operator()(redisReply &element) {
+        *_output = parse<typename IterType<Output>::type>(element);
+
+        ++_output;
+    }
+
+    // Called after all elements have been received.
+    void finish() {}
+
+private:
+    Output _output;
+};
+
+template <typename Output>
+class ArrayStream<Output, std::true_type> {
+public:
+    explicit ArrayStream(Output output) : _output(output) {}
+
+    void operator()(redisReply &element) {
+        if (!_has_first) {
+            _first = parse<FirstType>(element);
+            _has_first = true;
+        } else {
+            *_output = std::make_pair(std::move(_first), parse<SecondType>(element));
+            ++_output;
+
+            _has_first = false;
+        }
+    }
+
+    void finish() {
+        if (_has_first) {
+            throw ProtoError("Not string pair array reply");
+        }
+    }
+
+private:
+    using Pair = typename IterType<Output>::type;
+    using FirstType = typename std::decay<typename Pair::first_type>::type;
+    using SecondType = typename std::decay<typename Pair::second_type>::type;
+
+    Output _output;
+
+    FirstType _first{};
+
+    bool _has_first = false;
+};
+
 }
 
 // Inline implementations.
 
+template <typename T>
+ReplyView<T>::ReplyView(ReplyUPtr reply) :
+                            _reply(std::move(reply)),
+                            _value(_parse(_reply)) {}
+
+template <typename T>
+T ReplyView<T>::_parse(const ReplyUPtr &reply) {
+    if (!reply) {
+        throw Error("Null reply");
+    }
+
+    return reply::parse<T>(*reply);
+}
+
 namespace reply {
 
 namespace detail {
@@ -308,7 +434,7 @@ long long parse_scan_reply(redisReply &reply, Output output) {
     }
 
     auto cursor_str = reply::parse<std::string>(*cursor_reply);
-    auto new_cursor = 0;
+    long long new_cursor = 0;
     try {
         new_cursor = std::stoll(cursor_str);
     } catch (const std::exception &e) {
@@ -36,6 +36,10 @@ inline bool operator<(const SlotRange &lhs, const SlotRange &rhs) {
     return lhs.max < rhs.max;
 }
 
+inline bool operator==(const SlotRange &lhs, const SlotRange &rhs) {
+    return lhs.min == rhs.min && lhs.max == rhs.max;
+}
+
 struct Node {
     std::string host;
     int port;
@@ -15,8 +15,12 @@
  *************************************************************************/
 
 #include "shards_pool.h"
+#include <cstring>
 #include <unordered_set>
+#include <algorithm>
+#include <limits>
 #include "errors.h"
+#include "command.h"
 
 namespace sw {
 
@@ -25,38 +29,82 @@ namespace redis {
 const std::size_t ShardsPool::SHARDS;
 
 ShardsPool::ShardsPool(const ConnectionPoolOptions &pool_opts,
-                        const ConnectionOptions &connection_opts) :
+                        const ConnectionOptions &connection_opts,
+                        const ClusterOptions &cluster_opts) :
                             _pool_opts(pool_opts),
-                            _connection_opts(connection_opts) {
+                            _connection_opts(connection_opts),
+                            _cluster_opts(cluster_opts) {
     if (_connection_opts.type != ConnectionType::TCP) {
         throw Error("Only support TCP connection for Redis Cluster");
     }
 
-    Connection connection(_connection_opts);
+    if (_cluster_opts.read_preference != ReadPreference::MASTER) {
+        // A node might be a replica now, and be promoted to master later, or vice versa.
+        // So all connections are in READONLY mode, which has no effect on master.
+        _connection_opts.readonly = true;
+    }
+
+    _slot_table.reset(new SlotTable);
+    for (std::size_t slot = 0; slot <= SHARDS; ++slot) {
+        _slot_table->masters[slot].store(nullptr, std::memory_order_relaxed);
+        _slot_table->readers[slot].store(nullptr, std::memory_order_relaxed);
+    }
+
+    Replicas replicas;
+    Shards shards;
+    {
+        Connection connection(_connection_opts);
 
-    _shards = _cluster_slots(connection);
+        shards = _cluster_slots(connection, replicas);
+    }
+
+    _refresh(std::move(shards), std::move(replicas));
+
+    // Measure it once here, and later, only the watcher measures it, since it PINGs
+    // every node, and should NOT be done on the request path.
+    if (_cluster_opts.read_preference == ReadPreference::LOWEST_LATENCY) {
+        _measure_latency();
+    }
 
-    _init_pool(_shards);
+    _start_watcher();
 }
 
 ShardsPool::ShardsPool(ShardsPool &&that) {
-    std::lock_guard<std::mutex> lock(that._mutex);
+    // The watcher thread refers to *that*, so stop it, and start a new one for this object.
+    that._stop_watcher();
 
-    _move(std::move(that));
+    {
+        std::lock_guard<std::mutex> lock(that._mutex);
+
+        _move(std::move(that));
+    }
+
+    _start_watcher();
 }
 
 ShardsPool& ShardsPool::operator=(ShardsPool &&that) {
     if (this != &that) {
-        std::lock(_mutex, that._mutex);
-        std::lock_guard<std::mutex> lock_this(_mutex, std::adopt_lock);
-        std::lock_guard<std::mutex> lock_that(that._mutex, std::adopt_lock);
+        _stop_watcher();
+        that._stop_watcher();
 
-        _move(std::move(that));
+        {
+            std::lock(_mutex, that._mutex);
+            std::lock_guard<std::mutex> lock_this(_mutex, std::adopt_lock);
+            std::lock_guard<std::mutex> lock_that(that._mutex, std::adopt_lock);
+
+            _move(std::move(that));
+        }
+
+        _start_watcher();
     }
 
     return *this;
 }
 
+ShardsPool::~ShardsPool() {
+    _stop_watcher();
+}
+
 GuardedConnection ShardsPool::fetch(const StringView &key) {
     auto slot = _slot(key);
 
@@ -81,55 +129,169 @@ GuardedConnection ShardsPool::fetch(const Node &node) {
 
     assert(iter != _pools.end());
 
-    return GuardedConnection(iter->second);
+    return GuardedConnection(*(iter->second));
 }
 
-void ShardsPool::update() {
-    // My might send command to a removed node.
-    // Try at most 3 times.
-    for (auto idx = 0; idx < 3; ++idx) {
-        try {
-            // Randomly pick a connection.
-            auto guarded_connection = fetch();
-            auto shards = _cluster_slots(guarded_connection.connection());
+GuardedConnection ShardsPool::fetch_read(const StringView &key) {
+    auto slot = _slot(key);
 
-            std::unordered_set<Node, NodeHash> nodes;
-            for (const auto &shard : shards) {
-                nodes.insert(shard.second);
-            }
+    if (_cluster_opts.read_preference == ReadPreference::MASTER) {
+        return GuardedConnection(_get_pool(slot));
+    }
 
-            std::lock_guard<std::mutex> lock(_mutex);
+    if (!_slot_table) {
+        throw Error("Slot table is NOT initialized");
+    }
 
-            // TODO: If shards is unchanged, no need to update, and return immediately.
+    const auto *readers = _slot_table->readers[slot].load(std::memory_order_acquire);
+    if (readers == nullptr) {
+        throw Error("Slot is NOT covered: " + std::to_string(slot));
+    }
 
-            _shards = std::move(shards);
+    const auto &pools = *readers;
 
-            // Remove non-existent nodes.
-            for (auto iter = _pools.begin(); iter != _pools.end(); ) {
-                if (nodes.find(iter->first) == nodes.end()) {
-                    // Node has been removed.
-                    _pools.erase(iter++);
-                } else {
-                    ++iter;
-                }
-            }
+    assert(!pools.empty());
 
-            // Add connection pool for new nodes.
-            // In fact, connections will be created lazily.
-            for (const auto &node : nodes) {
-                if (_pools.find(node) == _pools.end()) {
-                    _add_node(node);
-                }
-            }
+    std::size_t idx = 0;
+    if (pools.size() > 1) {
+        // Round-robin per thread, so that threads don't share a counter.
+        thread_local std::size_t read_idx = 0;
+        idx = read_idx++ % pools.size();
+    }
 
-            // Update successfully.
-            return;
-        } catch (const Error &) {
-            // continue;
+    return GuardedConnection(*pools[idx]);
+}
+
+ConnectionPool* ShardsPool::fetch_pool(Slot slot) {
+    return &_get_pool(slot);
+}
+
+ConnectionSPtr ShardsPool::borrow(const StringView &key) {
+    auto pool = _shared_pool(fetch_pool(_slot(key)));
+
+    return ConnectionSPtr(new Connection(pool->borrow()), [pool](Connection *connection) {
+                std::unique_ptr<Connection> guard(connection);
+                pool->reclaim(std::move(*connection));
+            });
+}
+
+ConnectionPoolStats ShardsPool::stats() {
+    std::vector<ConnectionPoolSPtr> pools;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        pools.reserve(_pools.size());
+        for (const auto &node : _pools) {
+            pools.push_back(node.second);
         }
     }
 
-    throw Error("Failed to update shards info");
+    ConnectionPoolStats stats;
+    for (const auto &pool : pools) {
+        auto node_stats = pool->stats();
+        stats.created += node_stats.created;
+        stats.reused += node_stats.reused;
+        stats.reconnects += node_stats.reconnects;
+        stats.create_failures += node_stats.create_failures;
+        stats.idle += node_stats.idle;
+        stats.in_use += node_stats.in_use;
+        stats.wait_time.merge(node_stats.wait_time);
+    }
+
+    return stats;
+}
+
+std::vector<ConnectionPoolSPtr> ShardsPool::masters() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<ConnectionPoolSPtr> pools;
+    for (const auto &shard : _shards) {
+        auto iter = _pools.find(shard.second);
+        if (iter == _pools.end()) {
+            // Never goes here, since we always add a pool for each node in *_shards*.
+            throw Error("No connection pool for master: "
+                    + shard.second.host + ":" + std::to_string(shard.second.port));
+        }
+
+        // A master might serve several slot ranges.
+        if (std::find(pools.begin(), pools.end(), iter->second) == pools.end()) {
+            pools.push_back(iter->second);
+        }
+    }
+
+    return pools;
+}
+
+void ShardsPool::update() {
+    std::unique_lock<std::mutex> lock(_update_mutex);
+
+    if (_updating) {
+        // Another thread is refreshing the slot mapping, and we share its result.
+        auto generation = _generation;
+        _update_cv.wait(lock, [this, generation]() { return this->_generation != generation; });
+
+        if (_update_err) {
+            std::rethrow_exception(_update_err);
+        }
+
+        return;
+    }
+
+    _updating = true;
+
+    lock.unlock();
+
+    std::exception_ptr err;
+    try {
+        _update();
+    } catch (...) {
+        err = std::current_exception();
+    }
+
+    lock.lock();
+
+    _updating = false;
+    ++_generation;
+    _update_err = err;
+
+    lock.unlock();
+
+    _update_cv.notify_all();
+
+    if (err) {
+        std::rethrow_exception(err);
+    }
+}
+
+void ShardsPool::update(Slot slot, const Node &node) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!_slot_table || slot > SHARDS) {
+        return;
+    }
+
+    auto iter = _pools.find(node);
+    if (iter == _pools.end()) {
+        // The node might be newly added, and if it's not in the mapping,
+        // the pool will be retired by the next refresh.
+        iter = _add_node(node);
+    }
+
+    auto *pool = iter->second.get();
+    if (_slot_table->masters[slot].load(std::memory_order_relaxed) == pool) {
+        // Already patched by others.
+        return;
+    }
+
+    // Patch the entry in place. Readers loading the old entry can still use the old pool.
+    _slot_table->masters[slot].store(pool, std::memory_order_release);
+
+    if (_cluster_opts.read_preference != ReadPreference::MASTER) {
+        // Read from the new master until the next refresh.
+        _slot_table->readers[slot].store(_intern(ReadPools(1, pool)), std::memory_order_release);
+    }
+
+    _patched = true;
 }
 
 ConnectionOptions ShardsPool::connection_options(const StringView &key) {
@@ -143,25 +305,54 @@ ConnectionOptions ShardsPool::connection_options() {
 
     return _connection_options(slot);
 }
+
+void ShardsPool::_update() {
+    // My might send command to a removed node.
+    // Try at most 3 times.
+    for (auto idx = 0; idx < 3; ++idx) {
+        try {
+            Replicas replicas;
+            Shards shards;
+            {
+                // Randomly pick a connection, and return it to the pool before refreshing,
+                // since measuring latency might fetch a connection from the same pool.
+                auto guarded_connection = fetch();
+                shards = _cluster_slots(guarded_connection.connection(), replicas);
+            }
+
+            _refresh(std::move(shards), std::move(replicas));
+
+            // Update successfully.
+            return;
+        } catch (const Error &) {
+            // continue;
+        }
+    }
+
+    throw Error("Failed to update shards info");
+}
+
 void ShardsPool::_move(ShardsPool &&that) {
     _pool_opts = that._pool_opts;
     _connection_opts = that._connection_opts;
+    _cluster_opts = that._cluster_opts;
     _shards = std::move(that._shards);
+    _replicas = std::move(that._replicas);
     _pools = std::move(that._pools);
+    _latencies = std::move(that._latencies);
+    _slot_table = std::move(that._slot_table);
+    _retired_pools = std::move(that._retired_pools);
+    _all_read_pools = std::move(that._all_read_pools);
+    _patched = that._patched;
+    _cold_pools = std::move(that._cold_pools);
 }
 
-void ShardsPool::_init_pool(const Shards &shards) {
-    for (const auto &shard : shards) {
-        _add_node(shard.second);
-    }
-}
-
-Shards ShardsPool::_cluster_slots(Connection &connection) const {
+Shards ShardsPool::_cluster_slots(Connection &connection, Replicas &replicas) const {
     auto reply = _cluster_slots_command(connection);
 
     assert(reply);
 
-    return _parse_reply(*reply);
+    return _parse_reply(*reply, replicas);
 }
 
 ReplyUPtr ShardsPool::_cluster_slots_command(Connection &connection) const {
@@ -170,7 +361,7 @@ ReplyUPtr ShardsPool::_cluster_slots_command(Connection &connection) const {
     return connection.recv();
 }
 
-Shards ShardsPool::_parse_reply(redisReply &reply) const {
+Shards ShardsPool::_parse_reply(redisReply &reply, Replicas &replicas) const {
     if (!reply::is_array(reply)) {
         throw ProtoError("Expect ARRAY reply");
     }
@@ -186,13 +377,20 @@ Shards ShardsPool::_parse_reply(redisReply &reply) const {
             throw ProtoError("Null slot info");
         }
 
-        shards.emplace(_parse_slot_info(*sub_reply));
+        std::vector<Node> nodes;
+        auto info = _parse_slot_info(*sub_reply, nodes);
+        if (!nodes.empty()) {
+            replicas.emplace(info.first, std::move(nodes));
+        }
+
+        shards.emplace(std::move(info));
     }
 
     return shards;
 }
 
-std::pair<SlotRange, Node> ShardsPool::_parse_slot_info(redisReply &reply) const {
+std::pair<SlotRange, Node> ShardsPool::_parse_slot_info(redisReply &reply,
+                                                        std::vector<Node> &replicas) const {
     if (reply.elements < 3 || reply.element == nullptr) {
         throw ProtoError("Invalid slot info");
     }
@@ -211,55 +409,60 @@ std::pair<SlotRange, Node> ShardsPool::_parse_slot_info(redisReply &reply) const
     }
     std::size_t max_slot = reply::parse<long long>(*max_slot_reply);
 
-    if (min_slot > max_slot) {
+    if (min_slot > max_slot || max_slot > SHARDS) {
         throw ProtoError("Invalid slot range");
     }
 
     // Master node info
-    auto *node_reply = reply.element[2];
-    if (node_reply == nullptr
-            || !reply::is_array(*node_reply)
-            || node_reply->element == nullptr
-            || node_reply->elements < 2) {
-        throw ProtoError("Invalid node info");
+    auto master = _parse_node(reply.element[2]);
+
+    // Replicas' info. By now, we ignore node id.
+    for (std::size_t idx = 3; idx < reply.elements; ++idx) {
+        replicas.push_back(_parse_node(reply.element[idx]));
     }
 
-    auto master_host = reply::parse<std::string>(*(node_reply->element[0]));
-    int master_port = reply::parse<long long>(*(node_reply->element[1]));
+    return {SlotRange{min_slot, max_slot}, std::move(master)};
+}
+
+Node ShardsPool::_parse_node(redisReply *reply) const {
+    if (reply == nullptr
+            || !reply::is_array(*reply)
+            || reply->element == nullptr
+            || reply->elements < 2
+            || reply->element[0] == nullptr
+            || reply->element[1] == nullptr) {
+        throw ProtoError("Invalid node info");
+    }
 
-    // By now, we ignore node id and other replicas' info.
+    auto host = reply::parse<std::string>(*(reply->element[0]));
+    int port = reply::parse<long long>(*(reply->element[1]));
 
-    return {SlotRange{min_slot, max_slot}, Node{master_host, master_port}};
+    return {host, port};
 }
 
 Slot ShardsPool::_slot(const StringView &key) const {
     // The following code is copied from: https://redis.io/topics/cluster-spec
-    // And I did some minor changes.
+    // And I did some minor changes, e.g. search { and } with memchr, which is vectorized
+    // by the C library.
 
     const auto *k = key.data();
     auto keylen = key.size();
 
-    // start-end indexes of { and }.
-    std::size_t s = 0;
-    std::size_t e = 0;
-
     // Search the first occurrence of '{'.
-    for (s = 0; s < keylen; s++)
-        if (k[s] == '{') break;
+    const auto *s = static_cast<const char *>(std::memchr(k, '{', keylen));
 
     // No '{' ? Hash the whole key. This is the base case.
-    if (s == keylen) return crc16(k, keylen) & SHARDS;
+    if (s == nullptr) return crc16(k, keylen) & SHARDS;
 
     // '{' found? Check if we have the corresponding '}'.
-    for (e = s + 1; e < keylen; e++)
-        if (k[e] == '}') break;
+    const auto *e = static_cast<const char *>(std::memchr(s + 1, '}', k + keylen - s - 1));
 
     // No '}' or nothing between {} ? Hash the whole key.
-    if (e == keylen || e == s + 1) return crc16(k, keylen) & SHARDS;
+    if (e == nullptr || e == s + 1) return crc16(k, keylen) & SHARDS;
 
     // If we are here there is both a { and a } on its right. Hash
     // what is in the middle between { and }.
-    return crc16(k + s + 1, e - s - 1) & SHARDS;
+    return crc16(s + 1, e - s - 1) & SHARDS;
 }
 
 Slot ShardsPool::_slot() const {
@@ -270,48 +473,357 @@ Slot ShardsPool::_slot() const {
     return uniform_dist(engine);
 }
 
-ConnectionPoolSPtr& ShardsPool::_get_pool(Slot slot) {
-    auto shards_iter = _shards.lower_bound(SlotRange{slot, slot});
-    if (shards_iter == _shards.end() || slot < shards_iter->first.min) {
-        throw Error("Slot is out of range: " + std::to_string(slot));
+void ShardsPool::_update_slot_table() {
+    assert(_slot_table);
+
+    std::vector<ConnectionPool*> masters(SHARDS + 1, nullptr);
+    std::vector<const ReadPools*> readers(SHARDS + 1, nullptr);
+
+    auto read_from_replica = (_cluster_opts.read_preference != ReadPreference::MASTER);
+
+    for (const auto &shard : _shards) {
+        auto iter = _pools.find(shard.second);
+        if (iter == _pools.end()) {
+            // Never goes here, since we always add a pool for each node in *_shards*.
+            throw Error("Slot range is NOT covered: "
+                    + std::to_string(shard.first.min) + "-" + std::to_string(shard.first.max));
+        }
+
+        auto *master = iter->second.get();
+
+        const ReadPools *shard_readers = nullptr;
+        if (read_from_replica) {
+            shard_readers = _read_pools(shard.first, master);
+        }
+
+        for (auto slot = shard.first.min; slot <= shard.first.max; ++slot) {
+            masters[slot] = master;
+            readers[slot] = shard_readers;
+        }
     }
 
-    const auto &node = shards_iter->second;
+    // Entries are replaced one by one, and each of them is valid during the update.
+    for (std::size_t slot = 0; slot <= SHARDS; ++slot) {
+        _slot_table->masters[slot].store(masters[slot], std::memory_order_release);
+        _slot_table->readers[slot].store(readers[slot], std::memory_order_release);
+    }
+}
 
-    auto node_iter = _pools.find(node);
-    if (node_iter == _pools.end()) {
+ConnectionPool& ShardsPool::_get_pool(Slot slot) const {
+    if (!_slot_table) {
+        throw Error("Slot table is NOT initialized");
+    }
+
+    if (slot > SHARDS) {
+        throw Error("Slot is out of range: " + std::to_string(slot));
+    }
+
+    auto *pool = _slot_table->masters[slot].load(std::memory_order_acquire);
+    if (pool == nullptr) {
         throw Error("Slot is NOT covered: " + std::to_string(slot));
     }
 
-    return node_iter->second;
+    return *pool;
 }
 
 GuardedConnection ShardsPool::_fetch(Slot slot) {
-    std::lock_guard<std::mutex> lock(_mutex);
+    return GuardedConnection(_get_pool(slot));
+}
+
+ConnectionOptions ShardsPool::_connection_options(Slot slot) {
+    return _get_pool(slot).connection_options();
+}
+
+auto ShardsPool::_add_node(const Node &node) -> NodeMap::iterator {
+    auto retired = _retired_pools.find(node);
+    if (retired != _retired_pools.end()) {
+        // The node is added back, and reuse its pool.
+        auto iter = _pools.emplace(node, std::move(retired->second)).first;
+        _retired_pools.erase(retired);
+
+        iter->second->resume();
+
+        return iter;
+    }
 
-    auto &pool = _get_pool(slot);
+    auto opts = _connection_opts;
+    opts.host = node.host;
+    opts.port = node.port;
 
-    assert(pool);
+    // Pools are created with lock held, so DO NOT create connections in the constructor.
+    // Instead, they're warmed up by *_warm_up* without lock.
+    auto pool_opts = _pool_opts;
+    pool_opts.min_idle = 0;
 
-    return GuardedConnection(pool);
+    return _pools.emplace(node, std::make_shared<ConnectionPool>(pool_opts, opts)).first;
 }
 
-ConnectionOptions ShardsPool::_connection_options(Slot slot) {
+void ShardsPool::_sync_pools(const Shards &shards, const Replicas &replicas) {
+    std::unordered_set<Node, NodeHash> nodes;
+    for (const auto &shard : shards) {
+        nodes.insert(shard.second);
+    }
+
+    if (_cluster_opts.read_preference != ReadPreference::MASTER) {
+        for (const auto &replica : replicas) {
+            nodes.insert(replica.second.begin(), replica.second.end());
+        }
+    }
+
+    // Remove non-existent nodes.
+    for (auto iter = _pools.begin(); iter != _pools.end(); ) {
+        if (nodes.find(iter->first) == nodes.end()) {
+            // Node has been removed. Retire its pool, since the routing table
+            // might still refer to it. However, close its connections, and stop
+            // its health check, since the node might be gone.
+            _latencies.erase(iter->first);
+            iter->second->suspend();
+            _retired_pools[iter->first] = std::move(iter->second);
+            _pools.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+
+    // Add connection pool for new nodes.
+    // In fact, connections will be created lazily, or by the watcher thread.
+    for (const auto &node : nodes) {
+        if (_pools.find(node) == _pools.end()) {
+            auto iter = _add_node(node);
+
+            if (_pool_opts.min_idle > 0
+                    || _cluster_opts.refresh_interval > std::chrono::milliseconds(0)) {
+                _cold_pools.push_back(iter->second);
+            }
+        }
+    }
+}
+
+auto ShardsPool::_read_pools(const SlotRange &range, ConnectionPool *master)
+    -> const ReadPools* {
+    std::vector<std::pair<Node, ConnectionPool*>> replicas;
+    auto replica_iter = _replicas.find(range);
+    if (replica_iter != _replicas.end()) {
+        for (const auto &node : replica_iter->second) {
+            auto iter = _pools.find(node);
+            if (iter != _pools.end()) {
+                replicas.emplace_back(node, iter->second.get());
+            }
+        }
+    }
+
+    ReadPools pools;
+
+    switch (_cluster_opts.read_preference) {
+    case ReadPreference::PREFER_REPLICA:
+        for (const auto &replica : replicas) {
+            pools.push_back(replica.second);
+        }
+
+        if (pools.empty()) {
+            pools.push_back(master);
+        }
+
+        break;
+
+    case ReadPreference::ROUND_ROBIN:
+        pools.push_back(master);
+
+        for (const auto &replica : replicas) {
+            pools.push_back(replica.second);
+        }
+
+        break;
+
+    case ReadPreference::LOWEST_LATENCY: {
+        // If latencies have NOT been measured, or all nodes are unreachable, read from master.
+        auto best = master;
+        auto best_latency = std::chrono::microseconds::max();
+
+        const auto &opts = master->connection_options();
+        auto iter = _latencies.find(Node{opts.host, opts.port});
+        if (iter != _latencies.end()) {
+            best_latency = iter->second;
+        }
+
+        for (const auto &replica : replicas) {
+            iter = _latencies.find(replica.first);
+            if (iter != _latencies.end() && iter->second < best_latency) {
+                best = replica.second;
+                best_latency = iter->second;
+            }
+        }
+
+        pools.push_back(best);
+
+        break;
+    }
+
+    default:
+        pools.push_back(master);
+
+        break;
+    }
+
+    return _intern(std::move(pools));
+}
+
+auto ShardsPool::_intern(ReadPools pools) -> const ReadPools* {
+    return &*(_all_read_pools.insert(std::move(pools)).first);
+}
+
+ConnectionPoolSPtr ShardsPool::_shared_pool(ConnectionPool *pool) {
+    const auto &opts = pool->connection_options();
+    auto node = Node{opts.host, opts.port};
+
     std::lock_guard<std::mutex> lock(_mutex);
 
-    auto &pool = _get_pool(slot);
+    for (const auto *pools : {&_pools, &_retired_pools}) {
+        auto iter = pools->find(node);
+        if (iter != pools->end() && iter->second.get() == pool) {
+            return iter->second;
+        }
+    }
+
+    // Never goes here, since pools are never removed.
+    throw Error("Unknown connection pool: " + opts.host + ":" + std::to_string(opts.port));
+}
+
+void ShardsPool::_measure_latency() {
+    std::vector<std::pair<Node, ConnectionPoolSPtr>> pools;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        pools.assign(_pools.begin(), _pools.end());
+    }
+
+    // Measure without lock, since it sends commands to every node.
+    std::unordered_map<Node, std::chrono::microseconds, NodeHash> latencies;
+    for (const auto &pool : pools) {
+        try {
+            GuardedConnection guarded_connection(*(pool.second));
+            auto &connection = guarded_connection.connection();
+
+            auto start = std::chrono::steady_clock::now();
+
+            cmd::ping(connection);
+            connection.recv();
+
+            latencies.emplace(pool.first,
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start));
+        } catch (const Error &) {
+            // Unreachable node is never picked.
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
 
-    assert(pool);
+    _latencies = std::move(latencies);
 
-    return pool->connection_options();
+    _update_slot_table();
 }
 
-auto ShardsPool::_add_node(const Node &node) -> NodeMap::iterator {
-    auto opts = _connection_opts;
-    opts.host = node.host;
-    opts.port = node.port;
+void ShardsPool::_refresh(Shards shards, Replicas replicas) {
+    auto changed = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // If slot mapping is unchanged, there's no need to rebuild it.
+        if (_patched || shards != _shards || replicas != _replicas) {
+            _shards = std::move(shards);
+            _replicas = std::move(replicas);
+
+            _sync_pools(_shards, _replicas);
+
+            _update_slot_table();
+
+            _patched = false;
+
+            changed = true;
+        }
+    }
+
+    if (changed && _pool_opts.min_idle > 0) {
+        _warm_up();
+    }
+}
+
+void ShardsPool::_start_watcher() {
+    if (_cluster_opts.refresh_interval <= std::chrono::milliseconds(0)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_watcher_mutex);
+
+        _watcher_stopped = false;
+    }
+
+    _watcher = std::thread([this]() { this->_watch(); });
+}
+
+void ShardsPool::_stop_watcher() {
+    {
+        std::lock_guard<std::mutex> lock(_watcher_mutex);
+
+        _watcher_stopped = true;
+    }
 
-    return _pools.emplace(node, std::make_shared<ConnectionPool>(_pool_opts, opts)).first;
+    _watcher_cv.notify_all();
+
+    if (_watcher.joinable()) {
+        _watcher.join();
+    }
+}
+
+void ShardsPool::_watch() {
+    std::default_random_engine engine(std::random_device{}());
+
+    auto interval = _cluster_opts.refresh_interval.count();
+    std::uniform_int_distribution<long long> uniform_dist(interval - interval / 10,
+                                                            interval + interval / 10);
+
+    std::unique_lock<std::mutex> lock(_watcher_mutex);
+
+    while (true) {
+        auto timeout = std::chrono::milliseconds(uniform_dist(engine));
+        if (_watcher_cv.wait_for(lock, timeout, [this]() { return this->_watcher_stopped; })) {
+            break;
+        }
+
+        lock.unlock();
+
+        try {
+            update();
+        } catch (const Error &) {
+            // Try again next time.
+        }
+
+        _warm_up();
+
+        // Latencies change even if slot mapping doesn't, so measure them every time.
+        if (_cluster_opts.read_preference == ReadPreference::LOWEST_LATENCY) {
+            _measure_latency();
+        }
+
+        lock.lock();
+    }
+}
+
+void ShardsPool::_warm_up() {
+    std::vector<ConnectionPoolSPtr> pools;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        pools.swap(_cold_pools);
+    }
+
+    // At least one connection for each new node.
+    auto num = std::max<std::size_t>(_pool_opts.min_idle, 1);
+    for (auto &pool : pools) {
+        pool->warm_up(num);
+    }
 }
 
 }
@@ -22,6 +22,15 @@
 #include <string>
 #include <random>
 #include <memory>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <exception>
 #include "reply.h"
 #include "connection_pool.h"
 #include "shards.h"
@@ -32,9 +41,40 @@ namespace redis {
 
 using ConnectionPoolSPtr = std::shared_ptr<ConnectionPool>;
 
+// Which nodes serve read-only commands.
+enum class ReadPreference {
+    // Always read from master.
+    MASTER = 0,
+
+    // Read from replicas in a round-robin way. If a shard has no replica, read from master.
+    PREFER_REPLICA,
+
+    // Read from master and replicas in a round-robin way.
+    ROUND_ROBIN,
+
+    // Read from the node, either master or replica, with the lowest latency.
+    // Latency is measured with PING when ShardsPool is created, and then by the background
+    // thread each time it refreshes the slot mapping, i.e. set
+    // *ClusterOptions::refresh_interval* to keep it up to date.
+    LOWEST_LATENCY
+};
+
+struct ClusterOptions {
+    ReadPreference read_preference = ReadPreference::MASTER;
+
+    // If larger than 0ms, a background thread refreshes the slot mapping periodically,
+    // instead of only updating it when some command fails with MOVED error or IoError.
+    // In order to avoid all clients polling the cluster at the same time, each interval
+    // is randomly picked from [refresh_interval * 0.9, refresh_interval * 1.1].
+    std::chrono::milliseconds refresh_interval{0};
+};
+
+// Fetch a connection from the pool, and return it when it goes out of scope.
+// It doesn't own the pool, so the pool should outlive it. Pools of ShardsPool
+// are never destroyed before ShardsPool.
 class GuardedConnection {
 public:
-    GuardedConnection(const ConnectionPoolSPtr &pool) : _pool(pool),
+    explicit GuardedConnection(ConnectionPool &pool) : _pool(&pool),
                                                         _connection(_pool->fetch()) {
         assert(!_connection.broken());
     }
@@ -42,11 +82,25 @@ public:
     GuardedConnection(const GuardedConnection &) = delete;
     GuardedConnection& operator=(const GuardedConnection &) = delete;
 
-    GuardedConnection(GuardedConnection &&) = default;
-    GuardedConnection& operator=(GuardedConnection &&) = default;
+    GuardedConnection(GuardedConnection &&that) noexcept :
+        _pool(that._pool), _connection(std::move(that._connection)) {
+        that._pool = nullptr;
+    }
+
+    GuardedConnection& operator=(GuardedConnection &&that) noexcept {
+        if (this != &that) {
+            _release();
+
+            _pool = that._pool;
+            _connection = std::move(that._connection);
+            that._pool = nullptr;
+        }
+
+        return *this;
+    }
 
     ~GuardedConnection() {
-        _pool->release(std::move(_connection));
+        _release();
     }
 
     Connection& connection() {
@@ -54,7 +108,14 @@ public:
     }
 
 private:
-    ConnectionPoolSPtr _pool;
+    void _release() {
+        // If the object has been moved, *_pool* is null.
+        if (_pool != nullptr) {
+            _pool->release(std::move(_connection));
+        }
+    }
+
+    ConnectionPool *_pool;
     Connection _connection;
 };
 
@@ -68,10 +129,11 @@ public:
     ShardsPool(ShardsPool &&that);
     ShardsPool& operator=(ShardsPool &&that);
 
-    ~ShardsPool() = default;
+    ~ShardsPool();
 
     ShardsPool(const ConnectionPoolOptions &pool_opts,
-                const ConnectionOptions &connection_opts);
+                const ConnectionOptions &connection_opts,
+                const ClusterOptions &cluster_opts = {});
 
     // Fetch a connection by key.
     GuardedConnection fetch(const StringView &key);
@@ -82,24 +144,76 @@ public:
     // Fetch a connection by node.
     GuardedConnection fetch(const Node &node);
 
+    // Fetch a connection for read-only command by key, according to the read preference.
+    GuardedConnection fetch_read(const StringView &key);
+
+    ReadPreference read_preference() const {
+        return _cluster_opts.read_preference;
+    }
+
+    // Get the connection pool of the node that serves the given slot.
+    // The pool is valid until ShardsPool is destroyed.
+    ConnectionPool* fetch_pool(Slot slot);
+
+    // Borrow a connection of the node that serves the slot of *key*, for Redis, Pipeline
+    // and Transaction objects created by RedisCluster. When the last copy of the returned
+    // pointer is destroyed, the connection is returned to the pool. See *ConnectionPool::borrow*.
+    ConnectionSPtr borrow(const StringView &key);
+
+    // Sum of statistics of all nodes' connection pools.
+    ConnectionPoolStats stats();
+
+    // Connection pools of all masters, i.e. one pool for each master, in the order of
+    // their first slot range. It's a snapshot of the current slot mapping.
+    std::vector<ConnectionPoolSPtr> masters();
+
+    // Get slot by key.
+    Slot slot(const StringView &key) const {
+        return _slot(key);
+    }
+
+    // Get slots of keys in range [first, last), and write them to *output*,
+    // e.g. for bulk operations with lots of keys.
+    template <typename Input, typename Output>
+    void slots(Input first, Input last, Output output) const {
+        for (; first != last; ++first) {
+            *output = _slot(*first);
+            ++output;
+        }
+    }
+
+    // Refresh the slot mapping with CLUSTER SLOTS. If another thread is refreshing it,
+    // wait for that refresh to finish, and share its result, i.e. at most one refresh
+    // is in flight. If the mapping is unchanged, routing and pools are kept intact.
     void update();
 
+    // Fast path for MOVED error, i.e. only move *slot* to *node*, without CLUSTER SLOTS.
+    // The whole mapping will be rebuilt by the next *update*.
+    void update(Slot slot, const Node &node);
+
     ConnectionOptions connection_options(const StringView &key);
 
     ConnectionOptions connection_options();
 
 private:
+    // Max slot.
+    static const std::size_t SHARDS = 16383;
+
     void _move(ShardsPool &&that);
 
-    void _init_pool(const Shards &shards);
+    // Replica nodes of each slot range.
+    using Replicas = std::map<SlotRange, std::vector<Node>>;
 
-    Shards _cluster_slots(Connection &connection) const;
+    Shards _cluster_slots(Connection &connection, Replicas &replicas) const;
 
     ReplyUPtr _cluster_slots_command(Connection &connection) const;
 
-    Shards _parse_reply(redisReply &reply) const;
+    Shards _parse_reply(redisReply &reply, Replicas &replicas) const;
 
-    std::pair<SlotRange, Node> _parse_slot_info(redisReply &reply) const;
+    std::pair<SlotRange, Node> _parse_slot_info(redisReply &reply,
+                                                std::vector<Node> &replicas) const;
+
+    Node _parse_node(redisReply *reply) const;
 
     // Get slot by key.
     std::size_t _slot(const StringView &key) const;
@@ -107,7 +221,27 @@ private:
     // Randomly pick a slot.
     std::size_t _slot() const;
 
-    ConnectionPoolSPtr& _get_pool(Slot slot);
+    // Pools that serve read-only commands of a shard. It's NOT empty.
+    using ReadPools = std::vector<ConnectionPool*>;
+
+    // Routing table indexed by slot, i.e. masters[slot] is the pool that serves the slot,
+    // and readers[slot] are pools that serve read-only commands of the slot. If the
+    // read preference is MASTER, *readers* are all null.
+    //
+    // Writers store entries in place with *_mutex* held, and readers only load them, so
+    // that fetching a connection by slot takes neither a lock nor a shared write. Pools
+    // and ReadPools that entries point to are never destroyed before ShardsPool, so a
+    // reader that loads an entry before it's replaced can still use it.
+    struct SlotTable {
+        std::atomic<ConnectionPool*> masters[SHARDS + 1];
+
+        std::atomic<const ReadPools*> readers[SHARDS + 1];
+    };
+
+    // NOT thread-safe, i.e. caller should lock *_mutex*.
+    void _update_slot_table();
+
+    ConnectionPool& _get_pool(Slot slot) const;
 
     GuardedConnection _fetch(Slot slot);
 
@@ -117,17 +251,98 @@ private:
 
     NodeMap::iterator _add_node(const Node &node);
 
+    // NOT thread-safe.
+    void _sync_pools(const Shards &shards, const Replicas &replicas);
+
+    // NOT thread-safe.
+    const ReadPools* _read_pools(const SlotRange &range, ConnectionPool *master);
+
+    // NOT thread-safe. ReadPools are interned, so that the number of them is bounded.
+    const ReadPools* _intern(ReadPools pools);
+
+    // Get the owner of *pool*.
+    ConnectionPoolSPtr _shared_pool(ConnectionPool *pool);
+
+    // Measure latency of all nodes for *LOWEST_LATENCY* read preference.
+    void _measure_latency();
+
+    // Send CLUSTER SLOTS, and refresh the slot mapping.
+    void _update();
+
+    void _refresh(Shards shards, Replicas replicas);
+
+    void _start_watcher();
+
+    void _stop_watcher();
+
+    // Loop of the background thread, which refreshes the slot mapping periodically,
+    // and warms up pools of newly added nodes.
+    void _watch();
+
+    // Create connections for pools in *_cold_pools*, i.e. at least *min_idle*
+    // connections, or one connection if it's 0.
+    void _warm_up();
+
     ConnectionPoolOptions _pool_opts;
 
     ConnectionOptions _connection_opts;
 
+    ClusterOptions _cluster_opts;
+
     Shards _shards;
 
+    Replicas _replicas;
+
     NodeMap _pools;
 
+    // Latency of each node measured by *_measure_latency*.
+    std::unordered_map<Node, std::chrono::microseconds, NodeHash> _latencies;
+
+    // Routing table built from *_shards* and *_pools*. It's null, if ShardsPool is default
+    // constructed or moved.
+    std::unique_ptr<SlotTable> _slot_table;
+
+    // Pools of removed nodes. They're kept, since the routing table or in-flight commands
+    // might still refer to them, and they're reused, i.e. resumed, if the nodes are added
+    // back. They're suspended, i.e. they hold neither connections nor threads, except those
+    // used by in-flight commands, which are closed once released. So each of them only takes
+    // a few KB.
+    NodeMap _retired_pools;
+
+    // Interned ReadPools referred by the routing table.
+    std::set<ReadPools> _all_read_pools;
+
+    // Pools of newly added nodes, which have NOT been warmed up. It's always empty,
+    // if neither *min_idle* nor the watcher is enabled.
+    std::vector<ConnectionPoolSPtr> _cold_pools;
+
+    // Whether *_slot_table* has been patched by MOVED errors since the last refresh,
+    // i.e. it's NOT consistent with *_shards*.
+    bool _patched = false;
+
     std::mutex _mutex;
 
-    static const std::size_t SHARDS = 16383;
+    // Single-flight state of *update*, which is protected by *_update_mutex*.
+    bool _updating = false;
+
+    // Number of finished refreshes, so that waiters know the refresh they wait for is done.
+    unsigned long long _generation = 0;
+
+    // Result of the last refresh.
+    std::exception_ptr _update_err;
+
+    std::mutex _update_mutex;
+
+    std::condition_variable _update_cv;
+
+    std::thread _watcher;
+
+    // Protected by *_watcher_mutex*.
+    bool _watcher_stopped = false;
+
+    std::mutex _watcher_mutex;
+
+    std::condition_variable _watcher_cv;
 };
 
 }
@@ -0,0 +1,65 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "tracer.h"
+#include <string>
+
+namespace {
+
+// Size of the "<type><num>\r\n" header.
+std::size_t header_size(long long num) {
+    return std::to_string(num).size() + 3;
+}
+
+}
+
+namespace sw {
+
+namespace redis {
+
+std::size_t resp_size(const redisReply &reply) {
+    switch (reply.type) {
+    case REDIS_REPLY_STRING:
+        // $<len>\r\n<data>\r\n
+        return header_size(static_cast<long long>(reply.len)) + reply.len + 2;
+
+    case REDIS_REPLY_INTEGER:
+        return header_size(reply.integer);
+
+    case REDIS_REPLY_NIL:
+        // $-1\r\n
+        return 5;
+
+    case REDIS_REPLY_ARRAY: {
+        auto size = header_size(static_cast<long long>(reply.elements));
+        for (std::size_t idx = 0; idx != reply.elements; ++idx) {
+            if (reply.element[idx] != nullptr) {
+                size += resp_size(*(reply.element[idx]));
+            }
+        }
+
+        return size;
+    }
+
+    default:
+        // Status and error replies, i.e. +<str>\r\n or -<str>\r\n.
+        return reply.len + 3;
+    }
+}
+
+}
+
+}
@@ -0,0 +1,82 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TRACER_H
+#define SEWENEW_REDISPLUSPLUS_TRACER_H
+
+#include <chrono>
+#include <memory>
+#include <hiredis/hiredis.h>
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+// A traced command, i.e. from sending the command to receiving the reply.
+struct TraceSpan {
+    // Command name, e.g. GET.
+    StringView command;
+
+    // The first argument of the command, which is the key for most commands.
+    // Empty, if the command has no argument.
+    StringView key;
+
+    // *host:port*, or path of the unix domain socket.
+    StringView node;
+
+    // Size of the RESP encoded command.
+    std::size_t bytes_sent;
+
+    // Size of the RESP encoded reply. 0, if the command failed, or the reply is streamed,
+    // e.g. *Redis::lrange*.
+    std::size_t bytes_received;
+
+    std::chrono::system_clock::time_point start;
+
+    std::chrono::system_clock::time_point end;
+
+    bool ok;
+};
+
+// Interface of tracing hooks. Set it with *Redis::set_tracer* or *RedisCluster::set_tracer*.
+// If no tracer is set, the only cost is a null pointer check for each command.
+class Tracer {
+public:
+    virtual ~Tracer() = default;
+
+    // Called, in the thread sending the command, before a command is sent.
+    // Returns false to skip tracing the command, e.g. only sample 1% of commands.
+    // Details, e.g. key and bytes sent, are only collected for sampled commands.
+    virtual bool sample() {
+        return true;
+    }
+
+    // Called, in the thread sending the command, after a sampled command is done.
+    // It should NOT throw.
+    virtual void trace(const TraceSpan &span) = 0;
+};
+
+using TracerSPtr = std::shared_ptr<Tracer>;
+
+// Size of the reply, if it's encoded with RESP.
+std::size_t resp_size(const redisReply &reply);
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TRACER_H
@@ -104,6 +104,8 @@ private:
 
 using OptionalString = Optional<std::string>;
 
+using OptionalStringView = Optional<StringView>;
+
 using OptionalLongLong = Optional<long long>;
 
 using OptionalDouble = Optional<double>;
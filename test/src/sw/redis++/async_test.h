@@ -0,0 +1,75 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_ASYNC_TEST_H
+#define SEWENEW_REDISPLUSPLUS_TEST_ASYNC_TEST_H
+
+#include <sw/redis++/redis++.h>
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+template <typename RedisInstance>
+struct AsyncInstance;
+
+template <>
+struct AsyncInstance<Redis> {
+    using type = AsyncRedis;
+};
+
+template <>
+struct AsyncInstance<RedisCluster> {
+    using type = AsyncRedisCluster;
+};
+
+template <typename RedisInstance>
+class AsyncTest {
+public:
+    AsyncTest(const ConnectionOptions &opts, RedisInstance &instance) :
+        _opts(opts), _redis(instance) {}
+
+    void run();
+
+private:
+    using AsyncRedisInstance = typename AsyncInstance<RedisInstance>::type;
+
+    void _test_string(AsyncRedisInstance &async_redis);
+
+    void _test_hash_list(AsyncRedisInstance &async_redis);
+
+    void _test_outstanding(AsyncRedisInstance &async_redis);
+
+    void _test_error(AsyncRedisInstance &async_redis);
+
+    void _test_event_loop();
+
+    ConnectionOptions _opts;
+
+    RedisInstance &_redis;
+};
+
+}
+
+}
+
+}
+
+#include "async_test.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_ASYNC_TEST_H
@@ -0,0 +1,168 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_ASYNC_TEST_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_ASYNC_TEST_HPP
+
+#include <vector>
+#include <string>
+#include <future>
+#include <stdexcept>
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+template <typename RedisInstance>
+void AsyncTest<RedisInstance>::run() {
+    AsyncRedisInstance async_redis(_opts);
+
+    _test_string(async_redis);
+
+    _test_hash_list(async_redis);
+
+    _test_outstanding(async_redis);
+
+    _test_error(async_redis);
+
+    _test_event_loop();
+}
+
+template <typename RedisInstance>
+void AsyncTest<RedisInstance>::_test_string(AsyncRedisInstance &async_redis) {
+    auto key = test_key("async-string");
+
+    KeyDeleter<RedisInstance> deleter(_redis, key);
+
+    auto val = async_redis.get(key).get();
+    REDIS_ASSERT(!val, "failed to test async get with nonexistent key");
+
+    REDIS_ASSERT(async_redis.set(key, "value").get(), "failed to test async set");
+
+    REDIS_ASSERT(!async_redis.set(key, "value", std::chrono::milliseconds(0),
+                UpdateType::NOT_EXIST).get(),
+            "failed to test async set with NX option");
+
+    val = async_redis.get(key).get();
+    REDIS_ASSERT(val && *val == "value", "failed to test async get");
+
+    auto sync_val = _redis.get(key);
+    REDIS_ASSERT(sync_val && *sync_val == "value", "failed to test async set");
+
+    REDIS_ASSERT(async_redis.expire(key, std::chrono::seconds(100)).get(),
+            "failed to test async expire");
+
+    auto ttl = async_redis.ttl(key).get();
+    REDIS_ASSERT(ttl > 0 && ttl <= 100, "failed to test async ttl");
+
+    REDIS_ASSERT(async_redis.exists(key).get() == 1, "failed to test async exists");
+
+    val = async_redis.template command<OptionalString>("GET", key).get();
+    REDIS_ASSERT(val && *val == "value", "failed to test async generic command");
+
+    REDIS_ASSERT(async_redis.del(key).get() == 1, "failed to test async del");
+}
+
+template <typename RedisInstance>
+void AsyncTest<RedisInstance>::_test_hash_list(AsyncRedisInstance &async_redis) {
+    auto hash_key = test_key("async-hash");
+    auto list_key = test_key("async-list");
+
+    KeyDeleter<RedisInstance> deleter(_redis, {hash_key, list_key});
+
+    REDIS_ASSERT(async_redis.hset(hash_key, "f", "v").get(), "failed to test async hset");
+
+    auto val = async_redis.hget(hash_key, "f").get();
+    REDIS_ASSERT(val && *val == "v", "failed to test async hget");
+
+    REDIS_ASSERT(async_redis.hdel(hash_key, "f").get() == 1, "failed to test async hdel");
+
+    async_redis.rpush(list_key, "a");
+    async_redis.rpush(list_key, "b");
+    REDIS_ASSERT(async_redis.lpush(list_key, "c").get() == 3, "failed to test async lpush");
+
+    auto items = async_redis.lrange(list_key, 0, -1).get();
+    REDIS_ASSERT((items == std::vector<std::string>{"c", "a", "b"}),
+            "failed to test async lrange");
+}
+
+template <typename RedisInstance>
+void AsyncTest<RedisInstance>::_test_outstanding(AsyncRedisInstance &async_redis) {
+    auto key = test_key("async-counter");
+
+    KeyDeleter<RedisInstance> deleter(_redis, key);
+
+    // Send lots of commands without waiting for replies.
+    const auto times = 10000;
+    std::vector<Future<long long>> futures;
+    futures.reserve(times);
+    for (auto idx = 0; idx != times; ++idx) {
+        futures.push_back(async_redis.incr(key));
+    }
+
+    for (auto &fut : futures) {
+        fut.get();
+    }
+
+    auto val = _redis.get(key);
+    REDIS_ASSERT(val && *val == std::to_string(times),
+            "failed to test async commands with lots of outstanding requests");
+}
+
+template <typename RedisInstance>
+void AsyncTest<RedisInstance>::_test_error(AsyncRedisInstance &async_redis) {
+    auto key = test_key("async-error");
+
+    KeyDeleter<RedisInstance> deleter(_redis, key);
+
+    _redis.set(key, "not a number");
+
+    auto fut = async_redis.incr(key);
+    try {
+        fut.get();
+        REDIS_ASSERT(false, "failed to test async error reply");
+    } catch (const ReplyError &) {
+    }
+
+    // The connection still works after an error reply.
+    auto val = async_redis.get(key).get();
+    REDIS_ASSERT(val && *val == "not a number", "failed to test async error reply");
+}
+
+template <typename RedisInstance>
+void AsyncTest<RedisInstance>::_test_event_loop() {
+    EventLoop loop;
+
+    loop.post([]() { throw std::runtime_error("task failed"); });
+
+    // The loop thread survives the exception, and keeps running tasks.
+    std::promise<bool> promise;
+    auto fut = promise.get_future();
+    loop.post([&promise, &loop]() { promise.set_value(!loop.error()); });
+
+    REDIS_ASSERT(fut.get(), "failed to test event loop with exception");
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_ASYNC_TEST_HPP
@@ -48,8 +48,9 @@ private:
     template <typename Func>
     void _run(const std::string &title, Func &&func);
 
+    // Run *func* with indexes in [first, first + request_num), and returns latencies.
     template <typename Func>
-    std::size_t _run(Func &&func, std::size_t request_num);
+    LatencyStats _run(Func &func, std::size_t first, std::size_t request_num);
 
     void _test_get();
 
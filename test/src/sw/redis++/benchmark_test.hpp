@@ -99,43 +99,57 @@ void BenchmarkTest<RedisInstance>::_run(const std::string &title, Func &&func) {
     auto thread_num = _opts.thread_num;
     auto requests_per_thread = _opts.total_request_num / thread_num;
     auto total_request_num = requests_per_thread * thread_num;
-    std::vector<std::future<std::size_t>> res;
+    std::vector<std::future<LatencyStats>> res;
     res.reserve(thread_num);
-    res.push_back(std::async(std::launch::async,
-                    [this](Func &&func, std::size_t request_num) {
-                        return this->_run(std::forward<Func>(func), request_num);
-                    },
-                    std::forward<Func>(func),
-                    requests_per_thread));
-
-    auto total_in_msec = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t idx = 0; idx != thread_num; ++idx) {
+        res.push_back(std::async(std::launch::async,
+                        [this, &func, idx, requests_per_thread]() {
+                            return this->_run(func, idx * requests_per_thread, requests_per_thread);
+                        }));
+    }
+
+    LatencyStats latency;
     for (auto &fut : res) {
-        total_in_msec += fut.get();
+        latency.merge(fut.get());
     }
 
-    auto total_in_sec = total_in_msec * 1.0 / 1000;
+    auto stop = std::chrono::steady_clock::now();
 
-    auto avg = total_in_msec * 1.0 / total_request_num;
+    auto total_in_msec = std::max<long long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count(), 1);
 
-    auto ops = static_cast<std::size_t>(1000 / avg);
+    auto total_in_sec = total_in_msec * 1.0 / 1000;
+
+    auto ops = static_cast<std::size_t>(total_request_num / total_in_sec);
 
     std::cout << "-----" << title << "-----" << std::endl;
     std::cout << total_request_num << " requests cost " << total_in_sec << " seconds" << std::endl;
     std::cout << ops << " requests per second" << std::endl;
+    std::cout << "latency: p50 " << latency.percentile(50).count() << "us"
+        << ", p99 " << latency.percentile(99).count() << "us"
+        << ", p999 " << latency.percentile(99.9).count() << "us" << std::endl;
 }
 
 template <typename RedisInstance>
 template <typename Func>
-std::size_t BenchmarkTest<RedisInstance>::_run(Func &&func, std::size_t request_num) {
-    auto start = std::chrono::steady_clock::now();
+LatencyStats BenchmarkTest<RedisInstance>::_run(Func &func,
+                                                std::size_t first,
+                                                std::size_t request_num) {
+    LatencyHistogram latency;
+
+    for (auto idx = first; idx != first + request_num; ++idx) {
+        auto start = std::chrono::steady_clock::now();
 
-    for (auto idx = 0U; idx != request_num; ++idx) {
         func(idx);
-    }
 
-    auto stop = std::chrono::steady_clock::now();
+        latency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start));
+    }
 
-    return std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+    return latency.stats();
 }
 
 template <typename RedisInstance>
@@ -0,0 +1,55 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_H
+#define SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_H
+
+#include <sw/redis++/redis++.h>
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+// Client cache only works with Redis, i.e. NOT RedisCluster.
+class ClientCacheTest {
+public:
+    explicit ClientCacheTest(const ConnectionOptions &opts) : _opts(opts) {}
+
+    void run();
+
+private:
+    bool _support_tracking(Redis &redis);
+
+    void _test_get(Redis &cached, Redis &redis);
+
+    void _test_hget(Redis &cached, Redis &redis);
+
+    void _test_local_write(Redis &cached, Redis &redis);
+
+    ConnectionOptions _opts;
+};
+
+}
+
+}
+
+}
+
+#include "client_cache_test.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_H
@@ -0,0 +1,175 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_HPP
+
+#include <thread>
+#include <chrono>
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+inline void ClientCacheTest::run() {
+    auto redis = Redis(_opts);
+
+    if (!_support_tracking(redis)) {
+        // CLIENT TRACKING needs Redis 6.0 or later.
+        return;
+    }
+
+    ConnectionPoolOptions pool_opts;
+    pool_opts.size = 2;
+
+    auto cached = Redis(_opts, pool_opts);
+    cached.enable_client_cache();
+
+    _test_get(cached, redis);
+
+    _test_hget(cached, redis);
+
+    _test_local_write(cached, redis);
+}
+
+inline bool ClientCacheTest::_support_tracking(Redis &redis) {
+    try {
+        redis.command("CLIENT", "TRACKING", "OFF");
+    } catch (const ReplyError &) {
+        return false;
+    }
+
+    return true;
+}
+
+inline void ClientCacheTest::_test_get(Redis &cached, Redis &redis) {
+    using namespace std::chrono;
+
+    auto key = test_key("client-cache");
+
+    KeyDeleter<Redis> deleter(redis, key);
+
+    redis.set(key, "v1");
+
+    // Wait until the invalidation connection is ready, and the key is cached.
+    auto hit = false;
+    for (auto idx = 0; idx != 100 && !hit; ++idx) {
+        auto hits = cached.client_cache_stats().hits;
+
+        auto val = cached.get(key);
+        REDIS_ASSERT(val && *val == "v1", "failed to test client cache get");
+
+        hit = cached.client_cache_stats().hits > hits;
+        if (!hit) {
+            std::this_thread::sleep_for(milliseconds(20));
+        }
+    }
+    REDIS_ASSERT(hit, "failed to test client cache hit");
+
+    // Modify the key with another client, and the cached value should be invalidated.
+    redis.set(key, "v2");
+
+    auto invalidated = false;
+    for (auto idx = 0; idx != 100 && !invalidated; ++idx) {
+        auto val = cached.get(key);
+        REDIS_ASSERT(bool(val), "failed to test client cache get");
+
+        invalidated = (*val == "v2");
+        if (!invalidated) {
+            std::this_thread::sleep_for(milliseconds(20));
+        }
+    }
+    REDIS_ASSERT(invalidated, "failed to test client cache invalidation");
+
+    auto stats = cached.client_cache_stats();
+    REDIS_ASSERT(stats.misses > 0 && stats.invalidations > 0 && stats.entries > 0,
+            "failed to test client cache stats");
+}
+
+inline void ClientCacheTest::_test_hget(Redis &cached, Redis &redis) {
+    auto key = test_key("client-cache-hash");
+
+    KeyDeleter<Redis> deleter(redis, key);
+
+    redis.hset(key, "f", "v");
+
+    auto val = cached.hget(key, "f");
+    REDIS_ASSERT(val && *val == "v", "failed to test client cache hget");
+
+    auto hits = cached.client_cache_stats().hits;
+
+    val = cached.hget(key, "f");
+    REDIS_ASSERT(val && *val == "v", "failed to test client cache hget");
+
+    REDIS_ASSERT(cached.client_cache_stats().hits > hits, "failed to test client cache hget hit");
+
+    val = cached.hget(key, "nonexistent");
+    REDIS_ASSERT(!val, "failed to test client cache hget with nonexistent field");
+}
+
+inline void ClientCacheTest::_test_local_write(Redis &cached, Redis &redis) {
+    auto key = test_key("client-cache-local-write");
+    auto hash = test_key("client-cache-local-write-hash");
+
+    KeyDeleter<Redis> deleter(redis, {key, hash});
+
+    // Writes through the caching Redis should be visible immediately,
+    // i.e. without waiting for the invalidation message.
+    cached.set(key, "v1");
+    cached.get(key);
+    auto val = cached.get(key);
+    REDIS_ASSERT(val && *val == "v1", "failed to test client cache local write");
+
+    cached.set(key, "v2");
+    val = cached.get(key);
+    REDIS_ASSERT(val && *val == "v2", "failed to test client cache local set");
+
+    cached.del(key);
+    val = cached.get(key);
+    REDIS_ASSERT(!val, "failed to test client cache local del");
+
+    cached.command("SET", key, "v3");
+    val = cached.get(key);
+    REDIS_ASSERT(val && *val == "v3", "failed to test client cache local generic command");
+
+    // Read-only generic commands don't flush the cache.
+    cached.command("GET", key);
+    auto hits = cached.client_cache_stats().hits;
+    val = cached.get(key);
+    REDIS_ASSERT(val && *val == "v3" && cached.client_cache_stats().hits > hits,
+            "failed to test client cache with read-only generic command");
+
+    cached.hset(hash, "f", "v1");
+    cached.hget(hash, "f");
+    cached.hset(hash, "f", "v2");
+    val = cached.hget(hash, "f");
+    REDIS_ASSERT(val && *val == "v2", "failed to test client cache local hset");
+
+    cached.hdel(hash, "f");
+    val = cached.hget(hash, "f");
+    REDIS_ASSERT(!val, "failed to test client cache local hdel");
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_HPP
@@ -41,6 +41,8 @@ private:
 
     void _test_blocking();
 
+    void _test_large_range();
+
     RedisInstance &_redis;
 };
 
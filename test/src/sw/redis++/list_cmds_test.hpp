@@ -34,6 +34,8 @@ void ListCmdTest<RedisInstance>::run() {
     _test_list();
 
     _test_blocking();
+
+    _test_large_range();
 }
 
 template <typename RedisInstance>
@@ -138,6 +140,28 @@ void ListCmdTest<RedisInstance>::_test_blocking() {
     REDIS_ASSERT(str && *str == val, "failed to test rpoplpush");
 }
 
+template <typename RedisInstance>
+void ListCmdTest<RedisInstance>::_test_large_range() {
+    auto key = test_key("large-range");
+
+    KeyDeleter<RedisInstance> deleter(_redis, key);
+
+    std::vector<std::string> input;
+    for (auto idx = 0; idx != 10000; ++idx) {
+        input.push_back(std::to_string(idx));
+    }
+
+    _redis.rpush(key, input.begin(), input.end());
+
+    std::vector<std::string> res;
+    _redis.lrange(key, 0, -1, std::back_inserter(res));
+    REDIS_ASSERT(res == input, "failed to test lrange with large reply");
+
+    res.clear();
+    _redis.lrange(key, 0, 99, std::back_inserter(res));
+    REDIS_ASSERT(res.size() == 100 && res.back() == "99", "failed to test lrange with range");
+}
+
 }
 
 }
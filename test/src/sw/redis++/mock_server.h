@@ -0,0 +1,219 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_H
+#define SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sw/redis++/redis++.h>
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+struct MockServerOptions {
+    // TCP or UNIX.
+    ConnectionType type = ConnectionType::TCP;
+
+    std::string host = "127.0.0.1";
+
+    // 0 means listening on a free port, which can be got with *MockServer::connection_options*.
+    int port = 0;
+
+    // Path of the unix domain socket. It's removed when the server stops.
+    std::string path;
+};
+
+// An in-process RESP server, so that we can test and benchmark the client without
+// a live Redis, and inject faults deterministically. Each client connection is served
+// by its own thread.
+//
+// It keeps strings in memory, and supports PING, ECHO, GET, SET, INCR, INCRBY, DECR,
+// DEL, EXISTS, MGET, MSET, SCAN, DBSIZE, FLUSHALL, MULTI, EXEC, DISCARD and CLUSTER SLOTS.
+// Connection setup commands, e.g. AUTH and SELECT, always succeed. Other commands can be
+// served with *set_handler* or *set_reply*, otherwise, they get an error reply.
+class MockServer {
+public:
+    // Takes the command and its arguments, and returns the RESP encoded reply.
+    using Handler = std::function<std::string (const std::vector<std::string> &args)>;
+
+    explicit MockServer(const MockServerOptions &opts = MockServerOptions{});
+
+    MockServer(const MockServer &) = delete;
+    MockServer& operator=(const MockServer &) = delete;
+
+    MockServer(MockServer &&) = delete;
+    MockServer& operator=(MockServer &&) = delete;
+
+    ~MockServer();
+
+    ConnectionOptions connection_options() const;
+
+    Node node() const;
+
+    // Serve *command*, e.g. "LPUSH", with *handler*. It overrides the builtin command.
+    void set_handler(const std::string &command, Handler handler);
+
+    // Always reply *command* with *reply*, which should be RESP encoded.
+    void set_reply(const std::string &command, const std::string &reply);
+
+    // Delay before sending replies of commands received in a single read,
+    // i.e. a pipeline only pays the latency once, like the network round trip.
+    void set_latency(std::chrono::microseconds latency);
+
+    // Send replies in chunks of at most *chunk_size* bytes, and sleep *interval* between
+    // chunks, so that the client receives partial replies. 0 disables it.
+    void set_partial_write(std::size_t chunk_size,
+                            std::chrono::microseconds interval = std::chrono::microseconds(100));
+
+    // Close all current client connections.
+    void disconnect();
+
+    // Serve the next *num* commands, and then close the connection that sends the one
+    // after them, without replying it.
+    void disconnect_after(std::size_t num);
+
+    // Reply of CLUSTER SLOTS. By default, this server serves all slots.
+    // *replicas* are replicas of each slot range, which are listed after its master.
+    void set_cluster_slots(const Shards &shards,
+                            const std::map<SlotRange, std::vector<Node>> &replicas = {});
+
+    // Reply commands whose key is located on *slot* with a MOVED error,
+    // or an ASK error if *asking* is true.
+    void redirect(Slot slot, const Node &node, bool asking = false);
+
+    void clear_redirections();
+
+    // Number of commands received.
+    long long command_num() const {
+        return _command_num.load();
+    }
+
+    // Number of client connections accepted.
+    long long connection_num() const {
+        return _connection_num.load();
+    }
+
+    // Close the listening socket and all client connections. Called by the destructor.
+    void stop();
+
+    static std::string status(const std::string &str);
+
+    static std::string error(const std::string &str);
+
+    static std::string integer(long long num);
+
+    static std::string bulk(const std::string &str);
+
+    static std::string nil();
+
+    // *elements* should be RESP encoded.
+    static std::string array(const std::vector<std::string> &elements);
+
+    static Slot slot(const std::string &key);
+
+private:
+    struct Session {
+        bool multi = false;
+
+        std::vector<std::vector<std::string>> queued;
+    };
+
+    struct Redirection {
+        Node node;
+
+        bool asking;
+    };
+
+    void _listen();
+
+    void _accept();
+
+    void _serve(int fd);
+
+    // Returns false if the connection should be closed.
+    bool _write(int fd, const std::string &data);
+
+    std::string _reply(Session &session, const std::vector<std::string> &args);
+
+    std::string _command(const std::vector<std::string> &args);
+
+    std::string _scan(const std::vector<std::string> &args);
+
+    std::string _cluster_slots();
+
+    bool _redirected(const std::vector<std::string> &args, std::string &reply);
+
+    MockServerOptions _opts;
+
+    int _listen_fd = -1;
+
+    std::thread _acceptor;
+
+    std::list<std::thread> _workers;
+
+    std::unordered_set<int> _clients;
+
+    std::atomic<bool> _stopped{false};
+
+    std::atomic<long long> _latency{0};
+
+    std::atomic<std::size_t> _chunk_size{0};
+
+    std::atomic<long long> _chunk_interval{0};
+
+    // Commands left before disconnecting. -1 means never disconnect.
+    std::atomic<long long> _disconnect_countdown{-1};
+
+    std::atomic<long long> _command_num{0};
+
+    std::atomic<long long> _connection_num{0};
+
+    // Protects the following members, and *_workers* and *_clients*.
+    mutable std::mutex _mutex;
+
+    std::unordered_map<std::string, Handler> _handlers;
+
+    std::unordered_map<std::string, std::string> _data;
+
+    Shards _shards;
+
+    std::map<SlotRange, std::vector<Node>> _replicas;
+
+    std::unordered_map<Slot, Redirection> _redirections;
+};
+
+}
+
+}
+
+}
+
+#include "mock_server.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_H
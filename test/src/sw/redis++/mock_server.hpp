@@ -0,0 +1,742 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_HPP
+
+#include <arpa/inet.h>
+#include <fnmatch.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+namespace detail {
+
+enum class ParseResult {
+    PARSED = 0,
+    INCOMPLETE,
+    INVALID
+};
+
+// Parse a command, i.e. an array of bulk strings, from *buf* at *pos*,
+// and move *pos* to the end of the command, if it's parsed.
+inline ParseResult parse_command(const std::string &buf,
+                                    std::size_t &pos,
+                                    std::vector<std::string> &args) {
+    auto cur = pos;
+    auto read_num = [&buf, &cur](char type, long long &num) {
+        auto end = buf.find("\r\n", cur);
+        if (end == std::string::npos) {
+            return ParseResult::INCOMPLETE;
+        }
+
+        if (end == cur || buf[cur] != type) {
+            return ParseResult::INVALID;
+        }
+
+        try {
+            num = std::stoll(buf.substr(cur + 1, end - cur - 1));
+        } catch (const std::exception &) {
+            return ParseResult::INVALID;
+        }
+
+        cur = end + 2;
+
+        return ParseResult::PARSED;
+    };
+
+    long long num = 0;
+    auto res = read_num('*', num);
+    if (res != ParseResult::PARSED) {
+        return res;
+    }
+
+    if (num <= 0) {
+        return ParseResult::INVALID;
+    }
+
+    args.clear();
+    for (long long idx = 0; idx != num; ++idx) {
+        long long len = 0;
+        res = read_num('$', len);
+        if (res != ParseResult::PARSED) {
+            return res;
+        }
+
+        if (len < 0) {
+            return ParseResult::INVALID;
+        }
+
+        if (buf.size() < cur + len + 2) {
+            return ParseResult::INCOMPLETE;
+        }
+
+        args.push_back(buf.substr(cur, len));
+        cur += len + 2;
+    }
+
+    pos = cur;
+
+    return ParseResult::PARSED;
+}
+
+inline std::string to_upper(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(),
+                    [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    return str;
+}
+
+inline void throw_sys_error(const std::string &msg) {
+    throw Error(msg + ": " + std::strerror(errno));
+}
+
+}
+
+inline MockServer::MockServer(const MockServerOptions &opts) : _opts(opts) {
+    _listen();
+
+    _acceptor = std::thread([this]() { this->_accept(); });
+}
+
+inline MockServer::~MockServer() {
+    stop();
+}
+
+inline ConnectionOptions MockServer::connection_options() const {
+    ConnectionOptions opts;
+    opts.type = _opts.type;
+    opts.host = _opts.host;
+    opts.port = _opts.port;
+    opts.path = _opts.path;
+
+    return opts;
+}
+
+inline Node MockServer::node() const {
+    return {_opts.host, _opts.port};
+}
+
+inline void MockServer::set_handler(const std::string &command, Handler handler) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _handlers[detail::to_upper(command)] = std::move(handler);
+}
+
+inline void MockServer::set_reply(const std::string &command, const std::string &reply) {
+    set_handler(command, [reply](const std::vector<std::string> &) { return reply; });
+}
+
+inline void MockServer::set_latency(std::chrono::microseconds latency) {
+    _latency = latency.count();
+}
+
+inline void MockServer::set_partial_write(std::size_t chunk_size,
+                                            std::chrono::microseconds interval) {
+    _chunk_interval = interval.count();
+    _chunk_size = chunk_size;
+}
+
+inline void MockServer::disconnect() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Workers close the sockets, when they find the connections have been shut down.
+    for (auto fd : _clients) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+}
+
+inline void MockServer::disconnect_after(std::size_t num) {
+    _disconnect_countdown = static_cast<long long>(num);
+}
+
+inline void MockServer::set_cluster_slots(const Shards &shards,
+                                            const std::map<SlotRange, std::vector<Node>> &replicas) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _shards = shards;
+    _replicas = replicas;
+}
+
+inline void MockServer::redirect(Slot slot, const Node &node, bool asking) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _redirections[slot] = Redirection{node, asking};
+}
+
+inline void MockServer::clear_redirections() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _redirections.clear();
+}
+
+inline void MockServer::stop() {
+    if (_stopped.exchange(true)) {
+        return;
+    }
+
+    if (_acceptor.joinable()) {
+        _acceptor.join();
+    }
+
+    ::close(_listen_fd);
+
+    std::list<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        for (auto fd : _clients) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+
+        workers.swap(_workers);
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    if (_opts.type == ConnectionType::UNIX) {
+        ::unlink(_opts.path.c_str());
+    }
+}
+
+inline std::string MockServer::status(const std::string &str) {
+    return "+" + str + "\r\n";
+}
+
+inline std::string MockServer::error(const std::string &str) {
+    return "-" + str + "\r\n";
+}
+
+inline std::string MockServer::integer(long long num) {
+    return ":" + std::to_string(num) + "\r\n";
+}
+
+inline std::string MockServer::bulk(const std::string &str) {
+    return "$" + std::to_string(str.size()) + "\r\n" + str + "\r\n";
+}
+
+inline std::string MockServer::nil() {
+    return "$-1\r\n";
+}
+
+inline std::string MockServer::array(const std::vector<std::string> &elements) {
+    auto res = "*" + std::to_string(elements.size()) + "\r\n";
+    for (const auto &ele : elements) {
+        res += ele;
+    }
+
+    return res;
+}
+
+inline Slot MockServer::slot(const std::string &key) {
+    const Slot MAX_SLOT = 16383;
+
+    // Only hash the hash tag, if there's a non-empty one.
+    auto start = key.find('{');
+    if (start != std::string::npos) {
+        auto end = key.find('}', start + 1);
+        if (end != std::string::npos && end != start + 1) {
+            return crc16(key.data() + start + 1, static_cast<int>(end - start - 1)) & MAX_SLOT;
+        }
+    }
+
+    return crc16(key.data(), static_cast<int>(key.size())) & MAX_SLOT;
+}
+
+inline void MockServer::_listen() {
+    if (_opts.type == ConnectionType::TCP) {
+        _listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (_listen_fd < 0) {
+            detail::throw_sys_error("Failed to create socket");
+        }
+
+        int on = 1;
+        ::setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(_opts.port));
+        if (::inet_pton(AF_INET, _opts.host.c_str(), &addr.sin_addr) != 1) {
+            ::close(_listen_fd);
+            throw Error("Invalid host: " + _opts.host);
+        }
+
+        if (::bind(_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(_listen_fd);
+            detail::throw_sys_error("Failed to bind " + _opts.host);
+        }
+
+        socklen_t len = sizeof(addr);
+        if (::getsockname(_listen_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            ::close(_listen_fd);
+            detail::throw_sys_error("Failed to get socket name");
+        }
+
+        _opts.port = ntohs(addr.sin_port);
+    } else {
+        _listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_listen_fd < 0) {
+            detail::throw_sys_error("Failed to create socket");
+        }
+
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (_opts.path.empty() || _opts.path.size() >= sizeof(addr.sun_path)) {
+            ::close(_listen_fd);
+            throw Error("Invalid unix socket path: " + _opts.path);
+        }
+        std::strncpy(addr.sun_path, _opts.path.c_str(), sizeof(addr.sun_path) - 1);
+
+        ::unlink(_opts.path.c_str());
+
+        if (::bind(_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(_listen_fd);
+            detail::throw_sys_error("Failed to bind " + _opts.path);
+        }
+    }
+
+    if (::listen(_listen_fd, 128) != 0) {
+        ::close(_listen_fd);
+        detail::throw_sys_error("Failed to listen");
+    }
+}
+
+inline void MockServer::_accept() {
+    while (!_stopped) {
+        // Poll with timeout, so that we can find the server has been stopped.
+        pollfd pfd;
+        pfd.fd = _listen_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+
+        auto fd = ::accept(_listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+
+        if (_opts.type == ConnectionType::TCP) {
+            // Otherwise, partial writes might be coalesced.
+            int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_stopped) {
+            ::close(fd);
+            break;
+        }
+
+        ++_connection_num;
+
+        _clients.insert(fd);
+        _workers.emplace_back([this, fd]() { this->_serve(fd); });
+    }
+}
+
+inline void MockServer::_serve(int fd) {
+    Session session;
+    std::string buf;
+    std::vector<std::string> args;
+    char tmp[16 * 1024];
+
+    while (true) {
+        auto len = ::recv(fd, tmp, sizeof(tmp), 0);
+        if (len <= 0) {
+            break;
+        }
+
+        buf.append(tmp, len);
+
+        std::string replies;
+        std::size_t pos = 0;
+        auto closing = false;
+        while (!closing) {
+            auto res = detail::parse_command(buf, pos, args);
+            if (res == detail::ParseResult::INCOMPLETE) {
+                break;
+            }
+
+            if (res == detail::ParseResult::INVALID) {
+                replies += error("ERR Protocol error");
+                closing = true;
+                break;
+            }
+
+            ++_command_num;
+
+            auto left = _disconnect_countdown.load();
+            while (left >= 0) {
+                auto next = (left == 0) ? -1 : left - 1;
+                if (_disconnect_countdown.compare_exchange_weak(left, next)) {
+                    closing = (left == 0);
+                    break;
+                }
+            }
+
+            if (!closing) {
+                replies += _reply(session, args);
+            }
+        }
+
+        buf.erase(0, pos);
+
+        if (!replies.empty()) {
+            auto latency = _latency.load();
+            if (latency > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(latency));
+            }
+
+            if (!_write(fd, replies)) {
+                break;
+            }
+        }
+
+        if (closing) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _clients.erase(fd);
+    ::close(fd);
+}
+
+inline bool MockServer::_write(int fd, const std::string &data) {
+    int flags = 0;
+#ifdef MSG_NOSIGNAL
+    flags = MSG_NOSIGNAL;
+#endif
+
+    auto chunk_size = _chunk_size.load();
+    if (chunk_size == 0) {
+        chunk_size = data.size();
+    }
+
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        auto len = ::send(fd, data.data() + sent, std::min(chunk_size, data.size() - sent), flags);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        sent += len;
+
+        if (sent < data.size() && chunk_size < data.size()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(_chunk_interval.load()));
+        }
+    }
+
+    return true;
+}
+
+inline std::string MockServer::_reply(Session &session, const std::vector<std::string> &args) {
+    std::string reply;
+    if (_redirected(args, reply)) {
+        return reply;
+    }
+
+    auto name = detail::to_upper(args[0]);
+    if (session.multi) {
+        if (name == "EXEC") {
+            session.multi = false;
+
+            std::vector<std::string> replies;
+            for (const auto &cmd : session.queued) {
+                replies.push_back(_command(cmd));
+            }
+            session.queued.clear();
+
+            return array(replies);
+        } else if (name == "DISCARD") {
+            session.multi = false;
+            session.queued.clear();
+
+            return status("OK");
+        } else if (name == "MULTI") {
+            return error("ERR MULTI calls can not be nested");
+        }
+
+        session.queued.push_back(args);
+
+        return status("QUEUED");
+    }
+
+    if (name == "MULTI") {
+        session.multi = true;
+
+        return status("OK");
+    } else if (name == "EXEC" || name == "DISCARD") {
+        return error("ERR " + name + " without MULTI");
+    }
+
+    return _command(args);
+}
+
+inline std::string MockServer::_command(const std::vector<std::string> &args) {
+    auto name = detail::to_upper(args[0]);
+
+    Handler handler;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto iter = _handlers.find(name);
+        if (iter != _handlers.end()) {
+            handler = iter->second;
+        }
+    }
+
+    if (handler) {
+        return handler(args);
+    }
+
+    auto arity_error = [&args]() {
+        return error("ERR wrong number of arguments for '" + args[0] + "' command");
+    };
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (name == "PING") {
+        return args.size() > 1 ? bulk(args[1]) : status("PONG");
+    } else if (name == "ECHO") {
+        return args.size() == 2 ? bulk(args[1]) : arity_error();
+    } else if (name == "AUTH" || name == "SELECT" || name == "CLIENT"
+            || name == "READONLY" || name == "READWRITE" || name == "ASKING") {
+        return status("OK");
+    } else if (name == "GET") {
+        if (args.size() != 2) {
+            return arity_error();
+        }
+
+        auto iter = _data.find(args[1]);
+        return iter == _data.end() ? nil() : bulk(iter->second);
+    } else if (name == "SET") {
+        if (args.size() < 3) {
+            return arity_error();
+        }
+
+        // Options, e.g. EX and NX, are ignored.
+        _data[args[1]] = args[2];
+
+        return status("OK");
+    } else if (name == "INCR" || name == "DECR" || name == "INCRBY") {
+        if (args.size() != (name == "INCRBY" ? 3U : 2U)) {
+            return arity_error();
+        }
+
+        try {
+            long long increment = (name == "INCR") ? 1 : -1;
+            if (name == "INCRBY") {
+                increment = std::stoll(args[2]);
+            }
+
+            auto &val = _data[args[1]];
+            auto num = (val.empty() ? 0 : std::stoll(val)) + increment;
+            val = std::to_string(num);
+
+            return integer(num);
+        } catch (const std::exception &) {
+            return error("ERR value is not an integer or out of range");
+        }
+    } else if (name == "DEL" || name == "EXISTS") {
+        if (args.size() < 2) {
+            return arity_error();
+        }
+
+        long long num = 0;
+        for (std::size_t idx = 1; idx != args.size(); ++idx) {
+            if (name == "DEL") {
+                num += _data.erase(args[idx]);
+            } else {
+                num += _data.count(args[idx]);
+            }
+        }
+
+        return integer(num);
+    } else if (name == "MGET") {
+        if (args.size() < 2) {
+            return arity_error();
+        }
+
+        std::vector<std::string> vals;
+        for (std::size_t idx = 1; idx != args.size(); ++idx) {
+            auto iter = _data.find(args[idx]);
+            vals.push_back(iter == _data.end() ? nil() : bulk(iter->second));
+        }
+
+        return array(vals);
+    } else if (name == "MSET") {
+        if (args.size() < 3 || args.size() % 2 != 1) {
+            return arity_error();
+        }
+
+        for (std::size_t idx = 1; idx != args.size(); idx += 2) {
+            _data[args[idx]] = args[idx + 1];
+        }
+
+        return status("OK");
+    } else if (name == "SCAN") {
+        return _scan(args);
+    } else if (name == "DBSIZE") {
+        return integer(static_cast<long long>(_data.size()));
+    } else if (name == "FLUSHALL" || name == "FLUSHDB") {
+        _data.clear();
+
+        return status("OK");
+    } else if (name == "CLUSTER" && args.size() == 2 && detail::to_upper(args[1]) == "SLOTS") {
+        return _cluster_slots();
+    }
+
+    return error("ERR unknown command '" + args[0] + "'");
+}
+
+inline std::string MockServer::_scan(const std::vector<std::string> &args) {
+    if (args.size() < 2 || args.size() % 2 != 0) {
+        return error("ERR syntax error");
+    }
+
+    std::string pattern = "*";
+    std::size_t count = 10;
+    std::size_t cursor = 0;
+    try {
+        cursor = std::stoull(args[1]);
+        for (std::size_t idx = 2; idx != args.size(); idx += 2) {
+            auto option = detail::to_upper(args[idx]);
+            if (option == "MATCH") {
+                pattern = args[idx + 1];
+            } else if (option == "COUNT") {
+                count = std::stoull(args[idx + 1]);
+            } else {
+                return error("ERR syntax error");
+            }
+        }
+    } catch (const std::exception &) {
+        return error("ERR invalid cursor");
+    }
+
+    // The cursor is the index of the next key in the sorted keys, so that it's stable
+    // as long as keys are not modified during the iteration.
+    std::vector<std::string> keys;
+    keys.reserve(_data.size());
+    for (const auto &ele : _data) {
+        keys.push_back(ele.first);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<std::string> matched;
+    for (; cursor < keys.size() && count > 0; ++cursor, --count) {
+        if (::fnmatch(pattern.c_str(), keys[cursor].c_str(), 0) == 0) {
+            matched.push_back(bulk(keys[cursor]));
+        }
+    }
+
+    auto next = cursor < keys.size() ? cursor : 0;
+
+    return array({bulk(std::to_string(next)), array(matched)});
+}
+
+inline std::string MockServer::_cluster_slots() {
+    auto shards = _shards;
+    if (shards.empty()) {
+        shards.emplace(SlotRange{0, 16383}, node());
+    }
+
+    std::vector<std::string> slots;
+    for (const auto &shard : shards) {
+        const auto &node = shard.second;
+        std::vector<std::string> range = {integer(static_cast<long long>(shard.first.min)),
+                                            integer(static_cast<long long>(shard.first.max)),
+                                            array({bulk(node.host), integer(node.port)})};
+
+        auto iter = _replicas.find(shard.first);
+        if (iter != _replicas.end()) {
+            for (const auto &replica : iter->second) {
+                range.push_back(array({bulk(replica.host), integer(replica.port)}));
+            }
+        }
+
+        slots.push_back(array(range));
+    }
+
+    return array(slots);
+}
+
+inline bool MockServer::_redirected(const std::vector<std::string> &args, std::string &reply) {
+    if (args.size() < 2) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_redirections.empty()) {
+        return false;
+    }
+
+    // Commands without key.
+    static const std::unordered_set<std::string> KEYLESS_COMMANDS = {
+        "PING", "ECHO", "AUTH", "SELECT", "CLIENT", "READONLY", "READWRITE", "ASKING",
+        "MULTI", "EXEC", "DISCARD", "SCAN", "DBSIZE", "FLUSHALL", "FLUSHDB", "CLUSTER", "INFO"
+    };
+
+    if (KEYLESS_COMMANDS.count(detail::to_upper(args[0])) != 0) {
+        return false;
+    }
+
+    auto key_slot = slot(args[1]);
+    auto iter = _redirections.find(key_slot);
+    if (iter == _redirections.end()) {
+        return false;
+    }
+
+    const auto &redirection = iter->second;
+    reply = error(std::string(redirection.asking ? "ASK " : "MOVED ")
+                    + std::to_string(key_slot) + " "
+                    + redirection.node.host + ":" + std::to_string(redirection.node.port));
+
+    return true;
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_HPP
@@ -0,0 +1,65 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_H
+#define SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_H
+
+#include <sw/redis++/redis++.h>
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+// Tests with MockServer, which don't need a live Redis.
+class MockServerTest {
+public:
+    void run();
+
+private:
+    void _test_commands();
+
+    void _test_unix_socket();
+
+    void _test_partial_write();
+
+    void _test_stream_replies();
+
+    void _test_latency();
+
+    void _test_disconnect();
+
+    void _test_cluster();
+
+    void _test_cluster_scan();
+
+    void _test_cluster_update();
+
+    void _test_read_preference();
+
+    void _test_async_cluster();
+};
+
+}
+
+}
+
+}
+
+#include "mock_server_test.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_H
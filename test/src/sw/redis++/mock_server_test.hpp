@@ -0,0 +1,524 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_HPP
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "mock_server.h"
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+inline void MockServerTest::run() {
+    _test_commands();
+
+    _test_unix_socket();
+
+    _test_partial_write();
+
+    _test_stream_replies();
+
+    _test_latency();
+
+    _test_disconnect();
+
+    _test_cluster();
+
+    _test_cluster_scan();
+
+    _test_cluster_update();
+
+    _test_read_preference();
+
+    _test_async_cluster();
+}
+
+inline void MockServerTest::_test_commands() {
+    MockServer server;
+
+    auto redis = Redis(server.connection_options());
+
+    redis.set("key", "val");
+    auto val = redis.get("key");
+    REDIS_ASSERT(val && *val == "val", "failed to test mock server with set and get");
+
+    REDIS_ASSERT(redis.incr("num") == 1 && redis.incrby("num", 2) == 3,
+            "failed to test mock server with incr");
+
+    server.set_reply("LPUSH", MockServer::integer(5));
+    REDIS_ASSERT(redis.lpush("list", "a") == 5, "failed to test mock server with canned reply");
+
+    try {
+        redis.rpush("list", "a");
+        REDIS_ASSERT(false, "failed to test mock server with unknown command");
+    } catch (const ReplyError &) {
+    }
+
+    auto pipe = redis.pipeline();
+    auto replies = pipe.set("key", "new").get("key").del("key").exec();
+    val = replies.get<OptionalString>(1);
+    REDIS_ASSERT(val && *val == "new" && replies.get<long long>(2) == 1,
+            "failed to test mock server with pipeline");
+
+    auto tx = redis.transaction();
+    replies = tx.incr("num").get("num").exec();
+    val = replies.get<OptionalString>(1);
+    REDIS_ASSERT(replies.get<long long>(0) == 4 && val && *val == "4",
+            "failed to test mock server with transaction");
+}
+
+inline void MockServerTest::_test_unix_socket() {
+    MockServerOptions opts;
+    opts.type = ConnectionType::UNIX;
+    opts.path = "/tmp/redis-plus-plus-mock-" + std::to_string(::getpid()) + ".sock";
+
+    MockServer server(opts);
+
+    auto redis = Redis(server.connection_options());
+    redis.set("key", "val");
+
+    auto val = redis.get("key");
+    REDIS_ASSERT(val && *val == "val", "failed to test mock server with unix socket");
+}
+
+inline void MockServerTest::_test_partial_write() {
+    MockServer server;
+    server.set_partial_write(7);
+
+    auto redis = Redis(server.connection_options());
+
+    std::string big_val(10000, 'x');
+    redis.set("key", big_val);
+
+    auto val = redis.get("key");
+    REDIS_ASSERT(val && *val == big_val, "failed to test partial write");
+
+    auto pipe = redis.pipeline();
+    auto replies = pipe.get("key").get("key").exec();
+    auto first = replies.get<OptionalString>(0);
+    auto second = replies.get<OptionalString>(1);
+    REDIS_ASSERT(first && *first == big_val && second && *second == big_val,
+            "failed to test partial write with pipeline");
+}
+
+inline void MockServerTest::_test_stream_replies() {
+    MockServer server;
+
+    std::vector<std::string> input;
+    std::vector<std::string> elements;
+    for (auto idx = 0; idx != 10000; ++idx) {
+        input.push_back(std::to_string(idx));
+        elements.push_back(MockServer::bulk(input.back()));
+    }
+    server.set_reply("LRANGE", MockServer::array(elements));
+    server.set_reply("HGETALL", MockServer::array({MockServer::bulk("f1"),
+                MockServer::bulk("v1"), MockServer::bulk("f2"), MockServer::bulk("v2")}));
+
+    ConnectionPoolOptions pool_opts;
+    for (auto stream : {false, true}) {
+        pool_opts.stream_replies = stream;
+        auto redis = Redis(server.connection_options(), pool_opts);
+
+        std::vector<std::string> res;
+        redis.lrange("list", 0, -1, std::back_inserter(res));
+        REDIS_ASSERT(res == input, "failed to test lrange with large reply");
+
+        std::unordered_map<std::string, std::string> hash;
+        redis.hgetall("hash", std::inserter(hash, hash.end()));
+        REDIS_ASSERT(hash.size() == 2 && hash["f1"] == "v1" && hash["f2"] == "v2",
+                "failed to test hgetall");
+
+        // The connection is still in sync.
+        REDIS_ASSERT(redis.ping() == "PONG", "failed to test command after array reply");
+    }
+}
+
+inline void MockServerTest::_test_latency() {
+    MockServer server;
+    server.set_latency(std::chrono::milliseconds(100));
+
+    auto opts = server.connection_options();
+    opts.socket_timeout = std::chrono::milliseconds(10);
+
+    auto redis = Redis(opts);
+
+    try {
+        redis.ping();
+        REDIS_ASSERT(false, "failed to test latency");
+    } catch (const TimeoutError &) {
+    }
+
+    server.set_latency(std::chrono::microseconds(0));
+
+    // The broken connection is reconnected.
+    REDIS_ASSERT(redis.ping() == "PONG", "failed to test recovery from timeout");
+}
+
+inline void MockServerTest::_test_disconnect() {
+    MockServer server;
+
+    auto redis = Redis(server.connection_options());
+    redis.set("key", "val");
+
+    server.disconnect_after(1);
+
+    redis.get("key");
+
+    try {
+        redis.get("key");
+        REDIS_ASSERT(false, "failed to test disconnect");
+    } catch (const Error &) {
+    }
+
+    auto val = redis.get("key");
+    REDIS_ASSERT(val && *val == "val", "failed to test reconnect");
+
+    REDIS_ASSERT(server.connection_num() == 2, "failed to test connection number");
+}
+
+inline void MockServerTest::_test_cluster() {
+    MockServer first;
+    MockServer second;
+
+    Shards shards;
+    shards.emplace(SlotRange{0, 8191}, first.node());
+    shards.emplace(SlotRange{8192, 16383}, second.node());
+    first.set_cluster_slots(shards);
+    second.set_cluster_slots(shards);
+
+    // Find keys served by the first node.
+    std::vector<std::string> keys;
+    for (auto idx = 0; keys.size() != 2; ++idx) {
+        auto key = "key" + std::to_string(idx);
+        if (MockServer::slot(key) <= 8191) {
+            keys.push_back(key);
+        }
+    }
+
+    auto cluster = RedisCluster(first.connection_options());
+    auto first_node = Redis(first.connection_options());
+    auto second_node = Redis(second.connection_options());
+
+    std::vector<std::string> slot_keys = {"", "key", "{tag}key", "{}key", "{key", "key}{tag}",
+        "a-long-key-that-is-hashed-with-slice-by-8:0123456789", "{a-long-hash-tag-0123456789}"};
+    std::vector<Slot> slots;
+    cluster.slots(slot_keys.begin(), slot_keys.end(), std::back_inserter(slots));
+    REDIS_ASSERT(slots.size() == slot_keys.size(), "failed to test slots");
+    for (std::size_t idx = 0; idx != slot_keys.size(); ++idx) {
+        REDIS_ASSERT(slots[idx] == MockServer::slot(slot_keys[idx])
+                && slots[idx] == cluster.slot(slot_keys[idx]),
+                "failed to test slot of " + slot_keys[idx]);
+    }
+    REDIS_ASSERT(cluster.slot("123456789") == (0x31C3 & 16383), "failed to test crc16");
+
+    cluster.set(keys[0], "val");
+    REDIS_ASSERT(first_node.exists(keys[0]) == 1 && second_node.exists(keys[0]) == 0,
+            "failed to test mock cluster");
+
+    first.redirect(MockServer::slot(keys[0]), second.node());
+    cluster.set(keys[0], "moved");
+    auto val = second_node.get(keys[0]);
+    REDIS_ASSERT(val && *val == "moved", "failed to test MOVED");
+
+    first.redirect(MockServer::slot(keys[1]), second.node(), true);
+    cluster.set(keys[1], "asked");
+    val = second_node.get(keys[1]);
+    REDIS_ASSERT(val && *val == "asked", "failed to test ASK");
+}
+
+inline void MockServerTest::_test_cluster_scan() {
+    MockServer first;
+    MockServer second;
+    MockServer third;
+
+    Shards shards;
+    shards.emplace(SlotRange{0, 5000}, first.node());
+    shards.emplace(SlotRange{5001, 10000}, second.node());
+    shards.emplace(SlotRange{10001, 12000}, third.node());
+    // The first node serves 2 slot ranges, and should be scanned only once.
+    shards.emplace(SlotRange{12001, 16383}, first.node());
+    for (auto *server : {&first, &second, &third}) {
+        server->set_cluster_slots(shards);
+    }
+
+    // Pages of a slow node arrive later than others.
+    second.set_latency(std::chrono::milliseconds(2));
+
+    auto cluster = RedisCluster(first.connection_options());
+
+    std::unordered_set<std::string> keys;
+    for (auto idx = 0; idx != 100; ++idx) {
+        auto key = "key" + std::to_string(idx);
+        cluster.set(key, "val");
+        keys.insert(key);
+    }
+
+    ClusterScanOptions opts;
+    opts.count = 7;
+    auto scanner = cluster.scanner(opts);
+
+    std::vector<std::string> scanned(scanner.begin(), scanner.end());
+    REDIS_ASSERT(scanned.size() == keys.size()
+            && std::unordered_set<std::string>(scanned.begin(), scanned.end()) == keys,
+            "failed to test cluster scan");
+
+    std::string key;
+    REDIS_ASSERT(!scanner.next(key) && scanner.begin() == scanner.end(),
+            "failed to test cluster scan with finished scanner");
+
+    opts.pattern = "key1*";
+    std::unordered_set<std::string> matched;
+    for (const auto &ele : cluster.scanner(opts)) {
+        matched.insert(ele);
+    }
+    // key1, key10, ..., key19.
+    REDIS_ASSERT(matched.size() == 11 && matched.count("key1") == 1 && matched.count("key19") == 1,
+            "failed to test cluster scan with pattern");
+
+    // Abandon the iteration with SCAN commands pending, and connections should still work.
+    {
+        auto abandoned = cluster.scanner(opts);
+        REDIS_ASSERT(abandoned.next(key), "failed to test abandoned cluster scan");
+    }
+    for (const auto &ele : keys) {
+        auto val = cluster.get(ele);
+        REDIS_ASSERT(val && *val == "val", "failed to test cluster after abandoned scan");
+    }
+
+    third.set_reply("SCAN", MockServer::error("ERR scan failed"));
+    scanner = cluster.scanner();
+    try {
+        while (scanner.next(key)) {}
+        REDIS_ASSERT(false, "failed to test cluster scan with error");
+    } catch (const ReplyError &) {
+    }
+}
+
+inline void MockServerTest::_test_cluster_update() {
+    MockServer first;
+    MockServer second;
+
+    Shards shards;
+    shards.emplace(SlotRange{0, 8191}, first.node());
+    shards.emplace(SlotRange{8192, 16383}, second.node());
+    first.set_cluster_slots(shards);
+    second.set_cluster_slots(shards);
+
+    std::string key;
+    for (auto idx = 0; key.empty(); ++idx) {
+        auto candidate = "key" + std::to_string(idx);
+        if (MockServer::slot(candidate) <= 8191) {
+            key = candidate;
+        }
+    }
+
+    auto command_num = [&first, &second]() {
+        return first.command_num() + second.command_num();
+    };
+
+    {
+        auto cluster = RedisCluster(first.connection_options());
+        cluster.set(key, "val");
+
+        // MOVED only patches the slot, i.e. the command is resent without CLUSTER SLOTS.
+        first.redirect(MockServer::slot(key), second.node());
+        auto num = command_num();
+        cluster.set(key, "moved");
+        REDIS_ASSERT(command_num() - num == 2, "failed to test patching slot without refresh");
+
+        auto val = Redis(second.connection_options()).get(key);
+        REDIS_ASSERT(val && *val == "moved", "failed to test command after patching slot");
+
+        // Later commands go to the new owner directly.
+        num = first.command_num();
+        val = cluster.get(key);
+        REDIS_ASSERT(val && *val == "moved" && first.command_num() == num,
+                "failed to test routing after patching slot");
+
+        first.clear_redirections();
+    }
+
+    // Slow CLUSTER SLOTS, so that concurrent callers overlap with the first one's refresh.
+    first.set_latency(std::chrono::milliseconds(200));
+    second.set_latency(std::chrono::milliseconds(200));
+
+    ShardsPool pool(ConnectionPoolOptions{}, first.connection_options());
+
+    auto concurrent_update = [&pool]() {
+        std::atomic<int> failures{0};
+        std::vector<std::thread> threads;
+        for (auto idx = 0; idx != 8; ++idx) {
+            threads.emplace_back([&pool, &failures]() {
+                        try {
+                            pool.update();
+                        } catch (const Error &) {
+                            ++failures;
+                        }
+                    });
+        }
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        return failures.load();
+    };
+
+    auto num = command_num();
+    REDIS_ASSERT(concurrent_update() == 0 && command_num() - num == 1,
+            "failed to test single-flight update");
+
+    // Callers waiting for a failed refresh get its error. A refresh tries at most 3 times.
+    first.set_reply("CLUSTER", MockServer::error("ERR cluster is down"));
+    second.set_reply("CLUSTER", MockServer::error("ERR cluster is down"));
+    num = command_num();
+    REDIS_ASSERT(concurrent_update() == 8 && command_num() - num == 3,
+            "failed to test error of single-flight update");
+}
+
+inline void MockServerTest::_test_read_preference() {
+    MockServer master;
+    MockServer replica;
+
+    Shards shards;
+    shards.emplace(SlotRange{0, 16383}, master.node());
+    std::map<SlotRange, std::vector<Node>> replicas;
+    replicas.emplace(SlotRange{0, 16383}, std::vector<Node>{replica.node()});
+    master.set_cluster_slots(shards, replicas);
+    replica.set_cluster_slots(shards, replicas);
+
+    std::atomic<int> readonly_num{0};
+    replica.set_handler("READONLY", [&readonly_num](const std::vector<std::string> &) {
+                ++readonly_num;
+                return MockServer::status("OK");
+            });
+
+    // The same key has different values on master and replica, so that we know who serves it.
+    Redis(master.connection_options()).set("key", "master");
+    Redis(replica.connection_options()).set("key", "replica");
+
+    ClusterOptions cluster_opts;
+    cluster_opts.read_preference = ReadPreference::MASTER;
+    {
+        auto cluster = RedisCluster(master.connection_options(), {}, cluster_opts);
+        auto val = cluster.get("key");
+        REDIS_ASSERT(val && *val == "master", "failed to test reading from master");
+    }
+    REDIS_ASSERT(readonly_num == 0, "failed to test reading from master without READONLY");
+
+    cluster_opts.read_preference = ReadPreference::PREFER_REPLICA;
+    auto cluster = RedisCluster(master.connection_options(), {}, cluster_opts);
+    for (auto idx = 0; idx != 3; ++idx) {
+        auto val = cluster.get("key");
+        REDIS_ASSERT(val && *val == "replica", "failed to test reading from replica");
+    }
+    REDIS_ASSERT(readonly_num > 0, "failed to test READONLY on replica connections");
+
+    // Writes always go to master.
+    cluster.set("written", "val");
+    REDIS_ASSERT(Redis(master.connection_options()).exists("written") == 1
+            && Redis(replica.connection_options()).exists("written") == 0,
+            "failed to test writing with replicas");
+
+    cluster_opts.read_preference = ReadPreference::ROUND_ROBIN;
+    {
+        auto round_robin = RedisCluster(master.connection_options(), {}, cluster_opts);
+        std::unordered_set<std::string> vals;
+        for (auto idx = 0; idx != 4; ++idx) {
+            auto val = round_robin.get("key");
+            REDIS_ASSERT(bool(val), "failed to test reading in round-robin way");
+            vals.insert(*val);
+        }
+        REDIS_ASSERT(vals.size() == 2, "failed to test reading from both master and replica");
+    }
+
+    cluster_opts.read_preference = ReadPreference::LOWEST_LATENCY;
+    replica.set_latency(std::chrono::milliseconds(20));
+    {
+        auto lowest_latency = RedisCluster(master.connection_options(), {}, cluster_opts);
+        auto val = lowest_latency.get("key");
+        REDIS_ASSERT(val && *val == "master", "failed to test reading from the fastest node");
+    }
+    replica.set_latency(std::chrono::microseconds(0));
+
+    // Reads fall back to master, once the replica is down.
+    replica.stop();
+    for (auto idx = 0; idx != 3; ++idx) {
+        auto val = cluster.get("key");
+        REDIS_ASSERT(val && *val == "master", "failed to test falling back to master");
+    }
+}
+
+inline void MockServerTest::_test_async_cluster() {
+    MockServer first;
+    MockServer second;
+
+    Shards shards;
+    shards.emplace(SlotRange{0, 8191}, first.node());
+    shards.emplace(SlotRange{8192, 16383}, second.node());
+    first.set_cluster_slots(shards);
+    second.set_cluster_slots(shards);
+
+    std::string first_key;
+    std::string second_key;
+    for (auto idx = 0; first_key.empty() || second_key.empty(); ++idx) {
+        auto key = "key" + std::to_string(idx);
+        (MockServer::slot(key) <= 8191 ? first_key : second_key) = key;
+    }
+
+    AsyncRedisCluster cluster(first.connection_options());
+    REDIS_ASSERT(cluster.set(first_key, "a").get() && cluster.set(second_key, "b").get(),
+            "failed to test async cluster");
+
+    // Commands to the broken node fail with their futures, instead of throwing,
+    // and the topology is refreshed in background.
+    second.stop();
+    auto fut = cluster.get(second_key);
+    auto failed = false;
+    try {
+        fut.get();
+    } catch (const Error &) {
+        failed = true;
+    }
+    REDIS_ASSERT(failed, "failed to test async cluster with broken node");
+
+    for (auto idx = 0; idx != 10; ++idx) {
+        auto val = cluster.get(first_key).get();
+        REDIS_ASSERT(val && *val == "a", "failed to test async cluster after refresh");
+    }
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_HPP
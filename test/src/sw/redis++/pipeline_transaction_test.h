@@ -43,6 +43,14 @@ private:
 
     void _test_watch();
 
+    void _test_cluster_pipeline() {
+        // Only RedisCluster supports ClusterPipeline.
+    }
+
+    void _test_borrowed_connection() {
+        // Only RedisCluster borrows connections from pool.
+    }
+
     RedisInstance &_redis;
 };
 
@@ -50,6 +50,10 @@ void PipelineTransactionTest<RedisInstance>::run() {
     }
 
     _test_watch();
+
+    _test_cluster_pipeline();
+
+    _test_borrowed_connection();
 }
 
 template <typename RedisInstance>
@@ -95,6 +99,10 @@ void PipelineTransactionTest<RedisInstance>::_test_pipeline(const StringView &ke
     len = reply::parse<long long>(replies.get(2));
     REDIS_ASSERT(bool(new_val) && *new_val == val && len == val.size(),
             "failed to test pipeline with string operations");
+
+    auto view = replies.get<StringView>(1);
+    REDIS_ASSERT(std::string(view.data(), view.size()) == val,
+            "failed to test pipeline with string view");
 }
 
 template <typename RedisInstance>
@@ -175,6 +183,98 @@ void PipelineTransactionTest<RedisInstance>::_test_watch() {
     }
 }
 
+template <>
+inline void PipelineTransactionTest<RedisCluster>::_test_cluster_pipeline() {
+    // Keys without hash tag, so that they're located on different slots.
+    std::vector<std::string> keys;
+    for (auto idx = 0; idx != 10; ++idx) {
+        keys.push_back("sw::redis::test::cluster_pipeline::" + std::to_string(idx));
+    }
+
+    KeyDeleter<RedisCluster> deleter(_redis, keys.begin(), keys.end());
+
+    auto pipe = _redis.cluster_pipeline();
+    for (const auto &key : keys) {
+        pipe.set(key, key).incr(key + "::counter");
+    }
+
+    std::vector<std::string> counters;
+    for (const auto &key : keys) {
+        pipe.get(key).del(key + "::counter");
+        counters.push_back(key + "::counter");
+    }
+
+    REDIS_ASSERT(pipe.size() == keys.size() * 4, "failed to test cluster pipeline");
+
+    auto replies = pipe.exec();
+
+    REDIS_ASSERT(replies.size() == keys.size() * 4 && pipe.size() == 0,
+            "failed to test cluster pipeline");
+
+    for (std::size_t idx = 0; idx != keys.size(); ++idx) {
+        REDIS_ASSERT(replies.get<bool>(idx * 2) && replies.get<long long>(idx * 2 + 1) == 1,
+                "failed to test cluster pipeline");
+
+        auto offset = keys.size() * 2;
+        auto val = replies.get<OptionalString>(offset + idx * 2);
+        REDIS_ASSERT(bool(val) && *val == keys[idx]
+                    && replies.get<long long>(offset + idx * 2 + 1) == 1,
+                "failed to test cluster pipeline in order");
+    }
+
+    pipe.command("SET", keys.front(), "value").command("NOT-A-COMMAND", keys.back());
+    try {
+        pipe.exec();
+        REDIS_ASSERT(false, "failed to test cluster pipeline with error reply");
+    } catch (const ReplyError &) {
+    }
+
+    auto val = _redis.get(keys.front());
+    REDIS_ASSERT(bool(val) && *val == "value",
+            "failed to test cluster pipeline with error reply");
+
+    pipe.get(keys.front());
+    pipe.discard();
+
+    REDIS_ASSERT(pipe.size() == 0, "failed to test cluster pipeline discard");
+}
+
+
+template <>
+inline void PipelineTransactionTest<RedisCluster>::_test_borrowed_connection() {
+    auto key = test_key("borrowed_connection");
+
+    KeyDeleter<RedisCluster> deleter(_redis, key);
+
+    {
+        // Warm up the pool of the node.
+        auto pipe = _pipeline(key);
+        pipe.set(key, "value").exec();
+    }
+
+    auto stats = _redis.pool_stats();
+
+    {
+        auto pipe = _pipeline(key);
+
+        // Commands sent with RedisCluster should NOT be blocked by the borrowed connection.
+        _redis.set(key, "value");
+
+        auto replies = pipe.get(key).exec();
+        auto val = replies.get<OptionalString>(0);
+        REDIS_ASSERT(bool(val) && *val == "value", "failed to test borrowed connection");
+
+        // Unexecuted commands are discarded with the connection.
+        pipe.set(key, "new-value");
+    }
+
+    auto val = _redis.get(key);
+    REDIS_ASSERT(bool(val) && *val == "value", "failed to test borrowed connection");
+
+    REDIS_ASSERT(_redis.pool_stats().reused > stats.reused,
+            "failed to test borrowed connection reuse");
+}
+
 }
 
 }
@@ -44,6 +44,8 @@ private:
 
     void _test_generic_command();
 
+    void _test_read_buffer();
+
     void _test_hash_tag();
 
     void _test_hash_tag(std::initializer_list<std::string> keys);
@@ -47,6 +47,8 @@ void SanityTest<RedisInstance>::run() {
     _test_cmdargs();
 
     _test_generic_command();
+
+    _test_read_buffer();
 }
 
 template <typename RedisInstance>
@@ -125,6 +127,38 @@ void SanityTest<RedisInstance>::_test_cmdargs() {
             "failed to test cmdargs");
 }
 
+template <typename RedisInstance>
+void SanityTest<RedisInstance>::_test_read_buffer() {
+    auto opts = _opts;
+    opts.read_buffer_strategy = ReadBufferStrategy::ADAPTIVE;
+    opts.read_buffer_size = 1024;
+    opts.max_read_buffer_size = 64 * 1024;
+    opts.socket_recv_buffer_size = 256 * 1024;
+    opts.socket_send_buffer_size = 256 * 1024;
+
+    auto redis = RedisInstance(opts);
+
+    auto key = test_key("read_buffer");
+
+    KeyDeleter<RedisInstance> deleter(redis, key);
+
+    // Larger than the max read size, so that it's read with several large reads.
+    std::string val(1024 * 1024, 'a');
+    for (std::size_t idx = 0; idx < val.size(); idx += 1000) {
+        val[idx] = static_cast<char>('a' + idx % 26);
+    }
+
+    redis.set(key, val);
+
+    for (auto idx = 0; idx != 3; ++idx) {
+        auto res = redis.get(key);
+        REDIS_ASSERT(res && *res == val, "failed to test adaptive read buffer");
+    }
+
+    REDIS_ASSERT(redis.strlen(key) == static_cast<long long>(val.size()),
+            "failed to test adaptive read buffer with small replies");
+}
+
 template <typename RedisInstance>
 void SanityTest<RedisInstance>::_test_generic_command() {
     auto key = test_key("key");
@@ -43,6 +43,10 @@ private:
 
     void _test_mgetset();
 
+    void _test_cross_slot_mgetset();
+
+    void _test_view();
+
     RedisInstance &_redis;
 };
 
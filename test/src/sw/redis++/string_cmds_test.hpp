@@ -37,6 +37,10 @@ void StringCmdTest<RedisInstance>::run() {
     _test_getset();
 
     _test_mgetset();
+
+    _test_cross_slot_mgetset();
+
+    _test_view();
 }
 
 template <typename RedisInstance>
@@ -238,6 +242,77 @@ void StringCmdTest<RedisInstance>::_test_mgetset() {
     REDIS_ASSERT(!_redis.msetnx(kvs), "failed to test msetnx");
 }
 
+template <typename RedisInstance>
+void StringCmdTest<RedisInstance>::_test_cross_slot_mgetset() {
+    // Keys without hash tag, so that they're located on different slots with RedisCluster.
+    std::vector<std::pair<std::string, std::string>> kvs;
+    std::vector<std::string> keys;
+    for (auto idx = 0; idx != 10; ++idx) {
+        auto key = "sw::redis::test::cross-slot::" + std::to_string(idx);
+        kvs.emplace_back(key, "v" + std::to_string(idx));
+        keys.push_back(key);
+    }
+
+    // The last key doesn't exist.
+    auto missing_key = std::string("sw::redis::test::cross-slot::missing");
+    keys.push_back(missing_key);
+
+    KeyDeleter<RedisInstance> deleter(_redis, keys.begin(), keys.end());
+
+    _redis.mset(kvs.begin(), kvs.end());
+
+    std::vector<OptionalString> res;
+    _redis.mget(keys.begin(), keys.end(), std::back_inserter(res));
+    REDIS_ASSERT(res.size() == keys.size(), "failed to test cross slot mget");
+
+    for (std::size_t idx = 0; idx != kvs.size(); ++idx) {
+        REDIS_ASSERT(res[idx] && *res[idx] == kvs[idx].second,
+                "failed to test cross slot mget: reply out of order");
+    }
+
+    REDIS_ASSERT(!res.back(), "failed to test cross slot mget with non-existent key");
+
+    auto key_num = static_cast<long long>(kvs.size());
+    REDIS_ASSERT(_redis.exists(keys.begin(), keys.end()) == key_num,
+            "failed to test cross slot exists");
+
+    REDIS_ASSERT(_redis.del(keys.begin(), keys.end()) == key_num,
+            "failed to test cross slot del");
+}
+
+template <typename RedisInstance>
+void StringCmdTest<RedisInstance>::_test_view() {
+    auto key = test_key("view");
+    auto hash = test_key("view-hash");
+    auto list = test_key("view-list");
+
+    KeyDeleter<RedisInstance> deleter(_redis, {key, hash, list});
+
+    auto view = _redis.get_view(key);
+    REDIS_ASSERT(!*view, "failed to test get_view with nonexistent key");
+
+    std::string val(100 * 1024, 'v');
+    _redis.set(key, val);
+
+    view = _redis.get_view(key);
+    REDIS_ASSERT(bool(*view) && std::string((*view)->data(), (*view)->size()) == val,
+            "failed to test get_view");
+
+    _redis.hset(hash, "field", "value");
+    auto field_view = _redis.hget_view(hash, "field");
+    REDIS_ASSERT(bool(*field_view)
+                    && std::string((*field_view)->data(), (*field_view)->size()) == "value",
+            "failed to test hget_view");
+
+    _redis.rpush(list, {"a", "b", "c"});
+    auto list_view = _redis.lrange_view(list, 0, -1);
+    std::vector<std::string> items;
+    for (const auto &item : *list_view) {
+        items.emplace_back(item.data(), item.size());
+    }
+    REDIS_ASSERT((items == std::vector<std::string>{"a", "b", "c"}), "failed to test lrange_view");
+}
+
 }
 
 }
@@ -35,6 +35,9 @@
 #include "threads_test.h"
 #include "stream_cmds_test.h"
 #include "benchmark_test.h"
+#include "async_test.h"
+#include "client_cache_test.h"
+#include "mock_server_test.h"
 
 namespace {
 
@@ -61,6 +64,13 @@ int main(int argc, char **argv) {
         sw::redis::Optional<sw::redis::test::BenchmarkOptions> benchmark_opts;
         std::tie(opts, cluster_node_opts, benchmark_opts) = parse_options(argc, argv);
 
+        if (!benchmark_opts) {
+            sw::redis::test::MockServerTest mock_server_test;
+            mock_server_test.run();
+
+            std::cout << "Pass mock server tests" << std::endl;
+        }
+
         if (opts) {
             std::cout << "Testing Redis..." << std::endl;
 
@@ -68,6 +78,11 @@ int main(int argc, char **argv) {
                 run_benchmark<sw::redis::Redis>(*opts, *benchmark_opts);
             } else {
                 run_test<sw::redis::Redis>(*opts);
+
+                sw::redis::test::ClientCacheTest client_cache_test(*opts);
+                client_cache_test.run();
+
+                std::cout << "Pass client cache tests" << std::endl;
             }
         }
 
@@ -283,6 +298,11 @@ void run_test(const sw::redis::ConnectionOptions &opts) {
     stream_test.run();
 
     std::cout << "Pass stream commands tests" << std::endl;
+
+    sw::redis::test::AsyncTest<RedisInstance> async_test(opts, instance);
+    async_test.run();
+
+    std::cout << "Pass async tests" << std::endl;
 }
 
 template <typename RedisInstance>
@@ -294,7 +314,10 @@ void run_benchmark(const sw::redis::ConnectionOptions &opts,
     std::cout << "  Length of key: " << benchmark_opts.key_len << std::endl;
     std::cout << "  Length of value: " << benchmark_opts.val_len << std::endl;
 
-    auto instance = RedisInstance(opts);
+    sw::redis::ConnectionPoolOptions pool_opts;
+    pool_opts.size = benchmark_opts.pool_size;
+
+    auto instance = RedisInstance(opts, pool_opts);
 
     sw::redis::test::BenchmarkTest<RedisInstance> benchmark_test(benchmark_opts, instance);
     benchmark_test.run();
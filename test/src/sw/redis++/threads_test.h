@@ -37,6 +37,10 @@ private:
 
     void _test_timeout();
 
+    void _test_metrics();
+
+    void _test_tracer();
+
     ConnectionOptions _opts;
 };
 
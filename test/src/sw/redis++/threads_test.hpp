@@ -43,7 +43,29 @@ void ThreadsTest<RedisInstance>::run() {
     pool_opts.size = 10;
     _test_multithreads(RedisInstance(_opts, pool_opts), thread_num, times);
 
+    // Pool with 10 connections, which are partitioned into a shard per hardware thread.
+    pool_opts.shards = 0;
+    _test_multithreads(RedisInstance(_opts, pool_opts), thread_num, times);
+
+    // Pool with 10 connections, and idle connections are checked, and trimmed to 5,
+    // in the background.
+    pool_opts.health_check_interval = std::chrono::milliseconds(10);
+    pool_opts.max_idle = 5;
+    _test_multithreads(RedisInstance(_opts, pool_opts), thread_num, times);
+    pool_opts.health_check_interval = std::chrono::milliseconds(0);
+    pool_opts.max_idle = 0;
+
+    // Pool with 2 connections, and commands are auto-pipelined.
+    pool_opts.size = 2;
+    pool_opts.shards = 1;
+    pool_opts.auto_pipeline = true;
+    _test_multithreads(RedisInstance(_opts, pool_opts), thread_num, times);
+
     _test_timeout();
+
+    _test_metrics();
+
+    _test_tracer();
 }
 
 template <typename RedisInstance>
@@ -136,6 +158,135 @@ void ThreadsTest<RedisInstance>::_test_timeout() {
 
     slow_get_thread.join();
     get_thread.join();
+
+    auto stats = redis.pool_stats();
+    REDIS_ASSERT(stats.wait_time.count >= 1, "failed to test pool wait time");
+}
+
+template <typename RedisInstance>
+void ThreadsTest<RedisInstance>::_test_metrics() {
+    ConnectionPoolOptions pool_opts;
+    pool_opts.size = 2;
+
+    auto redis = RedisInstance(_opts, pool_opts);
+
+    std::atomic<long long> samples{0};
+    MetricsOptions metrics_opts;
+    metrics_opts.callback = [&samples](const CommandSample &) { ++samples; };
+    redis.enable_metrics(metrics_opts);
+
+    auto key = test_key("metrics");
+
+    KeyDeleter<RedisInstance> deleter(redis, key);
+
+    auto thread_num = 4;
+    auto times = 100;
+    std::vector<std::thread> workers;
+    workers.reserve(thread_num);
+    for (auto idx = 0; idx != thread_num; ++idx) {
+        workers.emplace_back([&redis, &key, times]() {
+                                for (auto i = 0; i != times; ++i) {
+                                    redis.incr(key);
+                                }
+                            });
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // KeyDeleter's DEL is NOT counted, since it hasn't been sent yet.
+    auto stats = redis.metrics_stats();
+    auto iter = stats.commands.find("INCR");
+    REDIS_ASSERT(iter != stats.commands.end()
+            && iter->second.latency.count == thread_num * times
+            && iter->second.errors == 0,
+            "failed to test metrics of INCR");
+
+    const auto &latency = iter->second.latency;
+    REDIS_ASSERT(latency.percentile(50) <= latency.percentile(99)
+            && latency.percentile(100) == latency.max,
+            "failed to test latency percentiles");
+
+    REDIS_ASSERT(!stats.nodes.empty(), "failed to test metrics of nodes");
+
+    REDIS_ASSERT(samples == thread_num * times, "failed to test metrics callback");
+
+    auto pool_stats = redis.pool_stats();
+    REDIS_ASSERT(pool_stats.created + pool_stats.reused >= thread_num * times
+            && pool_stats.in_use == 0,
+            "failed to test pool stats");
+}
+
+template <typename RedisInstance>
+void ThreadsTest<RedisInstance>::_test_tracer() {
+    // Trace every other command.
+    class TestTracer : public Tracer {
+    public:
+        virtual bool sample() override {
+            return _sampled++ % 2 == 0;
+        }
+
+        virtual void trace(const TraceSpan &span) override {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            spans.push_back(Span{std::string(span.command.data(), span.command.size()),
+                                    std::string(span.key.data(), span.key.size()),
+                                    span.bytes_sent,
+                                    span.bytes_received,
+                                    span.end >= span.start && span.ok});
+        }
+
+        struct Span {
+            std::string command;
+            std::string key;
+            std::size_t bytes_sent;
+            std::size_t bytes_received;
+            bool ok;
+        };
+
+        std::vector<Span> spans;
+
+    private:
+        std::atomic<long long> _sampled{0};
+
+        std::mutex _mutex;
+    };
+
+    auto redis = RedisInstance(_opts);
+
+    auto tracer = std::make_shared<TestTracer>();
+    redis.set_tracer(tracer);
+
+    auto key = test_key("tracer");
+
+    KeyDeleter<RedisInstance> deleter(redis, key);
+
+    // Sampled.
+    redis.set(key, "value");
+
+    // NOT sampled.
+    redis.get(key);
+
+    // Sampled.
+    redis.get(key);
+
+    redis.set_tracer(nullptr);
+
+    REDIS_ASSERT(tracer->spans.size() == 2, "failed to test tracer sampling");
+
+    // *3\r\n$3\r\nSET\r\n$<len>\r\n<key>\r\n$5\r\nvalue\r\n
+    const auto &set_span = tracer->spans[0];
+    REDIS_ASSERT(set_span.command == "SET" && set_span.key == key && set_span.ok
+            && set_span.bytes_sent == 29 + std::to_string(key.size()).size() + key.size()
+            && set_span.bytes_received == 5,
+            "failed to test tracing SET");
+
+    // $5\r\nvalue\r\n
+    const auto &get_span = tracer->spans[1];
+    REDIS_ASSERT(get_span.command == "GET" && get_span.key == key && get_span.ok
+            && get_span.bytes_received == 11,
+            "failed to test tracing GET");
 }
 
 }